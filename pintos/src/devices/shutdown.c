@@ -5,14 +5,27 @@
 #include "devices/serial.h"
 #include "devices/timer.h"
 #include "threads/io.h"
+#include "threads/malloc.h"
 #include "threads/thread.h"
 #ifdef USERPROG
+#include "userprog/aio.h"
 #include "userprog/exception.h"
+#include "userprog/futex.h"
+#include "userprog/pipe.h"
+#include "userprog/process.h"
+#include "userprog/syscall.h"
 #endif
 #ifdef FILESYS
 #include "devices/block.h"
 #include "filesys/filesys.h"
 #endif
+#ifdef VM
+#include "vm/frame.h"
+#include "vm/shm.h"
+#include "vm/swap.h"
+#include "vm/ws.h"
+#include "vm/zstore.h"
+#endif
 
 /* Keyboard control register port. */
 #define CONTROL_REG 0x64
@@ -120,6 +133,7 @@ print_stats (void)
 {
   timer_print_stats ();
   thread_print_stats ();
+  malloc_print_stats ();
 #ifdef FILESYS
   block_print_stats ();
 #endif
@@ -127,5 +141,17 @@ print_stats (void)
   kbd_print_stats ();
 #ifdef USERPROG
   exception_print_stats ();
+  process_print_stats ();
+  syscall_print_stats ();
+  aio_print_stats ();
+  pipe_print_stats ();
+  futex_print_stats ();
+#endif
+#ifdef VM
+  frame_print_stats ();
+  swap_print_stats ();
+  zstore_print_stats ();
+  ws_print_stats ();
+  shm_print_stats ();
 #endif
 }
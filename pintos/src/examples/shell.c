@@ -5,6 +5,10 @@
 
 static void read_line (char line[], size_t);
 static bool backspace (char **pos, char line[]);
+static void run_pipeline (char command[]);
+
+/* Most commands in a pipeline. */
+#define MAX_STAGES 8
 
 int
 main (void)
@@ -30,6 +34,8 @@ main (void)
         {
           /* Empty command. */
         }
+      else if (strchr (command, '|') != NULL)
+        run_pipeline (command);
       else
         {
           pid_t pid = exec (command);
@@ -102,3 +108,78 @@ backspace (char **pos, char line[])
   else
     return false;
 }
+
+/* Runs COMMAND, a series of commands separated by `|', with the
+   output of each command connected to the input of the next by a
+   pipe.  Each command inherits the shell's standard input and
+   output descriptors at the time it is started, so the shell
+   points them at the right pipe ends before each exec() and
+   restores them afterward. */
+static void
+run_pipeline (char command[])
+{
+  char *stages[MAX_STAGES];
+  pid_t pids[MAX_STAGES];
+  int stage_cnt = 0;
+  int saved_in, saved_out;
+  int in = -1;
+  char *token, *save_ptr;
+  int i;
+
+  for (token = strtok_r (command, "|", &save_ptr); token != NULL;
+       token = strtok_r (NULL, "|", &save_ptr))
+    {
+      while (*token == ' ')
+        token++;
+      if (stage_cnt >= MAX_STAGES)
+        {
+          printf ("too many commands in pipeline\n");
+          return;
+        }
+      stages[stage_cnt++] = token;
+    }
+
+  saved_in = dup (STDIN_FILENO);
+  saved_out = dup (STDOUT_FILENO);
+  if (saved_in < 0 || saved_out < 0)
+    {
+      printf ("dup failed\n");
+      return;
+    }
+
+  for (i = 0; i < stage_cnt; i++)
+    {
+      int fds[2];
+
+      /* Connect standard input to the previous command's pipe. */
+      dup2 (in >= 0 ? in : saved_in, STDIN_FILENO);
+      if (in >= 0)
+        close (in);
+      in = -1;
+
+      /* Connect standard output to a new pipe, unless this is the
+         last command. */
+      if (i < stage_cnt - 1 && pipe (fds))
+        {
+          dup2 (fds[1], STDOUT_FILENO);
+          close (fds[1]);
+          in = fds[0];
+        }
+      else
+        dup2 (saved_out, STDOUT_FILENO);
+
+      pids[i] = exec (stages[i]);
+    }
+  if (in >= 0)
+    close (in);
+  dup2 (saved_in, STDIN_FILENO);
+  dup2 (saved_out, STDOUT_FILENO);
+  close (saved_in);
+  close (saved_out);
+
+  for (i = 0; i < stage_cnt; i++)
+    if (pids[i] != PID_ERROR)
+      printf ("\"%s\": exit code %d\n", stages[i], wait (pids[i]));
+    else
+      printf ("\"%s\": exec failed\n", stages[i]);
+}
@@ -0,0 +1,86 @@
+/* syscall-bench.c
+
+   Measures what a system call costs the program that makes it,
+   from the instruction before the call to the one after, first
+   entering the kernel by "int $0x30" and then by SYSENTER.
+
+   The kernel's own statistics, printed at shutdown, time only
+   the system call handler, leaving out the kernel's entry and
+   exit paths, which is where the two ways differ.
+
+   The call timed is dup() of a descriptor that is not open, which
+   does almost nothing in the kernel.  Each way is timed over
+   ROUND_CNT rounds of CALL_CNT calls, and only the fastest round
+   counts, so that rounds slowed by interrupts do not.  The cost
+   of the timing loop itself is subtracted. */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <syscall.h>
+
+#define ROUND_CNT 20
+#define CALL_CNT 1000
+
+/* Returns the processor's time-stamp counter. */
+static inline uint64_t
+rdtsc (void)
+{
+  uint32_t lo, hi;
+  asm volatile ("rdtsc" : "=a" (lo), "=d" (hi));
+  return ((uint64_t) hi << 32) | lo;
+}
+
+/* Stands in for dup() when timing the loop alone. */
+static int NO_INLINE
+no_call (int fd UNUSED)
+{
+  return -1;
+}
+
+/* Returns the fewest cycles taken by CALL_CNT calls to FUNC in
+   any of ROUND_CNT rounds. */
+static uint64_t
+time_calls (int (*func) (int))
+{
+  int (*volatile call) (int) = func;
+  uint64_t best = UINT64_MAX;
+  int round;
+
+  for (round = 0; round < ROUND_CNT; round++)
+    {
+      uint64_t start, cycles;
+      int i;
+
+      start = rdtsc ();
+      for (i = 0; i < CALL_CNT; i++)
+        call (-1);
+      cycles = rdtsc () - start;
+      if (cycles < best)
+        best = cycles;
+    }
+  return best;
+}
+
+/* Times dup() by the way of entering the kernel named NAME and
+   prints the cycles per call, less OVERHEAD cycles per round. */
+static void
+report (const char *name, uint64_t overhead)
+{
+  uint64_t cycles = time_calls (dup) - overhead;
+  printf ("%s: %llu cycles per call\n",
+          name, (unsigned long long) (cycles / CALL_CNT));
+}
+
+int
+main (void)
+{
+  uint64_t overhead = time_calls (no_call);
+
+  syscall_use_sysenter (false);
+  report ("int $0x30", overhead);
+  if (syscall_use_sysenter (true))
+    report ("sysenter", overhead);
+  else
+    printf ("sysenter: not supported\n");
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,61 @@
+#ifndef __LIB_AIO_H
+#define __LIB_AIO_H
+
+/* Asynchronous file I/O.
+
+   A process describes I/O requests as submission queue entries
+   in a ring in its own memory, and the kernel reports their
+   results as completion queue entries in a second ring.  The
+   process registers the rings with aio_setup() and then calls
+   aio_enter() to hand the kernel new submissions, to collect
+   completions, or both.  Kernel threads carry out the requests
+   in the meantime, so the process can compute while its I/O is
+   in progress.
+
+   Each ring has a power-of-2 number of entries.  Ring indexes
+   run freely and are reduced modulo the number of entries to
+   find a slot.  The process advances sq_tail and cq_head; the
+   kernel advances sq_head and cq_tail. */
+
+/* Operations. */
+#define AIO_READ 0              /* Read LEN bytes at OFFSET into BUF. */
+#define AIO_WRITE 1             /* Write LEN bytes from BUF at OFFSET. */
+#define AIO_FSYNC 2             /* Complete after all earlier requests
+                                   on FD have completed. */
+
+/* Most bytes transferred by one request. */
+#define AIO_MAX_LEN 4096
+
+/* Submission queue entry. */
+struct aio_sqe
+  {
+    int op;                     /* AIO_READ, AIO_WRITE, or AIO_FSYNC. */
+    int fd;                     /* File descriptor. */
+    void *buf;                  /* User buffer. */
+    unsigned len;               /* Bytes to transfer. */
+    unsigned offset;            /* File offset.  The file position is
+                                   neither used nor changed. */
+    unsigned user_data;         /* Copied to the completion. */
+  };
+
+/* Completion queue entry. */
+struct aio_cqe
+  {
+    unsigned user_data;         /* From the submission. */
+    int result;                 /* Bytes transferred, or -1. */
+  };
+
+/* Submission and completion rings. */
+struct aio_ring
+  {
+    unsigned sq_head;           /* Next submission the kernel takes. */
+    unsigned sq_tail;           /* Next free submission slot. */
+    unsigned cq_head;           /* Next completion the process takes. */
+    unsigned cq_tail;           /* Next free completion slot. */
+    unsigned sq_entries;        /* Number of entries in SQES. */
+    unsigned cq_entries;        /* Number of entries in CQES. */
+    struct aio_sqe *sqes;       /* Submission queue. */
+    struct aio_cqe *cqes;       /* Completion queue. */
+  };
+
+#endif /* lib/aio.h */
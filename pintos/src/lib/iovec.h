@@ -0,0 +1,16 @@
+#ifndef __LIB_IOVEC_H
+#define __LIB_IOVEC_H
+
+#include <stddef.h>
+
+/* One buffer in a vector passed to readv() or writev(). */
+struct iovec
+  {
+    void *iov_base;             /* Start of buffer. */
+    size_t iov_len;             /* Length of buffer, in bytes. */
+  };
+
+/* Most buffers in one readv() or writev() vector. */
+#define IOV_MAX 64
+
+#endif /* lib/iovec.h */
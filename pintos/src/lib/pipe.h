@@ -0,0 +1,7 @@
+#ifndef __LIB_PIPE_H
+#define __LIB_PIPE_H
+
+/* Flags for the pipe system call. */
+#define PIPE_NONBLOCK 0x1       /* Fail instead of blocking. */
+
+#endif /* lib/pipe.h */
@@ -1,5 +1,33 @@
 #include <string.h>
 #include <debug.h>
+#include <stdint.h>
+
+/* The block functions below work a 32-bit word at a time once
+   their operands are large enough to make it pay off.  Bulk
+   copies and fills use the x86 "rep movsl" and "rep stosl"
+   string instructions, which need the direction flag clear;
+   both the kernel (see intr_entry) and the user ABI guarantee
+   that on entry.  See [IA32-v2b] "REP/REPE/REPZ/REPNE/REPNZ".
+
+   Words are accessed through `word_t', which may alias any
+   other type, so that reading a block of chars as words does
+   not run afoul of the compiler's type-based alias analysis.
+   The x86 tolerates misaligned word accesses, but they are
+   slower, so each function first aligns the pointer it writes
+   through (or the first pointer it reads through). */
+typedef uint32_t word_t __attribute__ ((may_alias));
+
+/* Blocks smaller than this many bytes are handled a byte at a
+   time, because aligning and setting up the string instructions
+   costs more than it saves. */
+#define WORD_THRESHOLD 16
+
+/* Number of bytes needed to advance P to a word boundary. */
+static inline size_t
+word_align_cnt (const void *p) 
+{
+  return -(uintptr_t) p & (sizeof (word_t) - 1);
+}
 
 /* Copies SIZE bytes from SRC to DST, which must not overlap.
    Returns DST. */
@@ -12,6 +40,23 @@ memcpy (void *dst_, const void *src_, size_t size)
   ASSERT (dst != NULL || size == 0);
   ASSERT (src != NULL || size == 0);
 
+  if (size >= WORD_THRESHOLD) 
+    {
+      size_t head = word_align_cnt (dst);
+      size_t words;
+
+      /* Copy single bytes until DST is aligned, then whole
+         words, leaving the tail for the byte loop below. */
+      size -= head;
+      while (head-- > 0)
+        *dst++ = *src++;
+      words = size / sizeof (word_t);
+      size %= sizeof (word_t);
+      asm volatile ("rep movsl"
+                    : "+D" (dst), "+S" (src), "+c" (words)
+                    : : "memory");
+    }
+
   while (size-- > 0)
     *dst++ = *src++;
 
@@ -29,20 +74,37 @@ memmove (void *dst_, const void *src_, size_t size)
   ASSERT (dst != NULL || size == 0);
   ASSERT (src != NULL || size == 0);
 
-  if (dst < src) 
+  if (dst <= src || dst >= src + size) 
     {
-      while (size-- > 0)
-        *dst++ = *src++;
+      /* A forward copy never overwrites source bytes before
+         reading them. */
+      return memcpy (dst_, src_, size);
     }
   else 
     {
+      /* Copy backward: trailing bytes until the end of DST is
+         aligned, then whole words, then the leading bytes. */
       dst += size;
       src += size;
+      if (size >= WORD_THRESHOLD) 
+        {
+          while ((uintptr_t) dst % sizeof (word_t) != 0) 
+            {
+              *--dst = *--src;
+              size--;
+            }
+          for (; size >= sizeof (word_t); size -= sizeof (word_t)) 
+            {
+              dst -= sizeof (word_t);
+              src -= sizeof (word_t);
+              *(word_t *) dst = *(const word_t *) src;
+            }
+        }
       while (size-- > 0)
         *--dst = *--src;
     }
 
-  return dst;
+  return dst_;
 }
 
 /* Find the first differing byte in the two blocks of SIZE bytes
@@ -58,6 +120,22 @@ memcmp (const void *a_, const void *b_, size_t size)
   ASSERT (a != NULL || size == 0);
   ASSERT (b != NULL || size == 0);
 
+  if (size >= WORD_THRESHOLD) 
+    {
+      /* Skip over equal words.  The first word that differs, if
+         any, is left for the byte loop to pin down. */
+      for (; size > 0 && word_align_cnt (a) != 0; a++, b++, size--)
+        if (*a != *b)
+          return *a > *b ? +1 : -1;
+      for (; size >= sizeof (word_t); size -= sizeof (word_t)) 
+        {
+          if (*(const word_t *) a != *(const word_t *) b)
+            break;
+          a += sizeof (word_t);
+          b += sizeof (word_t);
+        }
+    }
+
   for (; size-- > 0; a++, b++)
     if (*a != *b)
       return *a > *b ? +1 : -1;
@@ -281,6 +359,23 @@ memset (void *dst_, int value, size_t size)
   unsigned char *dst = dst_;
 
   ASSERT (dst != NULL || size == 0);
+
+  if (size >= WORD_THRESHOLD) 
+    {
+      size_t head = word_align_cnt (dst);
+      word_t pattern = (unsigned char) value * 0x01010101u;
+      size_t words;
+
+      size -= head;
+      while (head-- > 0)
+        *dst++ = value;
+      words = size / sizeof (word_t);
+      size %= sizeof (word_t);
+      asm volatile ("rep stosl"
+                    : "+D" (dst), "+c" (words)
+                    : "a" (pattern)
+                    : "memory");
+    }
   
   while (size-- > 0)
     *dst++ = value;
@@ -293,10 +388,25 @@ size_t
 strlen (const char *string) 
 {
   const char *p;
+  const word_t *w;
 
   ASSERT (string != NULL);
 
-  for (p = string; *p != '\0'; p++)
+  /* Check single bytes up to a word boundary. */
+  for (p = string; word_align_cnt (p) != 0; p++)
+    if (*p == '\0')
+      return p - string;
+
+  /* Then whole words.  (W - 0x01010101) & ~W has the high bit
+     set in some byte exactly when some byte of W is zero.
+     Aligned words never straddle a page boundary, so reading
+     past the terminator cannot fault. */
+  for (w = (const word_t *) p;
+       ((*w - 0x01010101u) & ~*w & 0x80808080u) == 0; w++)
+    continue;
+
+  /* Find the null byte within the word. */
+  for (p = (const char *) w; *p != '\0'; p++)
     continue;
   return p - string;
 }
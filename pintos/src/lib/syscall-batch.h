@@ -0,0 +1,15 @@
+#ifndef __LIB_SYSCALL_BATCH_H
+#define __LIB_SYSCALL_BATCH_H
+
+/* One system call in a batch passed to the batch system call. */
+struct syscall_batch_entry
+  {
+    int number;                 /* System call number. */
+    int args[3];                /* Arguments, as for the call itself. */
+    int result;                 /* Return value, set by the kernel. */
+  };
+
+/* Flags for the batch system call. */
+#define BATCH_STOP_ON_ERROR 0x1 /* Stop after the first call that fails. */
+
+#endif /* lib/syscall-batch.h */
@@ -28,7 +28,25 @@ enum
     SYS_MKDIR,                  /* Create a directory. */
     SYS_READDIR,                /* Reads a directory entry. */
     SYS_ISDIR,                  /* Tests if a fd represents a directory. */
-    SYS_INUMBER                 /* Returns the inode number for a fd. */
+    SYS_INUMBER,                /* Returns the inode number for a fd. */
+
+    /* Extensions. */
+    SYS_BATCH,                  /* Make several system calls at once. */
+    SYS_AIO_SETUP,              /* Register asynchronous I/O rings. */
+    SYS_AIO_ENTER,              /* Submit and complete asynchronous I/O. */
+    SYS_READV,                  /* Read from a file into several buffers. */
+    SYS_WRITEV,                 /* Write to a file from several buffers. */
+    SYS_DUP,                    /* Duplicate a file descriptor. */
+    SYS_DUP2,                   /* Duplicate onto a given descriptor. */
+    SYS_PIPE,                   /* Create a pipe. */
+    SYS_SHM_CREATE,             /* Create a shared memory segment. */
+    SYS_SHM_ATTACH,             /* Map a shared memory segment. */
+    SYS_SHM_DETACH,             /* Unmap a shared memory segment. */
+    SYS_FUTEX_WAIT,             /* Wait on a futex. */
+    SYS_FUTEX_WAKE,             /* Wake futex waiters. */
+    SYS_THREAD_CREATE,          /* Start a thread in this process. */
+    SYS_THREAD_JOIN,            /* Wait for a thread to end. */
+    SYS_THREAD_EXIT             /* End this thread. */
   };
 
 #endif /* lib/syscall-nr.h */
@@ -26,12 +26,17 @@ hprintf (int handle, const char *format, ...)
 }
 
 /* Writes string S to the console, followed by a new-line
-   character. */
+   character, in a single system call. */
 int
 puts (const char *s) 
 {
-  write (STDOUT_FILENO, s, strlen (s));
-  putchar ('\n');
+  struct iovec iov[2];
+
+  iov[0].iov_base = (char *) s;
+  iov[0].iov_len = strlen (s);
+  iov[1].iov_base = "\n";
+  iov[1].iov_len = 1;
+  writev (STDOUT_FILENO, iov, 2);
 
   return 0;
 }
@@ -48,7 +53,7 @@ putchar (int c)
 /* Auxiliary data for vhprintf_helper(). */
 struct vhprintf_aux 
   {
-    char buf[64];       /* Character buffer. */
+    char buf[256];      /* Character buffer. */
     char *p;            /* Current position in buffer. */
     int char_cnt;       /* Total characters written so far. */
     int handle;         /* Output file handle. */
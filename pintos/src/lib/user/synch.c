@@ -0,0 +1,140 @@
+#include <synch.h>
+#include <limits.h>
+#include <syscall.h>
+
+/* User-level synchronization built on futexes.
+
+   A mutex's state is 0 if it is unlocked, 1 if it is locked and
+   no thread is waiting for it, or 2 if it is locked and threads
+   may be waiting.  Locking an unlocked mutex and unlocking one
+   that nobody waits for are single atomic instructions and never
+   enter the kernel.  A thread that finds the mutex locked sets
+   the state to 2 and sleeps in futex_wait() until the holder,
+   seeing 2 on unlock, wakes it.  This is the mutex from Ulrich
+   Drepper's "Futexes Are Tricky".
+
+   A condition variable is a sequence number that each signal
+   increments.  A waiter samples the number before it releases the
+   mutex and sleeps only if the number has not changed since, so
+   a signal between the two is not lost. */
+
+/* Atomically replaces *P by NEW if it equals OLD, and returns the
+   value *P had. */
+static inline int
+cmpxchg (int *p, int old, int new)
+{
+  int prev;
+  asm volatile ("lock cmpxchgl %2, %1"
+                : "=a" (prev), "+m" (*p)
+                : "r" (new), "0" (old)
+                : "memory");
+  return prev;
+}
+
+/* Atomically replaces *P by NEW and returns the value *P had. */
+static inline int
+xchg (int *p, int new)
+{
+  asm volatile ("xchgl %0, %1"
+                : "+r" (new), "+m" (*p)
+                :
+                : "memory");
+  return new;
+}
+
+/* Atomically adds N to *P and returns the value *P had. */
+static inline int
+fetch_and_add (int *p, int n)
+{
+  asm volatile ("lock xaddl %0, %1"
+                : "+r" (n), "+m" (*p)
+                :
+                : "memory");
+  return n;
+}
+
+/* Initializes M as unlocked. */
+void
+mutex_init (struct mutex *m)
+{
+  m->state = 0;
+}
+
+/* Acquires M, sleeping until it is available if necessary. */
+void
+mutex_lock (struct mutex *m)
+{
+  int c = cmpxchg (&m->state, 0, 1);
+  if (c == 0)
+    return;
+
+  /* Contended.  Mark the mutex as having waiters, and sleep until
+     we take it in that state, because others may still be
+     waiting. */
+  if (c != 2)
+    c = xchg (&m->state, 2);
+  while (c != 0)
+    {
+      futex_wait (&m->state, 2);
+      c = xchg (&m->state, 2);
+    }
+}
+
+/* Acquires M if it is available without sleeping.  Returns true
+   if successful, false if M is already locked. */
+bool
+mutex_trylock (struct mutex *m)
+{
+  return cmpxchg (&m->state, 0, 1) == 0;
+}
+
+/* Releases M, which the caller must hold, waking a waiter if there
+   may be one. */
+void
+mutex_unlock (struct mutex *m)
+{
+  if (fetch_and_add (&m->state, -1) != 1)
+    {
+      m->state = 0;
+      futex_wake (&m->state, 1);
+    }
+}
+
+/* Initializes condition variable C. */
+void
+condvar_init (struct condvar *c)
+{
+  c->seq = 0;
+}
+
+/* Atomically releases M, which the caller must hold, and waits
+   for C to be signaled, then reacquires M.  As with any condition
+   variable, the caller must recheck its condition on return. */
+void
+condvar_wait (struct condvar *c, struct mutex *m)
+{
+  int seq = c->seq;
+
+  mutex_unlock (m);
+  futex_wait (&c->seq, seq);
+
+  /* Others may be waiting for M too, so take it in state 2. */
+  while (xchg (&m->state, 2) != 0)
+    futex_wait (&m->state, 2);
+}
+
+/* Wakes one thread waiting on C, if any. */
+void
+condvar_signal (struct condvar *c)
+{
+  fetch_and_add (&c->seq, 1);
+  futex_wake (&c->seq, 1);
+}
+
+/* Wakes every thread waiting on C. */
+void
+condvar_broadcast (struct condvar *c)
+{
+  fetch_and_add (&c->seq, 1);
+  futex_wake (&c->seq, UINT_MAX);
+}
@@ -0,0 +1,34 @@
+#ifndef __LIB_USER_SYNCH_H
+#define __LIB_USER_SYNCH_H
+
+#include <stdbool.h>
+
+/* User-level mutex.  Shared by the threads of a process, and by
+   processes if it lives in shared memory. */
+struct mutex
+  {
+    int state;                  /* 0=unlocked, 1=locked,
+                                   2=locked with possible waiters. */
+  };
+
+/* User-level condition variable. */
+struct condvar
+  {
+    int seq;                    /* Incremented by each signal. */
+  };
+
+/* Static initializers. */
+#define MUTEX_INITIALIZER {0}
+#define CONDVAR_INITIALIZER {0}
+
+void mutex_init (struct mutex *);
+void mutex_lock (struct mutex *);
+bool mutex_trylock (struct mutex *);
+void mutex_unlock (struct mutex *);
+
+void condvar_init (struct condvar *);
+void condvar_wait (struct condvar *, struct mutex *);
+void condvar_signal (struct condvar *);
+void condvar_broadcast (struct condvar *);
+
+#endif /* lib/user/synch.h */
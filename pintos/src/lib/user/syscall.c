@@ -1,31 +1,89 @@
 #include <syscall.h>
+#include <stddef.h>
 #include "../syscall-nr.h"
 
+/* Nonzero to enter the kernel by SYSENTER, zero for "int $0x30",
+   or -1 if not yet decided. */
+static int sep = -1;
+
+/* Returns nonzero if the CPU supports SYSENTER, which the kernel
+   then accepts as a faster way to make a system call than
+   "int $0x30".  Early Pentium Pro processors report SEP without
+   supporting it. */
+static int
+cpu_has_sep (void)
+{
+  unsigned eax = 1, ebx, ecx, edx;
+  unsigned family, model, stepping;
+
+  asm ("cpuid" : "+a" (eax), "=b" (ebx), "=c" (ecx), "=d" (edx));
+  family = (eax >> 8) & 0xf;
+  model = (eax >> 4) & 0xf;
+  stepping = eax & 0xf;
+  return (edx & 0x800) != 0 && !(family == 6 && model < 3 && stepping < 3);
+}
+
+/* Returns nonzero if system calls should enter the kernel by
+   SYSENTER, which by default they do whenever the CPU supports
+   it. */
+static int
+use_sysenter (void)
+{
+  if (sep < 0)
+    sep = cpu_has_sep ();
+  return sep;
+}
+
+/* Makes later system calls enter the kernel by SYSENTER if ENABLE
+   is true and the CPU supports it, and by "int $0x30" otherwise,
+   so that programs can compare the two.  Returns true if SYSENTER
+   is now in use. */
+bool
+syscall_use_sysenter (bool enable)
+{
+  sep = enable && cpu_has_sep ();
+  return sep;
+}
+
+/* Enters the kernel, with the system call number and arguments
+   on the stack, by SYSENTER if %[sep] is nonzero and otherwise by
+   "int $0x30", and then pops ARG_BYTES bytes of them.  SYSENTER
+   takes the stack pointer in %ecx and the address to return to in
+   %edx. */
+#define SYSCALL_TRAP(ARG_BYTES)                                 \
+        "testl %[sep], %[sep]; jz 1f; "                         \
+        "movl %%esp, %%ecx; movl $2f, %%edx; sysenter; "        \
+        "1: int $0x30; "                                        \
+        "2: addl $" #ARG_BYTES ", %%esp"
+
 /* Invokes syscall NUMBER, passing no arguments, and returns the
    return value as an `int'. */
 #define syscall0(NUMBER)                                        \
         ({                                                      \
           int retval;                                           \
           asm volatile                                          \
-            ("pushl %[number]; int $0x30; addl $4, %%esp"       \
+            ("pushl %[number]; " SYSCALL_TRAP (4)               \
                : "=a" (retval)                                  \
-               : [number] "i" (NUMBER)                          \
-               : "memory");                                     \
+               : [number] "i" (NUMBER),                         \
+                 [sep] "r" (use_sysenter ())                    \
+               : "ecx", "edx", "memory");                       \
           retval;                                               \
         })
 
 /* Invokes syscall NUMBER, passing argument ARG0, and returns the
    return value as an `int'. */
-#define syscall1(NUMBER, ARG0)                                           \
-        ({                                                               \
-          int retval;                                                    \
-          asm volatile                                                   \
-            ("pushl %[arg0]; pushl %[number]; int $0x30; addl $8, %%esp" \
-               : "=a" (retval)                                           \
-               : [number] "i" (NUMBER),                                  \
-                 [arg0] "g" (ARG0)                                       \
-               : "memory");                                              \
-          retval;                                                        \
+#define syscall1(NUMBER, ARG0)                                  \
+        ({                                                      \
+          int retval;                                           \
+          asm volatile                                          \
+            ("pushl %[arg0]; pushl %[number]; "                 \
+             SYSCALL_TRAP (8)                                   \
+               : "=a" (retval)                                  \
+               : [number] "i" (NUMBER),                         \
+                 [arg0] "g" (ARG0),                             \
+                 [sep] "r" (use_sysenter ())                    \
+               : "ecx", "edx", "memory");                       \
+          retval;                                               \
         })
 
 /* Invokes syscall NUMBER, passing arguments ARG0 and ARG1, and
@@ -35,12 +93,13 @@
           int retval;                                           \
           asm volatile                                          \
             ("pushl %[arg1]; pushl %[arg0]; "                   \
-             "pushl %[number]; int $0x30; addl $12, %%esp"      \
+             "pushl %[number]; " SYSCALL_TRAP (12)              \
                : "=a" (retval)                                  \
                : [number] "i" (NUMBER),                         \
                  [arg0] "g" (ARG0),                             \
-                 [arg1] "g" (ARG1)                              \
-               : "memory");                                     \
+                 [arg1] "g" (ARG1),                             \
+                 [sep] "r" (use_sysenter ())                    \
+               : "ecx", "edx", "memory");                       \
           retval;                                               \
         })
 
@@ -51,13 +110,14 @@
           int retval;                                           \
           asm volatile                                          \
             ("pushl %[arg2]; pushl %[arg1]; pushl %[arg0]; "    \
-             "pushl %[number]; int $0x30; addl $16, %%esp"      \
+             "pushl %[number]; " SYSCALL_TRAP (16)              \
                : "=a" (retval)                                  \
                : [number] "i" (NUMBER),                         \
                  [arg0] "g" (ARG0),                             \
                  [arg1] "g" (ARG1),                             \
-                 [arg2] "g" (ARG2)                              \
-               : "memory");                                     \
+                 [arg2] "g" (ARG2),                             \
+                 [sep] "r" (use_sysenter ())                    \
+               : "ecx", "edx", "memory");                       \
           retval;                                               \
         })
 
@@ -182,3 +242,301 @@ inumber (int fd)
 {
   return syscall1 (SYS_INUMBER, fd);
 }
+
+int
+batch (struct syscall_batch_entry *entries, unsigned cnt, unsigned flags)
+{
+  return syscall3 (SYS_BATCH, entries, cnt, flags);
+}
+
+int
+aio_setup (struct aio_ring *ring)
+{
+  return syscall1 (SYS_AIO_SETUP, ring);
+}
+
+int
+aio_enter (unsigned to_submit, unsigned min_complete)
+{
+  return syscall2 (SYS_AIO_ENTER, to_submit, min_complete);
+}
+
+int
+readv (int fd, const struct iovec *iov, unsigned iovcnt)
+{
+  return syscall3 (SYS_READV, fd, iov, iovcnt);
+}
+
+int
+writev (int fd, const struct iovec *iov, unsigned iovcnt)
+{
+  return syscall3 (SYS_WRITEV, fd, iov, iovcnt);
+}
+
+int
+dup (int fd)
+{
+  return syscall1 (SYS_DUP, fd);
+}
+
+int
+dup2 (int old_fd, int new_fd)
+{
+  return syscall2 (SYS_DUP2, old_fd, new_fd);
+}
+
+bool
+pipe (int fds[2])
+{
+  return pipe2 (fds, 0);
+}
+
+bool
+pipe2 (int fds[2], unsigned flags)
+{
+  return syscall2 (SYS_PIPE, fds, flags) == 0;
+}
+
+int
+shm_create (unsigned page_cnt)
+{
+  return syscall1 (SYS_SHM_CREATE, page_cnt);
+}
+
+void *
+shm_attach (int id, void *addr)
+{
+  return (void *) syscall2 (SYS_SHM_ATTACH, id, addr);
+}
+
+bool
+shm_detach (void *addr)
+{
+  return syscall1 (SYS_SHM_DETACH, addr);
+}
+
+int
+futex_wait (int *addr, int expected)
+{
+  return syscall2 (SYS_FUTEX_WAIT, addr, expected);
+}
+
+int
+futex_wake (int *addr, unsigned cnt)
+{
+  return syscall2 (SYS_FUTEX_WAKE, addr, cnt);
+}
+
+/* Where a thread started by thread_create() begins.  The kernel
+   sets up the new thread's stack as if for a call to
+   thread_start(FUNC, AUX) that has no return address, so this
+   function must never return. */
+static void NO_RETURN
+thread_start (thread_func *func, void *aux)
+{
+  func (aux);
+  thread_exit ();
+}
+
+tid_t
+thread_create (thread_func *func, void *aux)
+{
+  return syscall3 (SYS_THREAD_CREATE, thread_start, func, aux);
+}
+
+bool
+thread_join (tid_t tid)
+{
+  return syscall1 (SYS_THREAD_JOIN, tid);
+}
+
+void
+thread_exit (void)
+{
+  syscall0 (SYS_THREAD_EXIT);
+  NOT_REACHED ();
+}
+
+/* Initializes B as an empty batch of system calls that will be
+   stored in ENTRIES, which has room for MAX calls. */
+void
+batch_init (struct batch *b, struct syscall_batch_entry *entries,
+            unsigned max)
+{
+  b->entries = entries;
+  b->cnt = 0;
+  b->max = max;
+}
+
+/* Appends system call NUMBER with the given arguments to B.
+   Returns the call's index in B, or -1 if B is full. */
+int
+batch_add (struct batch *b, int number, int arg0, int arg1, int arg2)
+{
+  struct syscall_batch_entry *e;
+
+  if (b->cnt >= b->max)
+    return -1;
+  e = &b->entries[b->cnt];
+  e->number = number;
+  e->args[0] = arg0;
+  e->args[1] = arg1;
+  e->args[2] = arg2;
+  e->result = 0;
+  return b->cnt++;
+}
+
+/* Appends read(FD, BUFFER, LENGTH) to B. */
+int
+batch_add_read (struct batch *b, int fd, void *buffer, unsigned length)
+{
+  return batch_add (b, SYS_READ, fd, (int) buffer, length);
+}
+
+/* Appends write(FD, BUFFER, LENGTH) to B. */
+int
+batch_add_write (struct batch *b, int fd, const void *buffer,
+                 unsigned length)
+{
+  return batch_add (b, SYS_WRITE, fd, (int) buffer, length);
+}
+
+/* Appends seek(FD, POSITION) to B. */
+int
+batch_add_seek (struct batch *b, int fd, unsigned position)
+{
+  return batch_add (b, SYS_SEEK, fd, position, 0);
+}
+
+/* Appends close(FD) to B. */
+int
+batch_add_close (struct batch *b, int fd)
+{
+  return batch_add (b, SYS_CLOSE, fd, 0, 0);
+}
+
+/* Makes the system calls in B, in order, in a single system call,
+   passing FLAGS to batch().  Returns the number of calls made.
+   Empties B, but leaves each call's result in place for
+   batch_result(). */
+int
+batch_run (struct batch *b, unsigned flags)
+{
+  int made = batch (b->entries, b->cnt, flags);
+  b->cnt = 0;
+  return made;
+}
+
+/* Returns the result of the call at index IDX in B, from the last
+   batch_run(). */
+int
+batch_result (const struct batch *b, int idx)
+{
+  return b->entries[idx].result;
+}
+
+/* Initializes RING to use SQ_ENTRIES submission slots in SQES and
+   CQ_ENTRIES completion slots in CQES, each a power of 2, and
+   registers it with the kernel.  Returns 0 if successful, -1 on
+   failure. */
+int
+aio_ring_init (struct aio_ring *ring, struct aio_sqe *sqes,
+               unsigned sq_entries, struct aio_cqe *cqes,
+               unsigned cq_entries)
+{
+  ring->sq_head = ring->sq_tail = 0;
+  ring->cq_head = ring->cq_tail = 0;
+  ring->sq_entries = sq_entries;
+  ring->cq_entries = cq_entries;
+  ring->sqes = sqes;
+  ring->cqes = cqes;
+  return aio_setup (ring);
+}
+
+/* Returns the next free submission slot in RING, or a null pointer
+   if RING's submission queue is full. */
+struct aio_sqe *
+aio_get_sqe (struct aio_ring *ring)
+{
+  if (ring->sq_tail - ring->sq_head >= ring->sq_entries)
+    return NULL;
+  return &ring->sqes[ring->sq_tail & (ring->sq_entries - 1)];
+}
+
+/* Fills in SQE, obtained from aio_get_sqe(), and queues it in
+   RING. */
+static void
+prep (struct aio_ring *ring, struct aio_sqe *sqe, int op, int fd, void *buffer,
+      unsigned length, unsigned offset, unsigned user_data)
+{
+  sqe->op = op;
+  sqe->fd = fd;
+  sqe->buf = buffer;
+  sqe->len = length;
+  sqe->offset = offset;
+  sqe->user_data = user_data;
+  ring->sq_tail++;
+}
+
+/* Queues a read of LENGTH bytes at OFFSET in FD into BUFFER. */
+void
+aio_prep_read (struct aio_ring *ring, struct aio_sqe *sqe, int fd,
+               void *buffer, unsigned length, unsigned offset,
+               unsigned user_data)
+{
+  prep (ring, sqe, AIO_READ, fd, buffer, length, offset, user_data);
+}
+
+/* Queues a write of LENGTH bytes from BUFFER at OFFSET in FD. */
+void
+aio_prep_write (struct aio_ring *ring, struct aio_sqe *sqe, int fd,
+                const void *buffer, unsigned length, unsigned offset,
+                unsigned user_data)
+{
+  prep (ring, sqe, AIO_WRITE, fd, (void *) buffer, length, offset,
+        user_data);
+}
+
+/* Queues an fsync of FD, which completes after every earlier
+   request on FD. */
+void
+aio_prep_fsync (struct aio_ring *ring, struct aio_sqe *sqe, int fd,
+                unsigned user_data)
+{
+  prep (ring, sqe, AIO_FSYNC, fd, NULL, 0, 0, user_data);
+}
+
+/* Hands the kernel every request queued in RING, without waiting.
+   Returns the number of completions posted, or -1 on failure. */
+int
+aio_submit (struct aio_ring *ring)
+{
+  return aio_enter (ring->sq_tail - ring->sq_head, 0);
+}
+
+/* Hands the kernel every request queued in RING and waits until
+   at least MIN_COMPLETE have completed.  Returns the number of
+   completions posted, or -1 on failure. */
+int
+aio_wait (struct aio_ring *ring, unsigned min_complete)
+{
+  return aio_enter (ring->sq_tail - ring->sq_head, min_complete);
+}
+
+/* Returns the oldest completion in RING not yet marked seen, or a
+   null pointer if there is none. */
+struct aio_cqe *
+aio_peek_cqe (struct aio_ring *ring)
+{
+  if (ring->cq_head == ring->cq_tail)
+    return NULL;
+  return &ring->cqes[ring->cq_head & (ring->cq_entries - 1)];
+}
+
+/* Marks the completion returned by aio_peek_cqe() as seen, freeing
+   its slot for the kernel. */
+void
+aio_cqe_seen (struct aio_ring *ring)
+{
+  ring->cq_head++;
+}
@@ -3,11 +3,22 @@
 
 #include <stdbool.h>
 #include <debug.h>
+#include <aio.h>
+#include <iovec.h>
+#include <pipe.h>
+#include <syscall-batch.h>
 
 /* Process identifier. */
 typedef int pid_t;
 #define PID_ERROR ((pid_t) -1)
 
+/* Thread identifier. */
+typedef int tid_t;
+#define TID_ERROR ((tid_t) -1)
+
+/* Function run by a thread started with thread_create(). */
+typedef void thread_func (void *aux);
+
 /* Map region identifier. */
 typedef int mapid_t;
 #define MAP_FAILED ((mapid_t) -1)
@@ -45,4 +56,64 @@ bool readdir (int fd, char name[READDIR_MAX_LEN + 1]);
 bool isdir (int fd);
 int inumber (int fd);
 
+/* Extensions. */
+int batch (struct syscall_batch_entry *, unsigned cnt, unsigned flags);
+int aio_setup (struct aio_ring *);
+int aio_enter (unsigned to_submit, unsigned min_complete);
+int readv (int fd, const struct iovec *, unsigned iovcnt);
+int writev (int fd, const struct iovec *, unsigned iovcnt);
+int dup (int fd);
+int dup2 (int old_fd, int new_fd);
+bool pipe (int fds[2]);
+bool pipe2 (int fds[2], unsigned flags);
+int shm_create (unsigned page_cnt);
+void *shm_attach (int id, void *addr);
+bool shm_detach (void *addr);
+int futex_wait (int *addr, int expected);
+int futex_wake (int *addr, unsigned cnt);
+tid_t thread_create (thread_func *, void *aux);
+bool thread_join (tid_t);
+void thread_exit (void) NO_RETURN;
+bool syscall_use_sysenter (bool enable);
+
+/* Helpers for building and running batches of system calls.
+   Each batch_add*() function appends a call and returns its index
+   in the batch, whose result may be read after batch_run(), or -1
+   if the batch is full. */
+struct batch
+  {
+    struct syscall_batch_entry *entries; /* Calls. */
+    unsigned cnt;               /* Number of calls in ENTRIES. */
+    unsigned max;               /* Capacity of ENTRIES. */
+  };
+
+void batch_init (struct batch *, struct syscall_batch_entry *, unsigned max);
+int batch_add (struct batch *, int number, int arg0, int arg1, int arg2);
+int batch_add_read (struct batch *, int fd, void *buffer, unsigned length);
+int batch_add_write (struct batch *, int fd, const void *buffer,
+                     unsigned length);
+int batch_add_seek (struct batch *, int fd, unsigned position);
+int batch_add_close (struct batch *, int fd);
+int batch_run (struct batch *, unsigned flags);
+int batch_result (const struct batch *, int idx);
+
+/* Helpers for asynchronous file I/O.  aio_get_sqe() returns the
+   next free submission slot, or a null pointer if the submission
+   ring is full; once filled in, aio_prep_*() makes it visible to
+   the kernel at the next aio_submit(). */
+int aio_ring_init (struct aio_ring *, struct aio_sqe *, unsigned sq_entries,
+                   struct aio_cqe *, unsigned cq_entries);
+struct aio_sqe *aio_get_sqe (struct aio_ring *);
+void aio_prep_read (struct aio_ring *, struct aio_sqe *, int fd, void *buffer,
+                    unsigned length, unsigned offset, unsigned user_data);
+void aio_prep_write (struct aio_ring *, struct aio_sqe *, int fd,
+                     const void *buffer, unsigned length, unsigned offset,
+                     unsigned user_data);
+void aio_prep_fsync (struct aio_ring *, struct aio_sqe *, int fd,
+                     unsigned user_data);
+int aio_submit (struct aio_ring *);
+int aio_wait (struct aio_ring *, unsigned min_complete);
+struct aio_cqe *aio_peek_cqe (struct aio_ring *);
+void aio_cqe_seen (struct aio_ring *);
+
 #endif /* lib/user/syscall.h */
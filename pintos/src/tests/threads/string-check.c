@@ -0,0 +1,243 @@
+/* Checks memcpy(), memmove(), memset(), memcmp(), and strlen()
+   in lib/string.c against the byte-at-a-time reference versions
+   in string-ref.c.  Every function is tried with each alignment
+   of its operands relative to a word boundary, and with sizes on
+   both sides of the point where it switches to whole words,
+   including every length of the trailing partial word.  memmove()
+   is tried with its operands overlapping in both directions.
+   Bytes around each destination are checked too, to catch
+   writes outside the block. */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "tests/threads/string-ref.h"
+#include "tests/threads/tests.h"
+
+/* Operand offsets from a word boundary that are tried. */
+#define ALIGN_CNT 8
+
+/* Largest size tried, in bytes. */
+#define MAX_SIZE 4096
+
+/* Bytes checked on either side of each destination block. */
+#define SLACK 32
+
+/* Bytes in each buffer. */
+#define BUF_SIZE (MAX_SIZE + ALIGN_CNT + 2 * SLACK)
+
+/* Word-aligned buffers. */
+static uint8_t buf_a[BUF_SIZE] __attribute__ ((aligned (16)));
+static uint8_t buf_b[BUF_SIZE] __attribute__ ((aligned (16)));
+static uint8_t buf_ref[BUF_SIZE] __attribute__ ((aligned (16)));
+
+/* Sizes beyond the first SMALL_SIZE_CNT, which are all tried. */
+#define SMALL_SIZE_CNT 41
+static const size_t big_sizes[] =
+  {63, 64, 65, 127, 128, 129, 255, 256, 257,
+   1023, 1024, 1025, 4093, 4094, 4095, 4096};
+#define SIZE_CNT (SMALL_SIZE_CNT + sizeof big_sizes / sizeof *big_sizes)
+
+/* Returns the Ith size to try. */
+static size_t
+test_size (size_t i)
+{
+  return i < SMALL_SIZE_CNT ? i : big_sizes[i - SMALL_SIZE_CNT];
+}
+
+/* Fills the first SIZE bytes of BUF with a pattern, selected by
+   SEED, of nonzero bytes that include every bit pattern that
+   matters to strlen()'s zero-byte test. */
+static void
+fill (uint8_t *buf, size_t size, int seed)
+{
+  size_t i;
+
+  for (i = 0; i < size; i++)
+    buf[i] = (i * 131 + seed) % 255 + 1;
+}
+
+/* Returns -1, 0, or +1 according to the sign of X. */
+static int
+sign (int x)
+{
+  return (x > 0) - (x < 0);
+}
+
+static void
+check_memcpy (void)
+{
+  int dst_align, src_align;
+  size_t i;
+
+  msg ("memcpy");
+  for (dst_align = 0; dst_align < ALIGN_CNT; dst_align++)
+    for (src_align = 0; src_align < ALIGN_CNT; src_align++)
+      for (i = 0; i < SIZE_CNT; i++)
+        {
+          size_t size = test_size (i);
+          size_t len = size + ALIGN_CNT + 2 * SLACK;
+          uint8_t *src = buf_a + SLACK + src_align;
+          void *result;
+
+          fill (buf_a, len, 1);
+          fill (buf_b, len, 2);
+          fill (buf_ref, len, 2);
+          result = memcpy (buf_b + SLACK + dst_align, src, size);
+          byte_memcpy (buf_ref + SLACK + dst_align, src, size);
+          if (result != buf_b + SLACK + dst_align
+              || byte_memcmp (buf_b, buf_ref, len) != 0)
+            fail ("memcpy: size %zu, dst align %d, src align %d",
+                  size, dst_align, src_align);
+        }
+}
+
+static void
+check_memmove (void)
+{
+  int src_align, delta;
+  size_t i;
+
+  msg ("memmove");
+  for (src_align = 0; src_align < ALIGN_CNT; src_align++)
+    for (delta = -(ALIGN_CNT + 1); delta <= ALIGN_CNT + 1; delta++)
+      for (i = 0; i < SIZE_CNT; i++)
+        {
+          size_t size = test_size (i);
+          size_t len = size + ALIGN_CNT + 2 * SLACK;
+          size_t src_ofs = SLACK + src_align;
+          void *result;
+
+          /* DELTA < 0 copies downward, so the destination overlaps
+             the start of the source; DELTA > 0 copies upward, so
+             it overlaps the end. */
+          fill (buf_b, len, 3);
+          fill (buf_ref, len, 3);
+          result = memmove (buf_b + src_ofs + delta, buf_b + src_ofs, size);
+          byte_memmove (buf_ref + src_ofs + delta, buf_ref + src_ofs, size);
+          if (result != buf_b + src_ofs + delta
+              || byte_memcmp (buf_b, buf_ref, len) != 0)
+            fail ("memmove: size %zu, src align %d, delta %d",
+                  size, src_align, delta);
+        }
+}
+
+static void
+check_memset (void)
+{
+  static const int values[] = {0, 0x5a, 0xff, 0x1a5, -1};
+  int dst_align;
+  size_t i, j;
+
+  msg ("memset");
+  for (dst_align = 0; dst_align < ALIGN_CNT; dst_align++)
+    for (i = 0; i < SIZE_CNT; i++)
+      for (j = 0; j < sizeof values / sizeof *values; j++)
+        {
+          size_t size = test_size (i);
+          size_t len = size + ALIGN_CNT + 2 * SLACK;
+          void *result;
+
+          fill (buf_b, len, 4);
+          fill (buf_ref, len, 4);
+          result = memset (buf_b + SLACK + dst_align, values[j], size);
+          byte_memset (buf_ref + SLACK + dst_align, values[j], size);
+          if (result != buf_b + SLACK + dst_align
+              || byte_memcmp (buf_b, buf_ref, len) != 0)
+            fail ("memset: size %zu, dst align %d, value %#x",
+                  size, dst_align, values[j]);
+        }
+}
+
+/* Compares SIZE bytes at A and B with memcmp() and
+   byte_memcmp(), and fails if the signs of the results
+   differ. */
+static void
+compare_memcmp (const uint8_t *a, const uint8_t *b, size_t size,
+                int a_align, int b_align, const char *what)
+{
+  if (sign (memcmp (a, b, size)) != sign (byte_memcmp (a, b, size)))
+    fail ("memcmp: size %zu, a align %d, b align %d, %s",
+          size, a_align, b_align, what);
+}
+
+static void
+check_memcmp (void)
+{
+  /* Pairs of differing bytes.  The first pair differs only in
+     the high bit, which catches signed comparisons. */
+  static const uint8_t diffs[][2] =
+    {{0x90, 0x10}, {0x10, 0x90}, {0x41, 0x42}, {0x42, 0x41}};
+  int a_align, b_align;
+  size_t i, j;
+
+  msg ("memcmp");
+  for (a_align = 0; a_align < ALIGN_CNT; a_align++)
+    for (b_align = 0; b_align < ALIGN_CNT; b_align++)
+      for (i = 0; i < SIZE_CNT; i++)
+        {
+          size_t size = test_size (i);
+          uint8_t *a = buf_a + SLACK + a_align;
+          uint8_t *b = buf_b + SLACK + b_align;
+          size_t positions[3];
+
+          fill (a, size, 5);
+          fill (b, size, 5);
+          compare_memcmp (a, b, size, a_align, b_align, "equal");
+          if (size == 0)
+            continue;
+
+          /* Differ at the first byte, a middle byte, or only the
+             last byte. */
+          positions[0] = 0;
+          positions[1] = size / 2;
+          positions[2] = size - 1;
+          for (j = 0; j < 3 * sizeof diffs / sizeof *diffs; j++)
+            {
+              size_t pos = positions[j % 3];
+              const uint8_t *diff = diffs[j / 3];
+              uint8_t old_a = a[pos], old_b = b[pos];
+
+              a[pos] = diff[0];
+              b[pos] = diff[1];
+              compare_memcmp (a, b, size, a_align, b_align,
+                              pos == size - 1 ? "last byte differs"
+                              : pos == 0 ? "first byte differs"
+                              : "middle byte differs");
+              a[pos] = old_a;
+              b[pos] = old_b;
+            }
+        }
+}
+
+static void
+check_strlen (void)
+{
+  int align;
+  size_t i;
+
+  msg ("strlen");
+  for (align = 0; align < ALIGN_CNT; align++)
+    for (i = 0; i < SIZE_CNT; i++)
+      {
+        size_t length = test_size (i);
+        size_t len = length + ALIGN_CNT + 2 * SLACK;
+        char *s = (char *) buf_a + SLACK + align;
+
+        fill (buf_a, len, 6);
+        s[length] = '\0';
+        if (strlen (s) != length || byte_strlen (s) != length)
+          fail ("strlen: length %zu, align %d", length, align);
+      }
+}
+
+void
+test_string_check (void)
+{
+  check_memcpy ();
+  check_memmove ();
+  check_memset ();
+  check_memcmp ();
+  check_strlen ();
+  pass ();
+}
@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(string-check) begin
+(string-check) memcpy
+(string-check) memmove
+(string-check) memset
+(string-check) memcmp
+(string-check) strlen
+(string-check) PASS
+(string-check) end
+EOF
+pass;
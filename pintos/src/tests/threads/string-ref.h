@@ -0,0 +1,15 @@
+#ifndef TESTS_THREADS_STRING_REF_H
+#define TESTS_THREADS_STRING_REF_H
+
+#include <debug.h>
+#include <stddef.h>
+
+/* Byte-at-a-time reference versions of the block and string
+   functions in lib/string.c. */
+void *byte_memcpy (void *, const void *, size_t) NO_INLINE;
+void *byte_memmove (void *, const void *, size_t) NO_INLINE;
+void *byte_memset (void *, int, size_t) NO_INLINE;
+int byte_memcmp (const void *, const void *, size_t) NO_INLINE;
+size_t byte_strlen (const char *) NO_INLINE;
+
+#endif /* tests/threads/string-ref.h */
@@ -0,0 +1,98 @@
+/* Microbenchmark for the block and string functions in
+   lib/string.c.  For a range of sizes, times memcpy(), memmove(),
+   memset(), memcmp(), and strlen() against simple byte-at-a-time
+   reference versions and prints the average number of CPU cycles
+   per call for each.
+
+   This test only reports timings; it has no expected output and
+   is not part of the graded test suite.  Run it with
+   "pintos -- run string-speed".  The string-check test verifies
+   that the two versions agree. */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "tests/threads/string-ref.h"
+#include "tests/threads/tests.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+
+/* Number of calls timed for each function and size. */
+#define ITERATIONS 256
+
+/* Largest size timed, in bytes. */
+#define MAX_SIZE 4096
+
+/* Receives the results of memcmp() and strlen() so that the
+   compiler cannot discard calls whose value is otherwise
+   unused. */
+static volatile size_t sink;
+
+/* Times ITERATIONS calls of OLD_CALL and then of NEW_CALL and
+   prints the average cycle count per call of each. */
+#define TIME(NAME, OLD_CALL, NEW_CALL)                          \
+  do                                                            \
+    {                                                           \
+      uint64_t start = rdtsc ();                                \
+      for (j = 0; j < ITERATIONS; j++)                          \
+        OLD_CALL;                                               \
+      old_cycles = rdtsc () - start;                            \
+      start = rdtsc ();                                         \
+      for (j = 0; j < ITERATIONS; j++)                          \
+        NEW_CALL;                                               \
+      new_cycles = rdtsc () - start;                            \
+      msg ("%-8s %5zu %10llu %10llu", NAME, size,               \
+           old_cycles / ITERATIONS, new_cycles / ITERATIONS);   \
+    }                                                           \
+  while (0)
+
+/* Returns the CPU's time-stamp counter.
+   See [IA32-v2b] "RDTSC--Read Time-Stamp Counter". */
+static inline uint64_t
+rdtsc (void)
+{
+  uint64_t tsc;
+  asm volatile ("rdtsc" : "=A" (tsc));
+  return tsc;
+}
+
+void
+test_string_speed (void)
+{
+  static const size_t sizes[] = {4, 16, 64, 256, 1024, 4096};
+  uint8_t *src, *dst;
+  size_t i;
+
+  /* DST starts one byte past a word boundary so that the
+     alignment prologue of each function is exercised. */
+  src = palloc_get_multiple (PAL_ASSERT, 2 * MAX_SIZE / PGSIZE + 1);
+  dst = src + MAX_SIZE + 1;
+  memset (src, 'x', MAX_SIZE);
+
+  msg ("%-8s %5s %10s %10s", "function", "bytes", "byte loop", "lib");
+  for (i = 0; i < sizeof sizes / sizeof *sizes; i++)
+    {
+      size_t size = sizes[i];
+      uint64_t old_cycles, new_cycles;
+      int j;
+
+      TIME ("memcpy", byte_memcpy (dst, src, size),
+            memcpy (dst, src, size));
+      TIME ("memmove", byte_memmove (src + 1, src, size - 1),
+            memmove (src + 1, src, size - 1));
+      TIME ("memset", byte_memset (dst, j, size),
+            memset (dst, j, size));
+      /* Equal blocks, so that memcmp() compares them in full. */
+      memcpy (dst, src, size);
+      TIME ("memcmp", sink = byte_memcmp (dst, src, size),
+            sink = memcmp (dst, src, size));
+
+      src[size - 1] = '\0';
+      TIME ("strlen", sink = byte_strlen ((char *) src),
+            sink = strlen ((char *) src));
+      src[size - 1] = 'x';
+    }
+
+  palloc_free_multiple (src, 2 * MAX_SIZE / PGSIZE + 1);
+  pass ();
+}
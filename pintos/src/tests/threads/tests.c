@@ -38,6 +38,8 @@ static const struct test tests[] =
     {"mlfqs-nice-2", test_mlfqs_nice_2},
     {"mlfqs-nice-10", test_mlfqs_nice_10},
     {"mlfqs-block", test_mlfqs_block},
+    {"string-speed", test_string_speed},
+    {"string-check", test_string_check},
   };
 
 static const char *test_name;
@@ -0,0 +1,13 @@
+/* Passes a bad pointer to the aio_setup system call, which must
+   cause the process to be terminated with exit code -1. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void)
+{
+  msg ("aio_setup(0x20101234): %d",
+       aio_setup ((struct aio_ring *) 0x20101234));
+}
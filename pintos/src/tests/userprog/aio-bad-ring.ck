@@ -0,0 +1,9 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(aio-bad-ring) begin
+aio-bad-ring: exit(-1)
+EOF
+pass;
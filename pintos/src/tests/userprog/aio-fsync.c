@@ -0,0 +1,61 @@
+/* Queues several asynchronous writes to a file followed by an
+   AIO_FSYNC on the same file descriptor, and checks that the
+   fsync's completion is posted only after every write's and
+   that the file then holds what was written. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define WRITE_CNT 8
+#define BLOCK_SIZE 512
+#define FSYNC_ID WRITE_CNT
+
+static struct aio_sqe sqes[16];
+static struct aio_cqe cqes[16];
+static struct aio_ring ring;
+static char data[WRITE_CNT * BLOCK_SIZE];
+
+void
+test_main (void)
+{
+  struct aio_cqe *cqe;
+  int fd, i, write_cnt;
+  size_t ofs;
+
+  for (ofs = 0; ofs < sizeof data; ofs++)
+    data[ofs] = ofs % 251;
+  CHECK (create ("data", sizeof data), "create \"data\"");
+  CHECK ((fd = open ("data")) > 1, "open \"data\"");
+  CHECK (aio_ring_init (&ring, sqes, 16, cqes, 16) == 0, "aio_ring_init");
+
+  for (i = 0; i < WRITE_CNT; i++)
+    aio_prep_write (&ring, aio_get_sqe (&ring), fd, data + i * BLOCK_SIZE,
+                    BLOCK_SIZE, i * BLOCK_SIZE, i);
+  aio_prep_fsync (&ring, aio_get_sqe (&ring), fd, FSYNC_ID);
+  CHECK (aio_wait (&ring, WRITE_CNT + 1) == WRITE_CNT + 1,
+         "%d writes and an fsync", WRITE_CNT);
+
+  write_cnt = 0;
+  while ((cqe = aio_peek_cqe (&ring)) != NULL)
+    {
+      if (cqe->user_data == FSYNC_ID)
+        {
+          if (write_cnt != WRITE_CNT)
+            fail ("fsync completed after only %d of %d writes",
+                  write_cnt, WRITE_CNT);
+          if (cqe->result != 0)
+            fail ("fsync: result %d, expected 0", cqe->result);
+        }
+      else if (cqe->result != BLOCK_SIZE)
+        fail ("write %u: result %d, expected %d",
+              cqe->user_data, cqe->result, BLOCK_SIZE);
+      else
+        write_cnt++;
+      aio_cqe_seen (&ring);
+    }
+  msg ("fsync completed after all writes");
+  close (fd);
+
+  check_file ("data", data, sizeof data);
+}
@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(aio-fsync) begin
+(aio-fsync) create "data"
+(aio-fsync) open "data"
+(aio-fsync) aio_ring_init
+(aio-fsync) 8 writes and an fsync
+(aio-fsync) fsync completed after all writes
+(aio-fsync) open "data" for verification
+(aio-fsync) verified contents of "data"
+(aio-fsync) close "data"
+(aio-fsync) end
+aio-fsync: exit(0)
+EOF
+pass;
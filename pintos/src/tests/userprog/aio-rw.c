@@ -0,0 +1,69 @@
+/* Writes two blocks of a file with asynchronous positional
+   writes, reads them back with asynchronous positional reads,
+   and checks that neither changes the file position. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define BLOCK_SIZE 512
+
+static struct aio_sqe sqes[4];
+static struct aio_cqe cqes[4];
+static struct aio_ring ring;
+static char blocks[2][BLOCK_SIZE];
+static char readback[2][BLOCK_SIZE];
+
+/* Takes the 2 completions in RING, checking that each is for a
+   different block and transferred all of it. */
+static void
+check_completions (void)
+{
+  bool seen[2] = {false, false};
+  struct aio_cqe *cqe;
+
+  while ((cqe = aio_peek_cqe (&ring)) != NULL)
+    {
+      if (cqe->user_data > 1 || seen[cqe->user_data])
+        fail ("unexpected completion %u", cqe->user_data);
+      if (cqe->result != BLOCK_SIZE)
+        fail ("block %u: result %d, expected %d",
+              cqe->user_data, cqe->result, BLOCK_SIZE);
+      seen[cqe->user_data] = true;
+      aio_cqe_seen (&ring);
+    }
+  if (!seen[0] || !seen[1])
+    fail ("missing completion");
+}
+
+void
+test_main (void)
+{
+  int fd;
+
+  memset (blocks[0], 'a', BLOCK_SIZE);
+  memset (blocks[1], 'b', BLOCK_SIZE);
+  CHECK (create ("data", sizeof blocks), "create \"data\"");
+  CHECK ((fd = open ("data")) > 1, "open \"data\"");
+  CHECK (aio_ring_init (&ring, sqes, 4, cqes, 4) == 0, "aio_ring_init");
+
+  aio_prep_write (&ring, aio_get_sqe (&ring), fd, blocks[1], BLOCK_SIZE,
+                  BLOCK_SIZE, 1);
+  aio_prep_write (&ring, aio_get_sqe (&ring), fd, blocks[0], BLOCK_SIZE,
+                  0, 0);
+  CHECK (aio_wait (&ring, 2) == 2, "write 2 blocks");
+  check_completions ();
+
+  aio_prep_read (&ring, aio_get_sqe (&ring), fd, readback[0], BLOCK_SIZE,
+                 0, 0);
+  aio_prep_read (&ring, aio_get_sqe (&ring), fd, readback[1], BLOCK_SIZE,
+                 BLOCK_SIZE, 1);
+  CHECK (aio_wait (&ring, 2) == 2, "read 2 blocks");
+  check_completions ();
+  compare_bytes (readback[0], blocks[0], BLOCK_SIZE, 0, "data");
+  compare_bytes (readback[1], blocks[1], BLOCK_SIZE, BLOCK_SIZE, "data");
+
+  CHECK (tell (fd) == 0, "file position unchanged");
+  close (fd);
+}
@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(aio-rw) begin
+(aio-rw) create "data"
+(aio-rw) open "data"
+(aio-rw) aio_ring_init
+(aio-rw) write 2 blocks
+(aio-rw) read 2 blocks
+(aio-rw) file position unchanged
+(aio-rw) end
+aio-rw: exit(0)
+EOF
+pass;
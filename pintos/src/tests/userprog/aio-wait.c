@@ -0,0 +1,76 @@
+/* Checks that aio_enter() returns at once when nothing is in
+   flight, and otherwise waits until at least MIN_COMPLETE
+   requests have completed. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define REQUEST_CNT 4
+#define BLOCK_SIZE 512
+
+static struct aio_sqe sqes[REQUEST_CNT];
+static struct aio_cqe cqes[REQUEST_CNT];
+static struct aio_ring ring;
+static char buf[REQUEST_CNT][BLOCK_SIZE];
+
+/* Queues REQUEST_CNT reads of FD in RING. */
+static void
+queue_reads (int fd)
+{
+  int i;
+
+  for (i = 0; i < REQUEST_CNT; i++)
+    aio_prep_read (&ring, aio_get_sqe (&ring), fd, buf[i], BLOCK_SIZE,
+                   i * BLOCK_SIZE, i);
+}
+
+/* Takes every completion in RING, checking that each read a
+   whole block, and returns how many there were. */
+static int
+take_completions (void)
+{
+  struct aio_cqe *cqe;
+  int cnt = 0;
+
+  while ((cqe = aio_peek_cqe (&ring)) != NULL)
+    {
+      if (cqe->result != BLOCK_SIZE)
+        fail ("read %u: result %d, expected %d",
+              cqe->user_data, cqe->result, BLOCK_SIZE);
+      aio_cqe_seen (&ring);
+      cnt++;
+    }
+  return cnt;
+}
+
+void
+test_main (void)
+{
+  int fd, posted;
+
+  CHECK (create ("data", sizeof buf), "create \"data\"");
+  CHECK ((fd = open ("data")) > 1, "open \"data\"");
+  CHECK (aio_ring_init (&ring, sqes, REQUEST_CNT, cqes, REQUEST_CNT) == 0,
+         "aio_ring_init");
+
+  CHECK (aio_enter (0, 1) == 0, "wait with nothing in flight");
+
+  queue_reads (fd);
+  CHECK (aio_wait (&ring, REQUEST_CNT) == REQUEST_CNT,
+         "wait for all %d reads", REQUEST_CNT);
+  CHECK (take_completions () == REQUEST_CNT, "take %d completions",
+         REQUEST_CNT);
+
+  /* Some reads may complete before aio_submit() returns; waiting
+     for the rest must post exactly the rest. */
+  queue_reads (fd);
+  posted = aio_submit (&ring);
+  if (posted < 0 || posted > REQUEST_CNT)
+    fail ("aio_submit returned %d", posted);
+  if (aio_enter (0, REQUEST_CNT - posted) != REQUEST_CNT - posted)
+    fail ("waiting for %d more reads did not post them",
+          REQUEST_CNT - posted);
+  CHECK (take_completions () == REQUEST_CNT, "submit, then wait for rest");
+  close (fd);
+}
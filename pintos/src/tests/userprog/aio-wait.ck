@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(aio-wait) begin
+(aio-wait) create "data"
+(aio-wait) open "data"
+(aio-wait) aio_ring_init
+(aio-wait) wait with nothing in flight
+(aio-wait) wait for all 4 reads
+(aio-wait) take 4 completions
+(aio-wait) submit, then wait for rest
+(aio-wait) end
+aio-wait: exit(0)
+EOF
+pass;
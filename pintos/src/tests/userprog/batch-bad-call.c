@@ -0,0 +1,32 @@
+/* Puts a nested batch call and out-of-range system call numbers
+   in a batch, each of which must fail with -1 without keeping the
+   rest of the batch from running. */
+
+#include <syscall.h>
+#include <syscall-nr.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void)
+{
+  struct syscall_batch_entry inner[1];
+  struct syscall_batch_entry entries[4];
+  struct batch b;
+
+  batch_init (&b, inner, 1);
+  batch_add (&b, SYS_DUP, -1, 0, 0);
+
+  batch_init (&b, entries, 4);
+  batch_add (&b, SYS_BATCH, (int) inner, 1, 0);
+  batch_add (&b, 1000, 0, 0, 0);
+  batch_add (&b, -1, 0, 0, 0);
+  batch_add (&b, SYS_DUP, 0, 0, 0);
+  CHECK (batch_run (&b, 0) == 4, "batch of 4 calls");
+  CHECK (batch_result (&b, 0) == -1, "nested batch fails");
+  CHECK (inner[0].result == 0, "nested call not made");
+  CHECK (batch_result (&b, 1) == -1, "call number 1000 fails");
+  CHECK (batch_result (&b, 2) == -1, "call number -1 fails");
+  CHECK (batch_result (&b, 3) > 1, "dup after them succeeds");
+  close (batch_result (&b, 3));
+}
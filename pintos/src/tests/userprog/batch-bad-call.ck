@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(batch-bad-call) begin
+(batch-bad-call) batch of 4 calls
+(batch-bad-call) nested batch fails
+(batch-bad-call) nested call not made
+(batch-bad-call) call number 1000 fails
+(batch-bad-call) call number -1 fails
+(batch-bad-call) dup after them succeeds
+(batch-bad-call) end
+batch-bad-call: exit(0)
+EOF
+pass;
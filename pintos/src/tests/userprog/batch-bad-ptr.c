@@ -0,0 +1,13 @@
+/* Passes a bad pointer to the batch system call, which must
+   cause the process to be terminated with exit code -1. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void)
+{
+  msg ("batch(0x20101234): %d",
+       batch ((struct syscall_batch_entry *) 0x20101234, 1, 0));
+}
@@ -0,0 +1,32 @@
+/* Makes several system calls on a file in one batch and checks
+   that each call's result is stored in its own entry. */
+
+#include <string.h>
+#include <syscall.h>
+#include <syscall-nr.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void)
+{
+  struct syscall_batch_entry entries[4];
+  struct batch b;
+  char buf[20];
+  int fd, size, tell_idx, read_idx;
+
+  CHECK ((fd = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  batch_init (&b, entries, 4);
+  size = batch_add (&b, SYS_FILESIZE, fd, 0, 0);
+  batch_add_seek (&b, fd, 10);
+  read_idx = batch_add_read (&b, fd, buf, sizeof buf);
+  tell_idx = batch_add (&b, SYS_TELL, fd, 0, 0);
+  CHECK (batch_run (&b, 0) == 4, "batch of 4 calls");
+
+  CHECK (batch_result (&b, size) == sizeof sample - 1, "filesize result");
+  CHECK (batch_result (&b, read_idx) == sizeof buf, "read result");
+  CHECK (batch_result (&b, tell_idx) == 10 + sizeof buf, "tell result");
+  compare_bytes (buf, sample + 10, sizeof buf, 10, "sample.txt");
+  close (fd);
+}
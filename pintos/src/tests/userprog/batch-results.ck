@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(batch-results) begin
+(batch-results) open "sample.txt"
+(batch-results) batch of 4 calls
+(batch-results) filesize result
+(batch-results) read result
+(batch-results) tell result
+(batch-results) end
+batch-results: exit(0)
+EOF
+pass;
@@ -0,0 +1,40 @@
+/* Checks that BATCH_STOP_ON_ERROR stops a batch after the first
+   call that fails, returning the number of calls made, and that
+   a batch without it goes on past the failure. */
+
+#include <syscall.h>
+#include <syscall-nr.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+/* Result that no call in the batch returns. */
+#define NOT_RUN 12345
+
+void
+test_main (void)
+{
+  struct syscall_batch_entry entries[3];
+  struct batch b;
+  int fd;
+
+  CHECK ((fd = open ("sample.txt")) > 1, "open \"sample.txt\"");
+
+  batch_init (&b, entries, 3);
+  batch_add (&b, SYS_TELL, fd, 0, 0);
+  batch_add (&b, SYS_OPEN, (int) "no-such-file", 0, 0);
+  batch_add (&b, SYS_TELL, fd, 0, 0);
+  entries[2].result = NOT_RUN;
+  CHECK (batch_run (&b, BATCH_STOP_ON_ERROR) == 2,
+         "batch stopping on error makes 2 calls");
+  CHECK (batch_result (&b, 1) == -1, "open fails");
+  CHECK (batch_result (&b, 2) == NOT_RUN, "call after failure not made");
+
+  batch_init (&b, entries, 3);
+  batch_add (&b, SYS_TELL, fd, 0, 0);
+  batch_add (&b, SYS_OPEN, (int) "no-such-file", 0, 0);
+  batch_add (&b, SYS_TELL, fd, 0, 0);
+  entries[2].result = NOT_RUN;
+  CHECK (batch_run (&b, 0) == 3, "batch not stopping makes 3 calls");
+  CHECK (batch_result (&b, 2) == 0, "call after failure made");
+  close (fd);
+}
@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(batch-stop) begin
+(batch-stop) open "sample.txt"
+(batch-stop) batch stopping on error makes 2 calls
+(batch-stop) open fails
+(batch-stop) call after failure not made
+(batch-stop) batch not stopping makes 3 calls
+(batch-stop) call after failure made
+(batch-stop) end
+batch-stop: exit(0)
+EOF
+pass;
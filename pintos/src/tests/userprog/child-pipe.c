@@ -0,0 +1,22 @@
+/* Child process run by pipe-exec.  Writes a line to its standard
+   output and another to the descriptor named by its argument,
+   both of which it inherits from its parent. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <syscall.h>
+
+int
+main (int argc, char *argv[])
+{
+  int fd;
+
+  if (argc != 2)
+    return 1;
+  fd = atoi (argv[1]);
+  if (write (STDOUT_FILENO, "redirected\n", 11) != 11
+      || write (fd, "inherited\n", 10) != 10)
+    return 1;
+  return 0;
+}
@@ -0,0 +1,102 @@
+/* Passes values from producer threads to consumer threads
+   through a small queue guarded by a user-level mutex, with one
+   condition variable for "not full" and one for "not empty", and
+   checks that every value arrives exactly once.  The queue is
+   much smaller than the number of values, so producers and
+   consumers alike must wait for each other. */
+
+#include <synch.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PRODUCER_CNT 2
+#define CONSUMER_CNT 2
+#define VALUE_CNT 500           /* Values per producer. */
+#define QUEUE_SIZE 4
+
+static struct mutex mutex = MUTEX_INITIALIZER;
+static struct condvar not_full = CONDVAR_INITIALIZER;
+static struct condvar not_empty = CONDVAR_INITIALIZER;
+
+/* Queue, protected by MUTEX. */
+static int queue[QUEUE_SIZE];
+static int head, tail;          /* Next to remove, next to add. */
+static int size;                /* Values in the queue. */
+static int producers_done;      /* Producers that have finished. */
+
+/* Number of times each value was received, protected by MUTEX. */
+static int seen[PRODUCER_CNT * VALUE_CNT];
+
+static void
+producer (void *first_)
+{
+  int first = (int) first_;
+  int i;
+
+  for (i = 0; i < VALUE_CNT; i++)
+    {
+      mutex_lock (&mutex);
+      while (size == QUEUE_SIZE)
+        condvar_wait (&not_full, &mutex);
+      queue[tail] = first + i;
+      tail = (tail + 1) % QUEUE_SIZE;
+      size++;
+      condvar_signal (&not_empty);
+      mutex_unlock (&mutex);
+    }
+
+  /* Consumers waiting on an empty queue must learn when there
+     will be no more values. */
+  mutex_lock (&mutex);
+  producers_done++;
+  condvar_broadcast (&not_empty);
+  mutex_unlock (&mutex);
+}
+
+static void
+consumer (void *aux UNUSED)
+{
+  for (;;)
+    {
+      int value;
+
+      mutex_lock (&mutex);
+      while (size == 0 && producers_done < PRODUCER_CNT)
+        condvar_wait (&not_empty, &mutex);
+      if (size == 0)
+        {
+          mutex_unlock (&mutex);
+          return;
+        }
+      value = queue[head];
+      head = (head + 1) % QUEUE_SIZE;
+      size--;
+      seen[value]++;
+      condvar_signal (&not_full);
+      mutex_unlock (&mutex);
+    }
+}
+
+void
+test_main (void)
+{
+  tid_t tids[PRODUCER_CNT + CONSUMER_CNT];
+  int i;
+
+  for (i = 0; i < CONSUMER_CNT; i++)
+    CHECK ((tids[i] = thread_create (consumer, NULL)) != TID_ERROR,
+           "start consumer %d", i);
+  for (i = 0; i < PRODUCER_CNT; i++)
+    CHECK ((tids[CONSUMER_CNT + i]
+            = thread_create (producer, (void *) (i * VALUE_CNT)))
+           != TID_ERROR, "start producer %d", i);
+
+  for (i = 0; i < PRODUCER_CNT + CONSUMER_CNT; i++)
+    CHECK (thread_join (tids[i]), "thread_join %d", i);
+
+  for (i = 0; i < PRODUCER_CNT * VALUE_CNT; i++)
+    if (seen[i] != 1)
+      fail ("value %d received %d times", i, seen[i]);
+  msg ("every value received once");
+}
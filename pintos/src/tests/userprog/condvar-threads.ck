@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(condvar-threads) begin
+(condvar-threads) start consumer 0
+(condvar-threads) start consumer 1
+(condvar-threads) start producer 0
+(condvar-threads) start producer 1
+(condvar-threads) thread_join 0
+(condvar-threads) thread_join 1
+(condvar-threads) thread_join 2
+(condvar-threads) thread_join 3
+(condvar-threads) every value received once
+(condvar-threads) end
+condvar-threads: exit(0)
+EOF
+pass;
@@ -0,0 +1,30 @@
+/* Duplicates a file descriptor, checks that the two share a file
+   position, and that closing the original leaves the file open
+   through the duplicate until it, too, is closed. */
+
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void)
+{
+  char buf[10];
+  int fd, dup_fd;
+
+  CHECK ((fd = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK ((dup_fd = dup (fd)) > 1, "dup");
+  CHECK (read (fd, buf, sizeof buf) == sizeof buf, "read from original");
+  CHECK (tell (dup_fd) == sizeof buf, "duplicate shares position");
+
+  msg ("close original");
+  close (fd);
+  CHECK (read (dup_fd, buf, sizeof buf) == sizeof buf,
+         "read from duplicate");
+  compare_bytes (buf, sample + sizeof buf, sizeof buf, sizeof buf,
+                 "sample.txt");
+  msg ("close duplicate");
+  close (dup_fd);
+  CHECK (open ("sample.txt") == fd, "both descriptors free");
+}
@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(dup-refcount) begin
+(dup-refcount) open "sample.txt"
+(dup-refcount) dup
+(dup-refcount) read from original
+(dup-refcount) duplicate shares position
+(dup-refcount) close original
+(dup-refcount) read from duplicate
+(dup-refcount) close duplicate
+(dup-refcount) both descriptors free
+(dup-refcount) end
+dup-refcount: exit(0)
+EOF
+pass;
@@ -0,0 +1,25 @@
+/* Checks that dup2() onto an open file descriptor closes it
+   first, leaving it referring to the same file as the old
+   descriptor, and that dup2() from a descriptor that is not open
+   fails. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void)
+{
+  char buf[10];
+  int a, b;
+
+  CHECK ((a = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK ((b = open ("sample.txt")) > 1, "open \"sample.txt\" again");
+  CHECK (read (b, buf, sizeof buf) == sizeof buf, "read from second");
+  CHECK (dup2 (a, b) == b, "dup2 first onto second");
+  CHECK (tell (b) == 0, "second now shares first's position");
+  CHECK (read (a, buf, sizeof buf) == sizeof buf, "read from first");
+  CHECK (tell (b) == sizeof buf, "second follows first");
+  CHECK (dup2 (b + 100, b) == -1, "dup2 from unopened descriptor fails");
+  CHECK (tell (b) == sizeof buf, "second still open");
+}
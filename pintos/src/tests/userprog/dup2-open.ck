@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(dup2-open) begin
+(dup2-open) open "sample.txt"
+(dup2-open) open "sample.txt" again
+(dup2-open) read from second
+(dup2-open) dup2 first onto second
+(dup2-open) second now shares first's position
+(dup2-open) read from first
+(dup2-open) second follows first
+(dup2-open) dup2 from unopened descriptor fails
+(dup2-open) second still open
+(dup2-open) end
+dup2-open: exit(0)
+EOF
+pass;
@@ -0,0 +1,20 @@
+/* Checks that dup2() with the same old and new file descriptor
+   returns it, still open, and fails if it is not open. */
+
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void)
+{
+  char buf[10];
+  int fd;
+
+  CHECK ((fd = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK (dup2 (fd, fd) == fd, "dup2 onto itself");
+  CHECK (read (fd, buf, sizeof buf) == sizeof buf, "read after dup2");
+  compare_bytes (buf, sample, sizeof buf, 0, "sample.txt");
+  CHECK (dup2 (fd + 1, fd + 1) == -1, "dup2 of unopened descriptor fails");
+}
@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(dup2-same) begin
+(dup2-same) open "sample.txt"
+(dup2-same) dup2 onto itself
+(dup2-same) read after dup2
+(dup2-same) dup2 of unopened descriptor fails
+(dup2-same) end
+dup2-same: exit(0)
+EOF
+pass;
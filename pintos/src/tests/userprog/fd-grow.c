@@ -0,0 +1,38 @@
+/* Opens more file descriptors than the table starts out with
+   room for, checks that each is the next one up and that the last
+   works, then closes them all and checks that the lowest is
+   reused. */
+
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FD_CNT 40
+
+void
+test_main (void)
+{
+  int fds[FD_CNT];
+  char buf[16];
+  int i;
+
+  for (i = 0; i < FD_CNT; i++)
+    {
+      fds[i] = dup (STDOUT_FILENO);
+      if (fds[i] != i + 2)
+        fail ("dup #%d returned %d, expected %d", i, fds[i], i + 2);
+    }
+  msg ("dup %d descriptors", FD_CNT);
+
+  CHECK (open ("sample.txt") == FD_CNT + 2, "open \"sample.txt\"");
+  CHECK (read (FD_CNT + 2, buf, sizeof buf) == sizeof buf,
+         "read from descriptor %d", FD_CNT + 2);
+  compare_bytes (buf, sample, sizeof buf, 0, "sample.txt");
+
+  for (i = 0; i < FD_CNT; i++)
+    close (fds[i]);
+  msg ("close %d descriptors", FD_CNT);
+  CHECK (dup (STDOUT_FILENO) == 2, "dup returns descriptor 2");
+}
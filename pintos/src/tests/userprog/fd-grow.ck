@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(fd-grow) begin
+(fd-grow) dup 40 descriptors
+(fd-grow) open "sample.txt"
+(fd-grow) read from descriptor 42
+(fd-grow) close 40 descriptors
+(fd-grow) dup returns descriptor 2
+(fd-grow) end
+fd-grow: exit(0)
+EOF
+pass;
@@ -0,0 +1,27 @@
+/* Checks that open() and dup() return the lowest free file
+   descriptor, including one freed by close(). */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void)
+{
+  int fds[3];
+  int i;
+
+  for (i = 0; i < 3; i++)
+    CHECK ((fds[i] = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  if (fds[1] != fds[0] + 1 || fds[2] != fds[1] + 1)
+    fail ("descriptors %d, %d, %d are not consecutive",
+          fds[0], fds[1], fds[2]);
+
+  msg ("close middle descriptor");
+  close (fds[1]);
+  CHECK (open ("sample.txt") == fds[1], "open reuses it");
+
+  msg ("close first descriptor");
+  close (fds[0]);
+  CHECK (dup (fds[2]) == fds[0], "dup reuses it");
+}
@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(fd-reuse) begin
+(fd-reuse) open "sample.txt"
+(fd-reuse) open "sample.txt"
+(fd-reuse) open "sample.txt"
+(fd-reuse) close middle descriptor
+(fd-reuse) open reuses it
+(fd-reuse) close first descriptor
+(fd-reuse) dup reuses it
+(fd-reuse) end
+fd-reuse: exit(0)
+EOF
+pass;
@@ -0,0 +1,38 @@
+/* Tests futex_wait() and futex_wake() between two threads of a
+   process.  futex_wait() must return at once if the futex does
+   not hold the expected value, and must otherwise sleep until a
+   futex_wake() on the same futex wakes it. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static int futex;
+static int wait_result = 42;
+
+static void
+waiter (void *aux UNUSED)
+{
+  wait_result = futex_wait (&futex, 0);
+}
+
+void
+test_main (void)
+{
+  tid_t tid;
+
+  CHECK (futex_wait (&futex, 1) == -1, "futex_wait with wrong value");
+  CHECK (futex_wake (&futex, 1) == 0, "futex_wake with no waiters");
+
+  CHECK ((tid = thread_create (waiter, NULL)) != TID_ERROR,
+         "thread_create");
+
+  /* FUTEX stays 0, so the waiter must block, and nothing but us
+     can wake it.  Keep trying until it has gone to sleep. */
+  while (futex_wake (&futex, 1) == 0)
+    continue;
+  msg ("futex_wake woke the waiter");
+
+  CHECK (thread_join (tid), "thread_join");
+  CHECK (wait_result == 0, "futex_wait returned 0 after wakeup");
+}
@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(futex-wake) begin
+(futex-wake) futex_wait with wrong value
+(futex-wake) futex_wake with no waiters
+(futex-wake) thread_create
+(futex-wake) futex_wake woke the waiter
+(futex-wake) thread_join
+(futex-wake) futex_wait returned 0 after wakeup
+(futex-wake) end
+futex-wake: exit(0)
+EOF
+pass;
@@ -0,0 +1,33 @@
+/* Checks that readv() and writev() fail with more than IOV_MAX
+   buffers, and that an empty vector transfers nothing. */
+
+#include <iovec.h>
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static char buf[IOV_MAX + 1];
+
+void
+test_main (void)
+{
+  struct iovec iov[IOV_MAX + 1];
+  int fd;
+  int i;
+
+  for (i = 0; i <= IOV_MAX; i++)
+    {
+      iov[i].iov_base = buf + i;
+      iov[i].iov_len = 1;
+    }
+  CHECK ((fd = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK (readv (fd, iov, IOV_MAX + 1) == -1, "readv of %d buffers fails",
+         IOV_MAX + 1);
+  CHECK (tell (fd) == 0, "nothing read");
+  CHECK (writev (STDOUT_FILENO, iov, IOV_MAX + 1) == -1,
+         "writev of %d buffers fails", IOV_MAX + 1);
+  CHECK (readv (fd, iov, 0) == 0, "readv of no buffers reads nothing");
+  CHECK (readv (fd, iov, IOV_MAX) == IOV_MAX, "readv of %d buffers",
+         IOV_MAX);
+}
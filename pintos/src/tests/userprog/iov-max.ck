@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(iov-max) begin
+(iov-max) open "sample.txt"
+(iov-max) readv of 65 buffers fails
+(iov-max) nothing read
+(iov-max) writev of 65 buffers fails
+(iov-max) readv of no buffers reads nothing
+(iov-max) readv of 64 buffers
+(iov-max) end
+iov-max: exit(0)
+EOF
+pass;
@@ -0,0 +1,52 @@
+/* Writes a file with writev() from buffers whose boundaries do
+   not line up with the kernel's page-sized bounce buffer, then
+   reads it back with readv() into differently split buffers. */
+
+#include <iovec.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define DATA_SIZE 6000
+
+static char data[DATA_SIZE];
+static char readback[DATA_SIZE];
+
+/* Splits BUF into IOV at the lengths in LENS, which add up to
+   DATA_SIZE. */
+static void
+split (struct iovec *iov, char *buf, const size_t *lens, unsigned cnt)
+{
+  unsigned i;
+
+  for (i = 0; i < cnt; i++)
+    {
+      iov[i].iov_base = buf;
+      iov[i].iov_len = lens[i];
+      buf += lens[i];
+    }
+}
+
+void
+test_main (void)
+{
+  static const size_t write_lens[] = {1000, 3000, 1500, 500};
+  static const size_t read_lens[] = {7, 4093, 1, 0, 1899};
+  struct iovec iov[5];
+  size_t ofs;
+  int fd;
+
+  for (ofs = 0; ofs < sizeof data; ofs++)
+    data[ofs] = ofs % 253;
+  CHECK (create ("data", DATA_SIZE), "create \"data\"");
+  CHECK ((fd = open ("data")) > 1, "open \"data\"");
+
+  split (iov, data, write_lens, 4);
+  CHECK (writev (fd, iov, 4) == DATA_SIZE, "writev %d bytes", DATA_SIZE);
+
+  seek (fd, 0);
+  split (iov, readback, read_lens, 5);
+  CHECK (readv (fd, iov, 5) == DATA_SIZE, "readv %d bytes", DATA_SIZE);
+  compare_bytes (readback, data, DATA_SIZE, 0, "data");
+  close (fd);
+}
@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(iov-scatter) begin
+(iov-scatter) create "data"
+(iov-scatter) open "data"
+(iov-scatter) writev 6000 bytes
+(iov-scatter) readv 6000 bytes
+(iov-scatter) end
+iov-scatter: exit(0)
+EOF
+pass;
@@ -0,0 +1,65 @@
+/* Has several threads of a process increment a shared counter
+   many times, each time under a user-level mutex, with a delay
+   between reading the counter and writing it back, so that an
+   increment lost to a race would show in the final count.  The
+   main thread holds the mutex until another thread has blocked
+   on it, so the contended path through futex_wait() and
+   futex_wake() is taken at least once. */
+
+#include <synch.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define THREAD_CNT 4
+#define ITER_CNT 1000
+
+static struct mutex mutex = MUTEX_INITIALIZER;
+static volatile int counter;
+
+static void
+increment (void *aux UNUSED)
+{
+  int i;
+
+  for (i = 0; i < ITER_CNT; i++)
+    {
+      volatile int delay;
+      int value;
+
+      mutex_lock (&mutex);
+      value = counter;
+      for (delay = 0; delay < 100; delay++)
+        continue;
+      counter = value + 1;
+      mutex_unlock (&mutex);
+    }
+}
+
+void
+test_main (void)
+{
+  tid_t tids[THREAD_CNT];
+  int i;
+
+  mutex_lock (&mutex);
+  CHECK (!mutex_trylock (&mutex), "mutex_trylock fails while locked");
+  for (i = 0; i < THREAD_CNT; i++)
+    CHECK ((tids[i] = thread_create (increment, NULL)) != TID_ERROR,
+           "thread_create %d", i);
+
+  /* State 2 means that a thread is waiting, or about to. */
+  while (*(volatile int *) &mutex.state != 2)
+    continue;
+  msg ("another thread is waiting for the mutex");
+  mutex_unlock (&mutex);
+
+  for (i = 0; i < THREAD_CNT; i++)
+    CHECK (thread_join (tids[i]), "thread_join %d", i);
+  if (counter != THREAD_CNT * ITER_CNT)
+    fail ("counter is %d, should be %d", counter, THREAD_CNT * ITER_CNT);
+  msg ("counter is %d", counter);
+
+  CHECK (mutex_trylock (&mutex), "mutex_trylock succeeds when unlocked");
+  mutex_unlock (&mutex);
+}
@@ -0,0 +1,22 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(mutex-threads) begin
+(mutex-threads) mutex_trylock fails while locked
+(mutex-threads) thread_create 0
+(mutex-threads) thread_create 1
+(mutex-threads) thread_create 2
+(mutex-threads) thread_create 3
+(mutex-threads) another thread is waiting for the mutex
+(mutex-threads) thread_join 0
+(mutex-threads) thread_join 1
+(mutex-threads) thread_join 2
+(mutex-threads) thread_join 3
+(mutex-threads) counter is 4000
+(mutex-threads) mutex_trylock succeeds when unlocked
+(mutex-threads) end
+mutex-threads: exit(0)
+EOF
+pass;
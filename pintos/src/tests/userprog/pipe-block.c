@@ -0,0 +1,75 @@
+/* Has a thread read from a pipe while the main thread writes to
+   it, each in pieces whose size does not divide the pipe's
+   one-page buffer.  The writer writes eight times as much as the
+   pipe holds, so the reader blocks on an empty pipe, the writer
+   blocks on a full one, and the data wraps around the buffer many
+   times.  The reader checks that every byte arrives, in order. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+/* A pipe holds one page of data. */
+#define PIPE_SIZE 4096
+
+#define TOTAL (PIPE_SIZE * 8)
+
+static int fds[2];
+static int received;            /* Bytes received by reader. */
+static int bad_ofs = -1;        /* Offset of first wrong byte. */
+
+/* Returns the byte at offset OFS in the data. */
+static char
+data_byte (int ofs)
+{
+  return ofs * 7 + ofs / 251;
+}
+
+static void
+reader (void *aux UNUSED)
+{
+  char buf[777];
+  int n;
+
+  while ((n = read (fds[0], buf, sizeof buf)) > 0)
+    {
+      int i;
+
+      for (i = 0; i < n; i++)
+        if (buf[i] != data_byte (received + i) && bad_ofs < 0)
+          bad_ofs = received + i;
+      received += n;
+    }
+}
+
+void
+test_main (void)
+{
+  tid_t tid;
+  int ofs;
+
+  CHECK (pipe (fds), "pipe");
+  CHECK ((tid = thread_create (reader, NULL)) != TID_ERROR, "start reader");
+  for (ofs = 0; ofs < TOTAL; )
+    {
+      char buf[1000];
+      int n = TOTAL - ofs < (int) sizeof buf ? TOTAL - ofs : (int) sizeof buf;
+      int i;
+
+      for (i = 0; i < n; i++)
+        buf[i] = data_byte (ofs + i);
+      if (write (fds[1], buf, n) != n)
+        fail ("write at offset %d failed", ofs);
+      ofs += n;
+    }
+  msg ("wrote %d bytes", TOTAL);
+
+  /* The reader sees end of file once the write end is closed. */
+  close (fds[1]);
+  CHECK (thread_join (tid), "thread_join");
+  if (bad_ofs >= 0)
+    fail ("byte %d read wrong", bad_ofs);
+  if (received != TOTAL)
+    fail ("read %d bytes, should be %d", received, TOTAL);
+  msg ("read %d bytes", TOTAL);
+}
@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(pipe-block) begin
+(pipe-block) pipe
+(pipe-block) start reader
+(pipe-block) wrote 32768 bytes
+(pipe-block) thread_join
+(pipe-block) read 32768 bytes
+(pipe-block) end
+pipe-block: exit(0)
+EOF
+pass;
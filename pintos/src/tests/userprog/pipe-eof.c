@@ -0,0 +1,31 @@
+/* Reads from a pipe what was written to it, then checks that the
+   pipe reads as end of file once its write end is closed and
+   empty, and that writing to a pipe whose read end is closed
+   fails. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void)
+{
+  int fds[2];
+  char buf[16];
+
+  CHECK (pipe (fds), "pipe");
+  CHECK (write (fds[1], "hello", 5) == 5, "write 5 bytes");
+  msg ("close write end");
+  close (fds[1]);
+  CHECK (read (fds[0], buf, sizeof buf) == 5 && !memcmp (buf, "hello", 5),
+         "read 5 bytes");
+  CHECK (read (fds[0], buf, sizeof buf) == 0, "read at end of file");
+  close (fds[0]);
+
+  CHECK (pipe (fds), "pipe");
+  msg ("close read end");
+  close (fds[0]);
+  CHECK (write (fds[1], "hello", 5) == -1, "write fails");
+  close (fds[1]);
+}
@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(pipe-eof) begin
+(pipe-eof) pipe
+(pipe-eof) write 5 bytes
+(pipe-eof) close write end
+(pipe-eof) read 5 bytes
+(pipe-eof) read at end of file
+(pipe-eof) pipe
+(pipe-eof) close read end
+(pipe-eof) write fails
+(pipe-eof) end
+pipe-eof: exit(0)
+EOF
+pass;
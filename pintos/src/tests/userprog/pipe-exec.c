@@ -0,0 +1,52 @@
+/* Runs child-pipe with its standard output redirected into a pipe
+   by dup2(), passing it the number of another descriptor for the
+   pipe's write end, which the child inherits across exec.  Reads
+   back what the child wrote to both descriptors. */
+
+#include <stdio.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void)
+{
+  int fds[2];
+  int extra, saved;
+  char cmd[32];
+  char buf[64];
+  int size, n;
+  pid_t pid;
+  int status;
+
+  CHECK (pipe (fds), "pipe");
+  CHECK ((extra = dup (fds[1])) > fds[1], "dup write end");
+  CHECK ((saved = dup (STDOUT_FILENO)) > extra, "dup stdout");
+
+  /* Messages written while standard output goes to the pipe
+     would land in the pipe, so check quietly until it is
+     restored. */
+  snprintf (cmd, sizeof cmd, "child-pipe %d", extra);
+  if (dup2 (fds[1], STDOUT_FILENO) != STDOUT_FILENO)
+    fail ("dup2 onto stdout failed");
+  pid = exec (cmd);
+  if (dup2 (saved, STDOUT_FILENO) != STDOUT_FILENO)
+    fail ("dup2 back onto stdout failed");
+  close (saved);
+  close (fds[1]);
+  close (extra);
+
+  status = wait (pid);
+  CHECK (pid != PID_ERROR, "exec child-pipe");
+  CHECK (status == 0, "wait for child-pipe");
+
+  /* The child's copies of the write end closed when it exited, so
+     the pipe reads as end of file once drained. */
+  size = 0;
+  while ((n = read (fds[0], buf + size, sizeof buf - 1 - size)) > 0)
+    size += n;
+  buf[size] = '\0';
+  CHECK (!strcmp (buf, "redirected\ninherited\n"),
+         "read what child-pipe wrote");
+}
@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(pipe-exec) begin
+(pipe-exec) pipe
+(pipe-exec) dup write end
+(pipe-exec) dup stdout
+child-pipe: exit(0)
+(pipe-exec) exec child-pipe
+(pipe-exec) wait for child-pipe
+(pipe-exec) read what child-pipe wrote
+(pipe-exec) end
+pipe-exec: exit(0)
+EOF
+pass;
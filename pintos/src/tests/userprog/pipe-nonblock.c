@@ -0,0 +1,28 @@
+/* Checks that a pipe created with PIPE_NONBLOCK fails to read
+   when it is empty and to write when it is full, instead of
+   blocking, and that a write to a pipe with too little room
+   writes as much as fits. */
+
+#include <pipe.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+/* A pipe holds one page of data. */
+#define PIPE_SIZE 4096
+
+static char buf[PIPE_SIZE + 1000];
+
+void
+test_main (void)
+{
+  int fds[2];
+
+  CHECK (pipe2 (fds, PIPE_NONBLOCK), "pipe2");
+  CHECK (read (fds[0], buf, 1) == -1, "read from empty pipe fails");
+  CHECK (write (fds[1], buf, sizeof buf) == PIPE_SIZE,
+         "write of %d bytes fills pipe", (int) sizeof buf);
+  CHECK (write (fds[1], buf, 1) == -1, "write to full pipe fails");
+  CHECK (read (fds[0], buf, 100) == 100, "read 100 bytes");
+  CHECK (write (fds[1], buf, 200) == 100, "write of 200 bytes writes 100");
+}
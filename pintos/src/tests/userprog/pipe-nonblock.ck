@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(pipe-nonblock) begin
+(pipe-nonblock) pipe2
+(pipe-nonblock) read from empty pipe fails
+(pipe-nonblock) write of 5096 bytes fills pipe
+(pipe-nonblock) write to full pipe fails
+(pipe-nonblock) read 100 bytes
+(pipe-nonblock) write of 200 bytes writes 100
+(pipe-nonblock) end
+pipe-nonblock: exit(0)
+EOF
+pass;
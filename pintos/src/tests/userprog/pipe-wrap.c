@@ -0,0 +1,35 @@
+/* Writes blocks of data to a pipe and reads each back before
+   writing the next.  The blocks are smaller than the pipe's
+   one-page ring buffer but do not divide it, so later blocks wrap
+   around the end of the buffer. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define BLOCK_SIZE 3000
+#define BLOCK_CNT 4
+
+static char out[BLOCK_SIZE];
+static char in[BLOCK_SIZE];
+
+void
+test_main (void)
+{
+  int fds[2];
+  int block;
+
+  CHECK (pipe (fds), "pipe");
+  for (block = 0; block < BLOCK_CNT; block++)
+    {
+      int i;
+
+      for (i = 0; i < BLOCK_SIZE; i++)
+        out[i] = block * BLOCK_SIZE + i;
+      CHECK (write (fds[1], out, BLOCK_SIZE) == BLOCK_SIZE,
+             "write block %d", block);
+      CHECK (read (fds[0], in, BLOCK_SIZE) == BLOCK_SIZE,
+             "read block %d", block);
+      compare_bytes (in, out, BLOCK_SIZE, 0, "pipe");
+    }
+}
@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(pipe-wrap) begin
+(pipe-wrap) pipe
+(pipe-wrap) write block 0
+(pipe-wrap) read block 0
+(pipe-wrap) write block 1
+(pipe-wrap) read block 1
+(pipe-wrap) write block 2
+(pipe-wrap) read block 2
+(pipe-wrap) write block 3
+(pipe-wrap) read block 3
+(pipe-wrap) end
+pipe-wrap: exit(0)
+EOF
+pass;
@@ -0,0 +1,51 @@
+/* Has a thread other than the first call exit() while the
+   process's other threads are blocked in the kernel: one waiting
+   on a futex, one reading from an empty pipe, and the first
+   joining the one on the futex.  None of them would ever wake up
+   by itself, yet the whole process must end at once, with the
+   exit code passed to exit(). */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static int futex;
+static int fds[2];
+
+static void
+futex_sleeper (void *aux UNUSED)
+{
+  futex_wait (&futex, 0);
+  fail ("futex_wait returned");
+}
+
+static void
+pipe_sleeper (void *aux UNUSED)
+{
+  char c;
+
+  read (fds[0], &c, 1);
+  fail ("read returned");
+}
+
+static void
+exiter (void *aux UNUSED)
+{
+  exit (57);
+}
+
+void
+test_main (void)
+{
+  tid_t tid;
+
+  CHECK (pipe (fds), "pipe");
+  CHECK ((tid = thread_create (futex_sleeper, NULL)) != TID_ERROR,
+         "start futex sleeper");
+  CHECK (thread_create (pipe_sleeper, NULL) != TID_ERROR,
+         "start pipe sleeper");
+  if (thread_create (exiter, NULL) == TID_ERROR)
+    fail ("start exiter");
+  thread_join (tid);
+  fail ("thread_join returned");
+}
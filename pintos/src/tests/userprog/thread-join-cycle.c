@@ -0,0 +1,40 @@
+/* Starts two threads that join each other, has the first thread
+   join one of them, and then has a fourth thread call exit().
+   None of the joins can ever succeed, yet the whole process must
+   end at once, with the exit code passed to exit(). */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static volatile tid_t tids[2];
+
+static void
+joiner (void *other_)
+{
+  int other = (int) other_;
+
+  while (tids[other] == 0)
+    continue;
+  thread_join (tids[other]);
+  fail ("thread_join returned");
+}
+
+static void
+exiter (void *aux UNUSED)
+{
+  exit (57);
+}
+
+void
+test_main (void)
+{
+  CHECK ((tids[0] = thread_create (joiner, (void *) 1)) != TID_ERROR,
+         "start joiner 0");
+  CHECK ((tids[1] = thread_create (joiner, (void *) 0)) != TID_ERROR,
+         "start joiner 1");
+  if (thread_create (exiter, NULL) == TID_ERROR)
+    fail ("start exiter");
+  thread_join (tids[0]);
+  fail ("thread_join returned");
+}
@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(thread-join-cycle) begin
+(thread-join-cycle) start joiner 0
+(thread-join-cycle) start joiner 1
+thread-join-cycle: exit(57)
+EOF
+pass;
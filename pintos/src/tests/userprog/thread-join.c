@@ -0,0 +1,52 @@
+/* Starts several threads in the process, each of which computes
+   a sum and stores it, and joins them all.  Half of the threads
+   end by returning and half by calling thread_exit().  A thread
+   that has been joined cannot be joined again. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define THREAD_CNT 4
+
+static int sums[THREAD_CNT];
+
+/* Number of terms summed by thread I. */
+static int
+term_cnt (int i)
+{
+  return (i + 1) * 100;
+}
+
+static void
+sum (void *i_)
+{
+  int i = (int) i_;
+  int j;
+
+  for (j = 1; j <= term_cnt (i); j++)
+    sums[i] += j;
+  if (i % 2)
+    thread_exit ();
+}
+
+void
+test_main (void)
+{
+  tid_t tids[THREAD_CNT];
+  int i;
+
+  for (i = 0; i < THREAD_CNT; i++)
+    CHECK ((tids[i] = thread_create (sum, (void *) i)) != TID_ERROR,
+           "thread_create %d", i);
+  for (i = 0; i < THREAD_CNT; i++)
+    {
+      int n = term_cnt (i);
+
+      CHECK (thread_join (tids[i]), "thread_join %d", i);
+      if (sums[i] != n * (n + 1) / 2)
+        fail ("thread %d summed %d, should be %d",
+              i, sums[i], n * (n + 1) / 2);
+    }
+  CHECK (!thread_join (tids[0]), "thread_join 0 again fails");
+}
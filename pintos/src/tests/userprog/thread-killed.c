@@ -0,0 +1,52 @@
+/* Has a thread other than the first write to an address that is
+   not mapped while the process's other threads are blocked in the
+   kernel: one waiting on a futex, one reading from an empty pipe,
+   and the first joining the one on the futex.  The kernel must
+   kill the whole process, not just the faulting thread, with exit
+   code -1. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static int futex;
+static int fds[2];
+
+static void
+futex_sleeper (void *aux UNUSED)
+{
+  futex_wait (&futex, 0);
+  fail ("futex_wait returned");
+}
+
+static void
+pipe_sleeper (void *aux UNUSED)
+{
+  char c;
+
+  read (fds[0], &c, 1);
+  fail ("read returned");
+}
+
+static void
+faulter (void *aux UNUSED)
+{
+  *(int *) NULL = 42;
+  fail ("should have exited with -1");
+}
+
+void
+test_main (void)
+{
+  tid_t tid;
+
+  CHECK (pipe (fds), "pipe");
+  CHECK ((tid = thread_create (futex_sleeper, NULL)) != TID_ERROR,
+         "start futex sleeper");
+  CHECK (thread_create (pipe_sleeper, NULL) != TID_ERROR,
+         "start pipe sleeper");
+  if (thread_create (faulter, NULL) == TID_ERROR)
+    fail ("start faulter");
+  thread_join (tid);
+  fail ("thread_join returned");
+}
@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_USER_FAULTS => 1, [<<'EOF']);
+(thread-killed) begin
+(thread-killed) pipe
+(thread-killed) start futex sleeper
+(thread-killed) start pipe sleeper
+thread-killed: exit(-1)
+EOF
+pass;
@@ -0,0 +1,17 @@
+/* Passes a bad vector pointer to the writev system call, which
+   must cause the process to be terminated with exit code -1. */
+
+#include <iovec.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void)
+{
+  int handle;
+
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  writev (handle, (struct iovec *) 0xc0100000, 1);
+  fail ("should not have survived writev()");
+}
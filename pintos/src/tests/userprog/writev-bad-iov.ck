@@ -0,0 +1,10 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(writev-bad-iov) begin
+(writev-bad-iov) open "sample.txt"
+writev-bad-iov: exit(-1)
+EOF
+pass;
@@ -0,0 +1,40 @@
+/* Child process of mutex-shm.
+   Maps the shared memory segment whose id is its argument and
+   increments the counter in it ITER_CNT times under the mutex
+   there, with a delay between reading the counter and writing
+   it back. */
+
+#include <stdlib.h>
+#include <synch.h>
+#include <syscall.h>
+#include "tests/vm/mutex-shm.h"
+#include "tests/lib.h"
+
+const char *test_name = "child-mutex-shm";
+
+int
+main (int argc, char *argv[])
+{
+  struct mutex_shm *s;
+  int i;
+
+  if (argc != 2)
+    fail ("wrong number of arguments");
+  s = shm_attach (atoi (argv[1]), NULL);
+  if (s == NULL)
+    fail ("shm_attach failed");
+
+  for (i = 0; i < ITER_CNT; i++)
+    {
+      volatile int delay;
+      int value;
+
+      mutex_lock (&s->mutex);
+      value = s->counter;
+      for (delay = 0; delay < 100; delay++)
+        continue;
+      s->counter = value + 1;
+      mutex_unlock (&s->mutex);
+    }
+  return 0;
+}
@@ -0,0 +1,53 @@
+/* Has several processes increment a counter in a shared memory
+   segment many times, each time under a user-level mutex in the
+   same segment, and checks that no increment was lost.  Each
+   process maps the segment wherever the kernel chooses, so the
+   futex in the mutex must be matched by what backs it, not by
+   its address.  The parent holds the mutex until a child has
+   blocked on it, so the contended path is taken across
+   processes at least once. */
+
+#include <stdio.h>
+#include <synch.h>
+#include <syscall.h>
+#include "tests/vm/mutex-shm.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void)
+{
+  pid_t children[CHILD_CNT];
+  struct mutex_shm *s;
+  int id;
+  int i;
+
+  CHECK ((id = shm_create (1)) >= 0, "shm_create");
+  CHECK ((s = shm_attach (id, NULL)) != NULL, "shm_attach");
+  mutex_init (&s->mutex);
+  s->counter = 0;
+
+  mutex_lock (&s->mutex);
+  for (i = 0; i < CHILD_CNT; i++)
+    {
+      char cmd_line[64];
+      snprintf (cmd_line, sizeof cmd_line, "child-mutex-shm %d", id);
+      CHECK ((children[i] = exec (cmd_line)) != -1,
+             "exec child %d of %d", i + 1, CHILD_CNT);
+    }
+
+  /* State 2 means that a child is waiting, or about to. */
+  while (*(volatile int *) &s->mutex.state != 2)
+    continue;
+  msg ("a child is waiting for the mutex");
+  mutex_unlock (&s->mutex);
+
+  for (i = 0; i < CHILD_CNT; i++)
+    CHECK (wait (children[i]) == 0, "wait for child %d of %d",
+           i + 1, CHILD_CNT);
+  if (s->counter != CHILD_CNT * ITER_CNT)
+    fail ("counter is %d, should be %d",
+          s->counter, CHILD_CNT * ITER_CNT);
+  msg ("counter is %d", s->counter);
+  CHECK (shm_detach (s), "shm_detach");
+}
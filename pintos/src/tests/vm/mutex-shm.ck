@@ -0,0 +1,22 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(mutex-shm) begin
+(mutex-shm) shm_create
+(mutex-shm) shm_attach
+(mutex-shm) exec child 1 of 4
+(mutex-shm) exec child 2 of 4
+(mutex-shm) exec child 3 of 4
+(mutex-shm) exec child 4 of 4
+(mutex-shm) a child is waiting for the mutex
+(mutex-shm) wait for child 1 of 4
+(mutex-shm) wait for child 2 of 4
+(mutex-shm) wait for child 3 of 4
+(mutex-shm) wait for child 4 of 4
+(mutex-shm) counter is 4000
+(mutex-shm) shm_detach
+(mutex-shm) end
+EOF
+pass;
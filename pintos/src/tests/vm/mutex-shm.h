@@ -0,0 +1,17 @@
+#ifndef TESTS_VM_MUTEX_SHM_H
+#define TESTS_VM_MUTEX_SHM_H 1
+
+#include <synch.h>
+
+/* Layout of the shared memory segment of the mutex-shm test. */
+struct mutex_shm
+  {
+    struct mutex mutex;         /* Guards COUNTER. */
+    int counter;                /* Incremented by each child. */
+  };
+
+/* Number of child processes, and increments by each. */
+#define CHILD_CNT 4
+#define ITER_CNT 1000
+
+#endif /* tests/vm/mutex-shm.h */
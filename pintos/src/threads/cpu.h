@@ -0,0 +1,97 @@
+#ifndef THREADS_CPU_H
+#define THREADS_CPU_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Access to x86 processor identification and control registers.
+
+   See [IA32-v2a] "CPUID--CPU Identification" and [IA32-v3a] 2.5
+   "Control Registers". */
+
+/* Feature flags returned in EDX by CPUID with EAX=1. */
+#define CPUID_PSE 0x00000008    /* 4 MB pages (Page Size Extension). */
+#define CPUID_SEP 0x00000800    /* SYSENTER and SYSEXIT. */
+#define CPUID_PGE 0x00002000    /* Global pages (Page Global Enable). */
+
+/* Control register 4. */
+#define CR4_PSE 0x00000010      /* Page Size Extensions enable. */
+#define CR4_PGE 0x00000080      /* Global pages enable. */
+
+/* Returns the feature flags that the CPUID instruction reports
+   in EDX for leaf 1.  Every processor Pintos runs on (Pentium
+   and later, including Bochs and QEMU) supports CPUID. */
+static inline uint32_t
+cpu_features (void)
+{
+  uint32_t eax = 1, ebx, ecx, edx;
+  asm volatile ("cpuid" : "+a" (eax), "=b" (ebx), "=c" (ecx), "=d" (edx));
+  return edx;
+}
+
+/* Model-specific registers that configure SYSENTER.
+   See [IA32-v3a] 4.8.7 "Fast System Calls". */
+#define MSR_SYSENTER_CS 0x174   /* Kernel code segment. */
+#define MSR_SYSENTER_ESP 0x175  /* Kernel stack pointer. */
+#define MSR_SYSENTER_EIP 0x176  /* Kernel entry point. */
+
+/* Returns the processor signature that the CPUID instruction
+   reports in EAX for leaf 1: the stepping in bits 0...3, model in
+   bits 4...7, and family in bits 8...11. */
+static inline uint32_t
+cpu_signature (void)
+{
+  uint32_t eax = 1, ebx, ecx, edx;
+  asm volatile ("cpuid" : "+a" (eax), "=b" (ebx), "=c" (ecx), "=d" (edx));
+  return eax;
+}
+
+/* Returns true if the processor supports SYSENTER and SYSEXIT.
+   Early Pentium Pro processors report SEP without supporting
+   them. */
+static inline bool
+cpu_has_sysenter (void)
+{
+  uint32_t sig = cpu_signature ();
+  unsigned family = (sig >> 8) & 0xf;
+  unsigned model = (sig >> 4) & 0xf;
+  unsigned stepping = sig & 0xf;
+
+  return ((cpu_features () & CPUID_SEP) != 0
+          && !(family == 6 && model < 3 && stepping < 3));
+}
+
+/* Stores VALUE into model-specific register MSR. */
+static inline void
+msr_write (uint32_t msr, uint64_t value)
+{
+  asm volatile ("wrmsr" : : "c" (msr), "A" (value));
+}
+
+/* Returns the contents of control register CR4. */
+static inline uint32_t
+cr4_read (void)
+{
+  uint32_t cr4;
+  asm volatile ("movl %%cr4, %0" : "=r" (cr4));
+  return cr4;
+}
+
+/* Stores CR4 into control register CR4. */
+static inline void
+cr4_write (uint32_t cr4)
+{
+  asm volatile ("movl %0, %%cr4" : : "r" (cr4) : "memory");
+}
+
+/* Returns the processor's time-stamp counter, which counts clock
+   cycles since reset. */
+static inline uint64_t
+cpu_cycles (void)
+{
+  uint64_t tsc;
+  asm volatile ("rdtsc" : "=A" (tsc));
+  return tsc;
+}
+
+#endif /* threads/cpu.h */
@@ -15,6 +15,7 @@
 #include "devices/timer.h"
 #include "devices/vga.h"
 #include "devices/rtc.h"
+#include "threads/cpu.h"
 #include "threads/interrupt.h"
 #include "threads/io.h"
 #include "threads/loader.h"
@@ -24,6 +25,8 @@
 #include "threads/thread.h"
 #ifdef USERPROG
 #include "userprog/process.h"
+#include "userprog/aio.h"
+#include "userprog/futex.h"
 #include "userprog/exception.h"
 #include "userprog/gdt.h"
 #include "userprog/syscall.h"
@@ -37,6 +40,14 @@
 #include "filesys/filesys.h"
 #include "filesys/fsutil.h"
 #endif
+#ifdef VM
+#include "vm/frame.h"
+#include "vm/page.h"
+#include "vm/shm.h"
+#include "vm/swap.h"
+#include "vm/ws.h"
+#include "vm/zstore.h"
+#endif
 
 /* Page directory with kernel mappings only. */
 uint32_t *init_page_dir;
@@ -119,6 +130,11 @@ main (void)
   thread_start ();
   serial_init_queue ();
   timer_calibrate ();
+#ifdef USERPROG
+  process_init ();
+  aio_init ();
+  futex_init ();
+#endif
 
 #ifdef FILESYS
   /* Initialize file system. */
@@ -127,6 +143,15 @@ main (void)
   filesys_init (format_filesys);
 #endif
 
+#ifdef VM
+  /* Initialize virtual memory. */
+  frame_init ();
+  swap_init ();
+  zstore_init ();
+  ws_init ();
+  shm_init ();
+#endif
+
   printf ("Boot complete.\n");
   
   /* Run actions specified on kernel command line. */
@@ -153,13 +178,30 @@ bss_init (void)
 /* Populates the base page directory and page table with the
    kernel virtual mapping, and then sets up the CPU to use the
    new page directory.  Points init_page_dir to the page
-   directory it creates. */
+   directory it creates.
+
+   If the CPU supports 4 MB pages, every 4 MB region of RAM that
+   does not contain kernel text is mapped with a single large
+   page PDE instead of a page table.  That saves a page table per
+   4 MB and greatly reduces TLB misses on the kernel's direct
+   map.  The region holding kernel text keeps 4 kB pages so that
+   the text can stay read-only.
+
+   If the CPU supports global pages, all of the kernel mappings
+   are marked global, so that their TLB entries survive the CR3
+   reload done when switching between processes. */
 static void
 paging_init (void)
 {
   uint32_t *pd, *pt;
   size_t page;
   extern char _start, _end_kernel_text;
+  uint32_t features = cpu_features ();
+  bool large_pages = (features & CPUID_PSE) != 0;
+  uint32_t global = features & CPUID_PGE ? PTE_G : 0;
+
+  if (large_pages)
+    cr4_write (cr4_read () | CR4_PSE);
 
   pd = init_page_dir = palloc_get_page (PAL_ASSERT | PAL_ZERO);
   pt = NULL;
@@ -171,13 +213,22 @@ paging_init (void)
       size_t pte_idx = pt_no (vaddr);
       bool in_kernel_text = &_start <= vaddr && vaddr < &_end_kernel_text;
 
+      if (large_pages && pte_idx == 0
+          && page + PTE_CNT <= init_ram_pages
+          && (vaddr + PTSPAN <= &_start || vaddr >= &_end_kernel_text))
+        {
+          pd[pde_idx] = pde_create_kernel_large (vaddr, true) | global;
+          page += PTE_CNT - 1;
+          continue;
+        }
+
       if (pd[pde_idx] == 0)
         {
           pt = palloc_get_page (PAL_ASSERT | PAL_ZERO);
           pd[pde_idx] = pde_create (pt);
         }
 
-      pt[pte_idx] = pte_create_kernel (vaddr, !in_kernel_text);
+      pt[pte_idx] = pte_create_kernel (vaddr, !in_kernel_text) | global;
     }
 
   /* Store the physical address of the page directory into CR3
@@ -186,6 +237,13 @@ paging_init (void)
      to/from Control Registers" and [IA32-v3a] 3.7.5 "Base Address
      of the Page Directory". */
   asm volatile ("movl %0, %%cr3" : : "r" (vtop (init_page_dir)));
+
+  /* Turn on global pages only now, because the boot page tables
+     set up by start.S are not marked global.  Setting CR4.PGE
+     also flushes the whole TLB.  See [IA32-v3a] 3.12
+     "Translation Lookaside Buffers (TLBs)". */
+  if (global)
+    cr4_write (cr4_read () | CR4_PGE);
 }
 
 /* Breaks the kernel command line into words and returns them as
@@ -256,9 +314,17 @@ parse_options (char **argv)
         random_init (atoi (value));
       else if (!strcmp (name, "-mlfqs"))
         thread_mlfqs = true;
+      else if (!strcmp (name, "-ma"))
+        malloc_arena_retain = atoi (value);
 #ifdef USERPROG
       else if (!strcmp (name, "-ul"))
         user_page_limit = atoi (value);
+#endif
+#ifdef VM
+      else if (!strcmp (name, "-stk"))
+        page_stack_max = (size_t) atoi (value) * 1024;
+      else if (!strcmp (name, "-zs"))
+        zstore_page_cnt = atoi (value);
 #endif
       else
         PANIC ("unknown option `%s' (use -h for help)", name);
@@ -379,8 +445,13 @@ usage (void)
 #endif
           "  -rs=SEED           Set random number seed to SEED.\n"
           "  -mlfqs             Use multi-level feedback queue scheduler.\n"
+          "  -ma=COUNT          Keep up to COUNT empty malloc arenas per size.\n"
 #ifdef USERPROG
           "  -ul=COUNT          Limit user memory to COUNT pages.\n"
+#endif
+#ifdef VM
+          "  -stk=KB            Limit each user stack to KB kB (default 1024).\n"
+          "  -zs=COUNT          Keep compressed pages in COUNT kernel pages.\n"
 #endif
           );
   shutdown_power_off ();
@@ -5,6 +5,7 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
+#include "threads/interrupt.h"
 #include "threads/palloc.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
@@ -28,19 +29,65 @@
    blocks, we remove all of the arena's blocks from the free list
    and give the arena back to the page allocator.
 
+   Returning every empty arena right away makes a workload that
+   repeatedly allocates and frees a single block bounce a page
+   through the page allocator on every call.  To avoid that, each
+   descriptor keeps up to malloc_arena_retain empty arenas (with
+   their blocks still on the free list) on its empty_list.  An
+   arena leaves the empty list as soon as one of its blocks is
+   handed out again.  Retained arenas are given back by
+   malloc_reclaim(), which the page allocator calls when the
+   kernel pool runs dry.
+
+   Taking a descriptor's lock on every call is expensive, so in
+   front of each free list sits a small "magazine" of free
+   blocks.  malloc() takes a block from the magazine and free()
+   puts one back, each with interrupts disabled but without
+   taking any lock.  Only when the magazine is empty (or full)
+   do we take the lock, to move half a magazine's worth of blocks
+   from (or to) the free list in one batch.  Pintos runs on a
+   single CPU, so one magazine per descriptor is a per-CPU
+   magazine, and disabling interrupts is enough to protect it.
+   Blocks sitting in a magazine count as allocated as far as
+   their arena is concerned.
+
    We can't handle blocks bigger than 2 kB using this scheme,
    because they're too big to fit in a single page with a
    descriptor.  We handle those by allocating contiguous pages
    with the page allocator and sticking the allocation size at
    the beginning of the allocated block's arena header. */
 
+/* Number of blocks a magazine holds. */
+#define MAG_SIZE 16
+
+/* Number of blocks moved between a magazine and its free list at
+   a time. */
+#define MAG_BATCH (MAG_SIZE / 2)
+
+/* Magazine: a stack of free blocks that can be handed out
+   without taking the descriptor lock. */
+struct magazine
+  {
+    size_t cnt;                         /* Number of blocks. */
+    struct block *blocks[MAG_SIZE];     /* Blocks, top at CNT - 1. */
+  };
+
 /* Descriptor. */
 struct desc
   {
     size_t block_size;          /* Size of each element in bytes. */
     size_t blocks_per_arena;    /* Number of blocks in an arena. */
     struct list free_list;      /* List of free blocks. */
+    struct list empty_list;     /* Arenas with no blocks in use. */
+    size_t empty_cnt;           /* Number of arenas in empty_list. */
     struct lock lock;           /* Lock. */
+    struct magazine mag;        /* Blocks usable without LOCK. */
+
+    /* Statistics. */
+    unsigned long long arena_get_cnt;   /* Arenas obtained from palloc. */
+    unsigned long long arena_put_cnt;   /* Arenas returned by free(). */
+    unsigned long long arena_retain_cnt; /* Empty arenas kept by free(). */
+    unsigned long long arena_reclaim_cnt; /* Arenas reclaimed. */
   };
 
 /* Magic number for detecting arena corruption. */
@@ -52,6 +99,7 @@ struct arena
     unsigned magic;             /* Always set to ARENA_MAGIC. */
     struct desc *desc;          /* Owning descriptor, null for big block. */
     size_t free_cnt;            /* Free blocks; pages in big block. */
+    struct list_elem empty_elem; /* Element in desc's empty_list. */
   };
 
 /* Free block. */
@@ -64,8 +112,16 @@ struct block
 static struct desc descs[10];   /* Descriptors. */
 static size_t desc_cnt;         /* Number of descriptors. */
 
+/* Maximum number of empty arenas kept per descriptor.
+   Controlled by kernel command-line option "-ma=COUNT". */
+size_t malloc_arena_retain = 1;
+
 static struct arena *block_to_arena (struct block *);
 static struct block *arena_to_block (struct arena *, size_t idx);
+static void release_arena (struct desc *, struct arena *);
+static struct block *take_block (struct desc *);
+static void put_block (struct desc *, struct block *);
+static void drain_magazine (struct desc *);
 
 /* Initializes the malloc() descriptors. */
 void
@@ -80,6 +136,7 @@ malloc_init (void)
       d->block_size = block_size;
       d->blocks_per_arena = (PGSIZE - sizeof (struct arena)) / block_size;
       list_init (&d->free_list);
+      list_init (&d->empty_list);
       lock_init (&d->lock);
     }
 }
@@ -92,6 +149,7 @@ malloc (size_t size)
   struct desc *d;
   struct block *b;
   struct arena *a;
+  enum intr_level old_level;
 
   /* A null pointer satisfies a request for 0 bytes. */
   if (size == 0)
@@ -119,36 +177,46 @@ malloc (size_t size)
       return a + 1;
     }
 
-  lock_acquire (&d->lock);
+  /* Common case: take a block from the magazine. */
+  old_level = intr_disable ();
+  if (d->mag.cnt > 0)
+    {
+      b = d->mag.blocks[--d->mag.cnt];
+      intr_set_level (old_level);
+      return b;
+    }
+  intr_set_level (old_level);
 
-  /* If the free list is empty, create a new arena. */
-  if (list_empty (&d->free_list))
+  /* The magazine is empty.  Take a block for the caller from the
+     free list, along with a batch to refill the magazine, but
+     don't create new arenas just for the refill. */
+  lock_acquire (&d->lock);
+  b = take_block (d);
+  if (b != NULL)
     {
       size_t i;
 
-      /* Allocate a page. */
-      a = palloc_get_page (0);
-      if (a == NULL) 
+      for (i = 1; i < MAG_BATCH && !list_empty (&d->free_list); i++)
         {
-          lock_release (&d->lock);
-          return NULL; 
-        }
+          struct block *extra = take_block (d);
 
-      /* Initialize arena and add its blocks to the free list. */
-      a->magic = ARENA_MAGIC;
-      a->desc = d;
-      a->free_cnt = d->blocks_per_arena;
-      for (i = 0; i < d->blocks_per_arena; i++) 
-        {
-          struct block *b = arena_to_block (a, i);
-          list_push_back (&d->free_list, &b->free_elem);
+          old_level = intr_disable ();
+          if (d->mag.cnt < MAG_SIZE)
+            {
+              d->mag.blocks[d->mag.cnt++] = extra;
+              extra = NULL;
+            }
+          intr_set_level (old_level);
+
+          if (extra != NULL)
+            {
+              /* Another thread refilled the magazine while we
+                 were working.  Give the block back and stop. */
+              put_block (d, extra);
+              break;
+            }
         }
     }
-
-  /* Get a block from free list and return it. */
-  b = list_entry (list_pop_front (&d->free_list), struct block, free_elem);
-  a = block_to_arena (b);
-  a->free_cnt--;
   lock_release (&d->lock);
   return b;
 }
@@ -226,6 +294,10 @@ free (void *p)
       
       if (d != NULL) 
         {
+          struct block *batch[MAG_BATCH];
+          enum intr_level old_level;
+          size_t i;
+
           /* It's a normal block.  We handle it here. */
 
 #ifndef NDEBUG
@@ -233,25 +305,26 @@ free (void *p)
           memset (b, 0xcc, d->block_size);
 #endif
   
-          lock_acquire (&d->lock);
-
-          /* Add block to free list. */
-          list_push_front (&d->free_list, &b->free_elem);
-
-          /* If the arena is now entirely unused, free it. */
-          if (++a->free_cnt >= d->blocks_per_arena) 
+          /* Common case: put the block in the magazine. */
+          old_level = intr_disable ();
+          if (d->mag.cnt < MAG_SIZE)
             {
-              size_t i;
-
-              ASSERT (a->free_cnt == d->blocks_per_arena);
-              for (i = 0; i < d->blocks_per_arena; i++) 
-                {
-                  struct block *b = arena_to_block (a, i);
-                  list_remove (&b->free_elem);
-                }
-              palloc_free_page (a);
+              d->mag.blocks[d->mag.cnt++] = b;
+              intr_set_level (old_level);
+              return;
             }
 
+          /* The magazine is full.  Move a batch of blocks out of
+             it, and return them along with B to the free
+             list. */
+          d->mag.cnt -= MAG_BATCH;
+          memcpy (batch, d->mag.blocks + d->mag.cnt, sizeof batch);
+          intr_set_level (old_level);
+
+          lock_acquire (&d->lock);
+          for (i = 0; i < MAG_BATCH; i++)
+            put_block (d, batch[i]);
+          put_block (d, b);
           lock_release (&d->lock);
         }
       else
@@ -263,6 +336,178 @@ free (void *p)
     }
 }
 
+/* Gives every empty arena retained by malloc() back to the page
+   allocator, after first returning the blocks in each magazine
+   to their free list so that their arenas can empty out too.
+   Returns the number of pages freed.
+
+   Called by the page allocator when the kernel pool is
+   exhausted, possibly from inside malloc() itself with a
+   descriptor lock held, so descriptors whose lock is busy,
+   including one held by the running thread, are skipped rather
+   than waited for. */
+size_t
+malloc_reclaim (void)
+{
+  size_t page_cnt = 0;
+  struct desc *d;
+
+  for (d = descs; d < descs + desc_cnt; d++)
+    if ((d->empty_cnt > 0 || d->mag.cnt > 0)
+        && !lock_held_by_current_thread (&d->lock)
+        && lock_try_acquire (&d->lock))
+      {
+        drain_magazine (d);
+        while (!list_empty (&d->empty_list))
+          {
+            struct list_elem *e = list_pop_front (&d->empty_list);
+            release_arena (d, list_entry (e, struct arena, empty_elem));
+            d->arena_reclaim_cnt++;
+            page_cnt++;
+          }
+        d->empty_cnt = 0;
+        lock_release (&d->lock);
+      }
+  return page_cnt;
+}
+
+/* Prints malloc() arena statistics. */
+void
+malloc_print_stats (void)
+{
+  unsigned long long get_cnt = 0, put_cnt = 0;
+  unsigned long long retain_cnt = 0, reclaim_cnt = 0;
+  size_t empty_cnt = 0;
+  struct desc *d;
+
+  for (d = descs; d < descs + desc_cnt; d++)
+    {
+      get_cnt += d->arena_get_cnt;
+      put_cnt += d->arena_put_cnt;
+      retain_cnt += d->arena_retain_cnt;
+      reclaim_cnt += d->arena_reclaim_cnt;
+      empty_cnt += d->empty_cnt;
+    }
+  printf ("Malloc: %llu arenas allocated, %llu freed, %llu retained, "
+          "%llu reclaimed, %zu empty\n",
+          get_cnt, put_cnt, retain_cnt, reclaim_cnt, empty_cnt);
+}
+
+/* Takes a block from D's free list, creating a new arena if the
+   free list is empty, and returns it.  Returns a null pointer if
+   a new arena is needed but no page is available.  D's lock must
+   be held. */
+static struct block *
+take_block (struct desc *d)
+{
+  struct block *b;
+  struct arena *a;
+
+  ASSERT (lock_held_by_current_thread (&d->lock));
+
+  /* If the free list is empty, create a new arena. */
+  if (list_empty (&d->free_list))
+    {
+      size_t i;
+
+      /* Allocate a page. */
+      a = palloc_get_page (0);
+      if (a == NULL) 
+        return NULL; 
+
+      /* Initialize arena and add its blocks to the free list. */
+      a->magic = ARENA_MAGIC;
+      a->desc = d;
+      a->free_cnt = d->blocks_per_arena;
+      for (i = 0; i < d->blocks_per_arena; i++) 
+        {
+          struct block *b = arena_to_block (a, i);
+          list_push_back (&d->free_list, &b->free_elem);
+        }
+      list_push_front (&d->empty_list, &a->empty_elem);
+      d->empty_cnt++;
+      d->arena_get_cnt++;
+    }
+
+  /* Get a block from free list and return it.
+     If its arena was empty, it is no longer. */
+  b = list_entry (list_pop_front (&d->free_list), struct block, free_elem);
+  a = block_to_arena (b);
+  if (a->free_cnt-- == d->blocks_per_arena)
+    {
+      list_remove (&a->empty_elem);
+      d->empty_cnt--;
+    }
+  return b;
+}
+
+/* Returns block B to D's free list.  If B's arena thereby
+   becomes entirely unused, retains it for reuse if there is
+   room, otherwise frees it.  D's lock must be held. */
+static void
+put_block (struct desc *d, struct block *b)
+{
+  struct arena *a = block_to_arena (b);
+
+  ASSERT (lock_held_by_current_thread (&d->lock));
+  ASSERT (a->desc == d);
+
+  /* Add block to free list. */
+  list_push_front (&d->free_list, &b->free_elem);
+
+  if (++a->free_cnt >= d->blocks_per_arena) 
+    {
+      ASSERT (a->free_cnt == d->blocks_per_arena);
+      if (d->empty_cnt < malloc_arena_retain)
+        {
+          list_push_front (&d->empty_list, &a->empty_elem);
+          d->empty_cnt++;
+          d->arena_retain_cnt++;
+        }
+      else
+        {
+          release_arena (d, a);
+          d->arena_put_cnt++;
+        }
+    }
+}
+
+/* Returns every block in D's magazine to D's free list.  D's
+   lock must be held. */
+static void
+drain_magazine (struct desc *d)
+{
+  for (;;)
+    {
+      enum intr_level old_level = intr_disable ();
+      struct block *b = d->mag.cnt > 0 ? d->mag.blocks[--d->mag.cnt] : NULL;
+      intr_set_level (old_level);
+
+      if (b == NULL)
+        break;
+      put_block (d, b);
+    }
+}
+
+/* Removes all of the blocks of arena A, which must be entirely
+   unused and not on D's empty list, from D's free list and gives
+   A back to the page allocator.  D's lock must be held. */
+static void
+release_arena (struct desc *d, struct arena *a)
+{
+  size_t i;
+
+  ASSERT (lock_held_by_current_thread (&d->lock));
+  ASSERT (a->free_cnt == d->blocks_per_arena);
+
+  for (i = 0; i < d->blocks_per_arena; i++) 
+    {
+      struct block *b = arena_to_block (a, i);
+      list_remove (&b->free_elem);
+    }
+  palloc_free_page (a);
+}
+
 /* Returns the arena that block B is inside. */
 static struct arena *
 block_to_arena (struct block *b)
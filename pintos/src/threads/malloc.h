@@ -4,10 +4,15 @@
 #include <debug.h>
 #include <stddef.h>
 
+/* Maximum number of empty arenas retained per size class. */
+extern size_t malloc_arena_retain;
+
 void malloc_init (void);
 void *malloc (size_t) __attribute__ ((malloc));
 void *calloc (size_t, size_t) __attribute__ ((malloc));
 void *realloc (void *, size_t);
 void free (void *);
+size_t malloc_reclaim (void);
+void malloc_print_stats (void);
 
 #endif /* threads/malloc.h */
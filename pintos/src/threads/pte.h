@@ -51,7 +51,8 @@ static inline uintptr_t pd_no (const void *va) {
    |         Physical Address           |         Flags          |
    +------------------------------------+------------------------+
 
-   In a PDE, the physical address points to a page table.
+   In a PDE, the physical address points to a page table, or,
+   if PTE_PS is set, to a 4 MB "large page" of data or code.
    In a PTE, the physical address points to a data or code page.
    The important flags are listed below.
    When a PDE or PTE is not "present", the other flags are
@@ -66,6 +67,12 @@ static inline uintptr_t pd_no (const void *va) {
 #define PTE_U 0x4               /* 1=user/kernel, 0=kernel only. */
 #define PTE_A 0x20              /* 1=accessed, 0=not acccessed. */
 #define PTE_D 0x40              /* 1=dirty, 0=not dirty (PTEs only). */
+#define PTE_PS 0x80             /* 1=4 MB page, 0=page table (PDEs only). */
+#define PTE_G 0x100             /* 1=global, kept in TLB across CR3 loads. */
+
+/* Number of PTEs in a page table, which is also the number of
+   4 kB pages spanned by a single PDE. */
+#define PTE_CNT (PTSPAN / PGSIZE)
 
 /* Returns a PDE that points to page table PT. */
 static inline uint32_t pde_create (uint32_t *pt) {
@@ -73,10 +80,30 @@ static inline uint32_t pde_create (uint32_t *pt) {
   return vtop (pt) | PTE_U | PTE_P | PTE_W;
 }
 
+/* Returns a PDE that maps the 4 MB region starting at PAGE
+   directly, without a page table, as a "large page".
+   PAGE must be aligned on a 4 MB boundary.
+   If WRITABLE is true then it will be writable as well.
+   The region will be usable only by ring 0 code (the kernel).
+   Large pages require the CPU's Page Size Extension to be
+   enabled in CR4.  See [IA32-v3a] 3.7.3 "Mixing 4-KByte and
+   4-MByte Pages". */
+static inline uint32_t pde_create_kernel_large (void *page, bool writable) {
+  ASSERT (((uintptr_t) page & (PTSPAN - 1)) == 0);
+  return vtop (page) | PTE_PS | PTE_P | (writable ? PTE_W : 0);
+}
+
+/* Returns true if PDE maps a 4 MB large page rather than
+   pointing to a page table. */
+static inline bool pde_is_large (uint32_t pde) {
+  return (pde & (PTE_P | PTE_PS)) == (PTE_P | PTE_PS);
+}
+
 /* Returns a pointer to the page table that page directory entry
-   PDE, which must "present", points to. */
+   PDE, which must "present" and not a large page, points to. */
 static inline uint32_t *pde_get_pt (uint32_t pde) {
   ASSERT (pde & PTE_P);
+  ASSERT (!pde_is_large (pde));
   return ptov (pde & PTE_ADDR);
 }
 
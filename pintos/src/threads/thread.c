@@ -508,6 +508,18 @@ init_thread (struct thread *t, const char *name, int priority)
   t->initial_priority=priority;
   t->magic = THREAD_MAGIC;
   list_init(&t->priority_donation);
+#ifdef USERPROG
+  t->leader = t;
+  t->exit_code = -1;
+  lock_init (&t->process_lock);
+  list_init (&t->children);
+  list_init (&t->threads);
+  cond_init (&t->threads_done);
+#endif
+#ifdef VM
+  list_init (&t->mappings);
+  list_init (&t->shm);
+#endif
   list_push_back (&all_list, &t->allelem);
 }
 
@@ -580,7 +592,14 @@ thread_schedule_tail (struct thread *prev)
   if (prev != NULL && prev->status == THREAD_DYING && prev != initial_thread) 
     {
       ASSERT (prev != cur);
-      palloc_free_page (prev);
+#ifdef USERPROG
+      /* A process's address space is torn down, and its struct
+         thread freed, by the reaper. */
+      if (prev->exited)
+        process_reap (prev);
+      else
+#endif
+        palloc_free_page (prev);
     }
 }
 
@@ -2,8 +2,13 @@
 #define THREADS_THREAD_H
 
 #include <debug.h>
+#include <hash.h>
 #include <list.h>
 #include <stdint.h>
+#include "threads/synch.h"
+#ifdef USERPROG
+#include "userprog/fault.h"
+#endif
 
 /* States in a thread's life cycle. */
 enum thread_status
@@ -97,8 +102,95 @@ struct thread
     int64_t ticks;
 
 #ifdef USERPROG
-    /* Owned by userprog/process.c. */
+    /* Owned by userprog/process.c.
+
+       A process may have several threads, all sharing one page
+       directory and file descriptor table.  The process's state
+       is kept in the struct thread of its first thread, its
+       "leader", which outlives the others.  Members marked
+       "leader" below are used only in the leader. */
     uint32_t *pagedir;                  /* Page directory. */
+    struct thread *leader;              /* Thread that holds this
+                                           thread's process state. */
+    struct file *exec_file;             /* Running executable (leader). */
+    int exit_code;                      /* Exit code. */
+    bool quiet_exit;                    /* Leave the process's exit code
+                                           alone on exit? */
+    struct wait_status *wait_status;    /* This process's completion
+                                           status (leader). */
+    struct lock process_lock;           /* Protects `children',
+                                           `threads', `thread_cnt',
+                                           and `exiting' (leader). */
+    struct list children;               /* Completion status of
+                                           children (leader). */
+    struct list threads;                /* Completion status of other
+                                           threads (leader). */
+    unsigned thread_cnt;                /* Other threads still running
+                                           (leader). */
+    struct condition threads_done;      /* Broadcast when another thread
+                                           ends or the process begins
+                                           to end (leader). */
+    bool exiting;                       /* Ending, so that every
+                                           thread must die (leader). */
+    int process_exit_code;              /* Process's exit code
+                                           (leader). */
+    struct join_status *join_status;    /* Own completion status, if
+                                           not the leader. */
+    bool exited;                        /* Exited, awaiting the
+                                           reaper? */
+
+    /* Owned by userprog/exception.c. */
+    struct fault_stats fault_stats;     /* Page faults, by kind. */
+
+    /* Owned by userprog/syscall.c. */
+    struct fd_table *fds;               /* File descriptors, or null.
+                                           Shared by a process's
+                                           threads. */
+    struct open_file *held_file;        /* Object in use by the running
+                                           system call, or null. */
+    struct iovec *held_iov;             /* Vector copied in by the
+                                           running readv or writev
+                                           system call, or null. */
+
+    /* Owned by userprog/aio.c. */
+    struct aio_context *aio;            /* Asynchronous I/O, or null. */
+#endif
+#ifdef VM
+    /* Owned by userprog/syscall.c. */
+    struct list mappings;               /* Memory-mapped files (leader). */
+    int next_mapping;                   /* Next mapping id (leader). */
+
+    /* Owned by vm/shm.c. */
+    struct list shm;                    /* Shared memory references
+                                           (leader). */
+
+    /* Owned by vm/page.c. */
+    struct hash pages;                  /* Supplemental page table
+                                           (leader). */
+    struct lock page_lock;              /* Protects `pages',
+                                           `stack_ahead', `mappings',
+                                           and `shm' (leader). */
+    unsigned stack_ahead;               /* Stack pages to add per fault
+                                           (leader). */
+    void *user_esp;                     /* User stack pointer on entry
+                                           to a system call. */
+
+    /* Owned by vm/swap.c. */
+    unsigned swap_in_cnt;               /* Pages swapped in. */
+    unsigned swap_out_cnt;              /* Pages swapped out. */
+
+    /* Owned by vm/ws.c. */
+    unsigned ws_size;                   /* Working set size, in pages. */
+    unsigned ws_resident;               /* Pages in memory. */
+    unsigned ws_allot;                  /* Frames allotted. */
+    unsigned ws_size_next;              /* Counts for the next sample. */
+    unsigned ws_resident_next;
+    unsigned long long ws_faults;       /* Page faults at last sample. */
+    bool ws_suspend;                    /* Suspended by load control?
+                                           (leader) */
+    bool ws_blocked;                    /* Blocked in ws_check_suspend()? */
+    unsigned ws_saved;                  /* Working set when suspended. */
+    unsigned ws_suspended_at;           /* Period when suspended. */
 #endif
 
     /* Owned by thread.c. */
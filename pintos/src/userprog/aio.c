@@ -0,0 +1,477 @@
+#include "userprog/aio.h"
+#include <aio.h>
+#include <debug.h>
+#include <list.h>
+#include <stdio.h>
+#include "userprog/fdtable.h"
+#include "userprog/usercopy.h"
+#include "filesys/file.h"
+#include "filesys/filesys.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+/* Asynchronous file I/O.
+
+   A process's rings (see lib/aio.h) live in its own memory, and
+   kernel threads other than the process's cannot reach that
+   memory.  So the process's own thread does everything that
+   touches it, within aio_enter(): it takes new submissions from
+   the submission ring, copying the data of writes into kernel
+   buffers, and it posts finished requests to the completion ring,
+   copying the data of reads out of kernel buffers.  In between,
+   a pool of AIO_WORKERS kernel threads carries out reads and
+   writes, which is where all of the time goes.
+
+   An AIO_FSYNC request never goes to a worker.  It waits in its
+   context's list of incomplete requests until every request on
+   the same file descriptor submitted before it has completed.
+   The file system writes through to disk, so that is all an
+   fsync has to do.
+
+   Each thread of a process has rings of its own, so that threads
+   need not coordinate their use of them. */
+
+/* Number of worker threads. */
+#define AIO_WORKERS 2
+
+/* A request. */
+struct aio_request
+  {
+    struct list_elem elem;      /* In `queue' or context's `done'. */
+    struct list_elem ctx_elem;  /* In context's `requests'. */
+    struct aio_context *ctx;    /* Owning context. */
+    struct aio_sqe sqe;         /* Submission. */
+    struct file *file;          /* Own handle on SQE.fd's file. */
+    void *buffer;               /* Kernel copy of SQE.buf's data. */
+    int result;                 /* Result, once complete. */
+  };
+
+/* A process's asynchronous I/O state. */
+struct aio_context
+  {
+    /* Owned by the process. */
+    struct aio_ring *uring;     /* Rings, in user memory. */
+    unsigned sq_head;           /* Kernel's copy of uring->sq_head. */
+    unsigned cq_tail;           /* Kernel's copy of uring->cq_tail. */
+    unsigned sq_entries;        /* Kernel's copy of uring->sq_entries. */
+    unsigned cq_entries;        /* Kernel's copy of uring->cq_entries. */
+    struct aio_sqe *sqes;       /* Kernel's copy of uring->sqes. */
+    struct aio_cqe *cqes;       /* Kernel's copy of uring->cqes. */
+
+    /* Shared with the workers. */
+    struct lock lock;           /* Protects the members below. */
+    struct condition changed;   /* Signaled when a request completes. */
+    struct list requests;       /* Incomplete requests, oldest first. */
+    struct list done;           /* Complete requests not yet posted. */
+  };
+
+/* Requests for the workers, oldest first. */
+static struct list queue;
+static struct lock queue_lock;
+static struct condition queue_nonempty;
+
+/* Statistics.  Protected by queue_lock. */
+static unsigned long long request_cnt;  /* Requests submitted. */
+static unsigned long long byte_cnt;     /* Bytes transferred. */
+static size_t busy_cnt;                 /* Requests in flight. */
+static size_t max_busy_cnt;             /* Most requests in flight. */
+
+static thread_func aio_worker NO_RETURN;
+
+/* Starts the worker threads. */
+void
+aio_init (void)
+{
+  int i;
+
+  list_init (&queue);
+  lock_init (&queue_lock);
+  cond_init (&queue_nonempty);
+  for (i = 0; i < AIO_WORKERS; i++)
+    if (thread_create ("aio", PRI_DEFAULT, aio_worker, NULL) == TID_ERROR)
+      PANIC ("couldn't start aio worker");
+}
+
+/* Kills the running process.  Must be called only where it holds
+   no locks. */
+static void
+kill_process (void)
+{
+  thread_current ()->exit_code = -1;
+  thread_exit ();
+}
+
+/* Copies SIZE bytes from user address USRC to kernel address
+   DST.  Kills the process if USRC is not valid. */
+static void
+copy_in (void *dst, const void *usrc, size_t size)
+{
+  if (copy_from_user (dst, usrc, size) != 0)
+    kill_process ();
+}
+
+/* Copies SIZE bytes from kernel address SRC to user address
+   UDST.  Returns true if successful, false if UDST is not valid. */
+static bool
+try_copy_out (void *udst, const void *src, size_t size)
+{
+  return copy_to_user (udst, src, size) == 0;
+}
+
+/* Returns true if X is a power of 2. */
+static bool
+is_power_of_2 (unsigned x)
+{
+  return x != 0 && (x & (x - 1)) == 0;
+}
+
+/* Registers the rings in URING for the running process.  Returns
+   0 if successful, or -1 if the process already has rings, if
+   URING is malformed, or if memory is not available. */
+int
+aio_setup (struct aio_ring *uring)
+{
+  struct thread *cur = thread_current ();
+  struct aio_context *ctx;
+  struct aio_ring ring;
+
+  copy_in (&ring, uring, sizeof ring);
+  if (cur->aio != NULL
+      || !is_power_of_2 (ring.sq_entries) || !is_power_of_2 (ring.cq_entries))
+    return -1;
+
+  ctx = malloc (sizeof *ctx);
+  if (ctx == NULL)
+    return -1;
+  ctx->uring = uring;
+  ctx->sq_head = ring.sq_head;
+  ctx->cq_tail = ring.cq_tail;
+  ctx->sq_entries = ring.sq_entries;
+  ctx->cq_entries = ring.cq_entries;
+  ctx->sqes = ring.sqes;
+  ctx->cqes = ring.cqes;
+  lock_init (&ctx->lock);
+  cond_init (&ctx->changed);
+  list_init (&ctx->requests);
+  list_init (&ctx->done);
+  cur->aio = ctx;
+  return 0;
+}
+
+/* Moves R, which is in CTX's `requests' list, to its `done' list
+   with the given RESULT.  CTX's lock must be held. */
+static void
+finish (struct aio_context *ctx, struct aio_request *r, int result)
+{
+  ASSERT (lock_held_by_current_thread (&ctx->lock));
+
+  r->result = result;
+  list_remove (&r->ctx_elem);
+  list_push_back (&ctx->done, &r->elem);
+  cond_broadcast (&ctx->changed, &ctx->lock);
+}
+
+/* Completes each AIO_FSYNC request in CTX that no earlier request
+   on the same file descriptor is still holding up.  CTX's lock
+   must be held. */
+static void
+release_barriers (struct aio_context *ctx)
+{
+  struct list_elem *e, *next;
+
+  for (e = list_begin (&ctx->requests); e != list_end (&ctx->requests);
+       e = next)
+    {
+      struct aio_request *r = list_entry (e, struct aio_request, ctx_elem);
+      struct list_elem *f;
+
+      next = list_next (e);
+      if (r->sqe.op != AIO_FSYNC)
+        continue;
+      for (f = list_begin (&ctx->requests); f != e; f = list_next (f))
+        if (list_entry (f, struct aio_request, ctx_elem)->sqe.fd == r->sqe.fd)
+          break;
+      if (f == e)
+        finish (ctx, r, 0);
+    }
+}
+
+/* Completes request R with the given RESULT. */
+static void
+complete (struct aio_request *r, int result)
+{
+  struct aio_context *ctx = r->ctx;
+
+  lock_acquire (&ctx->lock);
+  finish (ctx, r, result);
+  release_barriers (ctx);
+  lock_release (&ctx->lock);
+}
+
+/* Starts carrying out request R, whose submission has been filled
+   in, on behalf of CTX.  FILE is the file open as the request's
+   descriptor, or a null pointer if there is none. */
+static void
+start_on_file (struct aio_context *ctx, struct aio_request *r,
+               struct file *file)
+{
+  struct aio_sqe *sqe = &r->sqe;
+
+  r->ctx = ctx;
+  r->file = NULL;
+  r->buffer = NULL;
+  lock_acquire (&ctx->lock);
+  list_push_back (&ctx->requests, &r->ctx_elem);
+  lock_release (&ctx->lock);
+
+  /* Check the request. */
+  if (file == NULL
+      || (sqe->op != AIO_READ && sqe->op != AIO_WRITE && sqe->op != AIO_FSYNC)
+      || sqe->len > AIO_MAX_LEN)
+    {
+      complete (r, -1);
+      return;
+    }
+  if (sqe->op == AIO_FSYNC)
+    {
+      lock_acquire (&ctx->lock);
+      release_barriers (ctx);
+      lock_release (&ctx->lock);
+      return;
+    }
+  if (sqe->len == 0)
+    {
+      complete (r, 0);
+      return;
+    }
+
+  /* Get a kernel buffer, with the data to write, and our own
+     handle on the file, so that closing the file descriptor does
+     not affect the request. */
+  r->buffer = malloc (sqe->len);
+  if (r->buffer == NULL)
+    {
+      complete (r, -1);
+      return;
+    }
+  if (sqe->op == AIO_WRITE
+      && copy_from_user (r->buffer, sqe->buf, sqe->len) != 0)
+    {
+      complete (r, -1);
+      return;
+    }
+  lock_acquire (&filesys_lock);
+  r->file = file_reopen (file);
+  lock_release (&filesys_lock);
+  if (r->file == NULL)
+    {
+      complete (r, -1);
+      return;
+    }
+
+  /* Hand it to the workers. */
+  lock_acquire (&queue_lock);
+  list_push_back (&queue, &r->elem);
+  request_cnt++;
+  if (++busy_cnt > max_busy_cnt)
+    max_busy_cnt = busy_cnt;
+  cond_signal (&queue_nonempty, &queue_lock);
+  lock_release (&queue_lock);
+}
+
+/* Starts carrying out request R, whose submission has been filled
+   in, on behalf of CTX.  Holds a reference to the request's open
+   file meanwhile, in case another thread closes its descriptor. */
+static void
+start (struct aio_context *ctx, struct aio_request *r)
+{
+  struct open_file *of = fdtable_get (thread_current ()->fds, r->sqe.fd);
+
+  start_on_file (ctx, r, of != NULL && of->kind == FD_FILE ? of->file : NULL);
+  if (of != NULL)
+    fdtable_put (of);
+}
+
+/* Takes up to TO_SUBMIT new submissions from CTX's submission
+   ring and starts them. */
+static void
+submit (struct aio_context *ctx, unsigned to_submit)
+{
+  unsigned sq_tail;
+
+  copy_in (&sq_tail, &ctx->uring->sq_tail, sizeof sq_tail);
+  for (; to_submit > 0 && ctx->sq_head != sq_tail; to_submit--)
+    {
+      struct aio_request *r = malloc (sizeof *r);
+      if (r == NULL)
+        break;
+      if (copy_from_user (&r->sqe,
+                          &ctx->sqes[ctx->sq_head & (ctx->sq_entries - 1)],
+                          sizeof r->sqe) != 0)
+        {
+          free (r);
+          kill_process ();
+        }
+      ctx->sq_head++;
+      start (ctx, r);
+    }
+  if (!try_copy_out (&ctx->uring->sq_head, &ctx->sq_head,
+                     sizeof ctx->sq_head))
+    kill_process ();
+}
+
+/* Frees request R, which is complete. */
+static void
+free_request (struct aio_request *r)
+{
+  free (r->buffer);
+  free (r);
+}
+
+/* Posts complete request R to CTX's completion ring, which must
+   have room for it, and frees R.  Returns false, without freeing
+   R, if the ring is not valid. */
+static bool
+post (struct aio_context *ctx, struct aio_request *r)
+{
+  struct aio_cqe cqe;
+
+  cqe.user_data = r->sqe.user_data;
+  cqe.result = r->result;
+  if (r->sqe.op == AIO_READ && cqe.result > 0
+      && !try_copy_out (r->sqe.buf, r->buffer, cqe.result))
+    cqe.result = -1;
+  if (!try_copy_out (&ctx->cqes[ctx->cq_tail & (ctx->cq_entries - 1)],
+                     &cqe, sizeof cqe))
+    return false;
+  ctx->cq_tail++;
+  free_request (r);
+  return true;
+}
+
+/* Waits until at least MIN_COMPLETE requests of CTX are complete,
+   or until none are in progress, and then posts as many complete
+   requests as fit to the completion ring.  Returns the number
+   posted. */
+static int
+reap (struct aio_context *ctx, unsigned min_complete)
+{
+  unsigned cq_head;
+  int posted = 0;
+
+  lock_acquire (&ctx->lock);
+  while (list_size (&ctx->done) < min_complete
+         && !list_empty (&ctx->requests))
+    cond_wait (&ctx->changed, &ctx->lock);
+  lock_release (&ctx->lock);
+
+  copy_in (&cq_head, &ctx->uring->cq_head, sizeof cq_head);
+  while (ctx->cq_tail - cq_head < ctx->cq_entries)
+    {
+      struct aio_request *r;
+
+      lock_acquire (&ctx->lock);
+      r = (list_empty (&ctx->done) ? NULL
+           : list_entry (list_pop_front (&ctx->done),
+                         struct aio_request, elem));
+      lock_release (&ctx->lock);
+      if (r == NULL)
+        break;
+
+      if (!post (ctx, r))
+        {
+          lock_acquire (&ctx->lock);
+          list_push_front (&ctx->done, &r->elem);
+          lock_release (&ctx->lock);
+          kill_process ();
+        }
+      posted++;
+    }
+  if (!try_copy_out (&ctx->uring->cq_tail, &ctx->cq_tail,
+                     sizeof ctx->cq_tail))
+    kill_process ();
+  return posted;
+}
+
+/* Starts up to TO_SUBMIT new requests from the running process's
+   submission ring, then waits for at least MIN_COMPLETE requests
+   to complete, or for all of them if fewer are in progress, and
+   posts as many completions as fit to its completion ring.
+   Returns the number of completions posted, or -1 if the process
+   has not called aio_setup(). */
+int
+aio_enter (unsigned to_submit, unsigned min_complete)
+{
+  struct aio_context *ctx = thread_current ()->aio;
+
+  if (ctx == NULL)
+    return -1;
+  submit (ctx, to_submit);
+  return reap (ctx, min_complete);
+}
+
+/* Waits for the running process's requests to complete and frees
+   its asynchronous I/O state.  Called when it exits. */
+void
+aio_exit (void)
+{
+  struct thread *cur = thread_current ();
+  struct aio_context *ctx = cur->aio;
+
+  if (ctx == NULL)
+    return;
+
+  lock_acquire (&ctx->lock);
+  while (!list_empty (&ctx->requests))
+    cond_wait (&ctx->changed, &ctx->lock);
+  lock_release (&ctx->lock);
+
+  while (!list_empty (&ctx->done))
+    free_request (list_entry (list_pop_front (&ctx->done),
+                              struct aio_request, elem));
+  free (ctx);
+  cur->aio = NULL;
+}
+
+/* Prints asynchronous I/O statistics. */
+void
+aio_print_stats (void)
+{
+  printf ("AIO: %llu requests, %llu bytes, %zu most in flight\n",
+          request_cnt, byte_cnt, max_busy_cnt);
+}
+
+/* A worker thread. */
+static void
+aio_worker (void *aux UNUSED)
+{
+  for (;;)
+    {
+      struct aio_request *r;
+      off_t result;
+
+      lock_acquire (&queue_lock);
+      while (list_empty (&queue))
+        cond_wait (&queue_nonempty, &queue_lock);
+      r = list_entry (list_pop_front (&queue), struct aio_request, elem);
+      lock_release (&queue_lock);
+
+      lock_acquire (&filesys_lock);
+      if (r->sqe.op == AIO_READ)
+        result = file_read_at (r->file, r->buffer, r->sqe.len,
+                               r->sqe.offset);
+      else
+        result = file_write_at (r->file, r->buffer, r->sqe.len,
+                                r->sqe.offset);
+      file_close (r->file);
+      lock_release (&filesys_lock);
+      r->file = NULL;
+
+      lock_acquire (&queue_lock);
+      busy_cnt--;
+      byte_cnt += result;
+      lock_release (&queue_lock);
+      complete (r, result);
+    }
+}
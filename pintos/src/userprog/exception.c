@@ -1,14 +1,45 @@
 #include "userprog/exception.h"
 #include <inttypes.h>
 #include <stdio.h>
+#include <string.h>
 #include "userprog/gdt.h"
+#include "userprog/syscall.h"
+#include "userprog/usercopy.h"
+#include "threads/cpu.h"
+#include "threads/flags.h"
 #include "threads/interrupt.h"
 #include "threads/thread.h"
+#include "threads/vaddr.h"
+#ifdef VM
+#include "vm/page.h"
+#include "vm/ws.h"
+#endif
 
 /* Number of page faults processed. */
 static long long page_fault_cnt;
 
+/* Page faults of all processes, by kind. */
+static struct fault_stats fault_stats;
+
+/* Page fault statistics of exited processes.  Only the first
+   MAX_RECORDS processes are recorded. */
+struct fault_record
+  {
+    char name[16];              /* Process name. */
+    tid_t tid;                  /* Process's thread identifier. */
+    struct fault_stats stats;   /* Page faults, by kind. */
+  };
+#define MAX_RECORDS 32
+static struct fault_record records[MAX_RECORDS];
+static size_t record_cnt;       /* Number of processes that exited. */
+
+/* Names of the kinds of page fault. */
+static const char *fault_names[FAULT_TYPE_CNT] =
+  {"file", "mmap", "swap", "zero", "stack", "shared", "resident",
+   "compressed", "fixup", "invalid"};
+
 static void kill (struct intr_frame *);
+static void debug_exception (struct intr_frame *);
 static void page_fault (struct intr_frame *);
 
 /* Registers handlers for interrupts that can be caused by user
@@ -43,7 +74,7 @@ exception_init (void)
      caused indirectly, e.g. #DE can be caused by dividing by
      0.  */
   intr_register_int (0, 0, INTR_ON, kill, "#DE Divide Error");
-  intr_register_int (1, 0, INTR_ON, kill, "#DB Debug Exception");
+  intr_register_int (1, 0, INTR_ON, debug_exception, "#DB Debug Exception");
   intr_register_int (6, 0, INTR_ON, kill, "#UD Invalid Opcode Exception");
   intr_register_int (7, 0, INTR_ON, kill,
                      "#NM Device Not Available Exception");
@@ -60,11 +91,99 @@ exception_init (void)
   intr_register_int (14, 0, INTR_OFF, page_fault, "#PF Page-Fault Exception");
 }
 
-/* Prints exception statistics. */
+/* Returns true if a fault of the given TYPE had to read from a
+   device. */
+static bool
+is_major (enum fault_type type)
+{
+  return type == FAULT_FILE || type == FAULT_MMAP || type == FAULT_SWAP;
+}
+
+/* Adds a fault of the given TYPE that took CYCLES to handle to
+   S. */
+static void
+count_fault (struct fault_stats *s, enum fault_type type, uint64_t cycles)
+{
+  s->cnt[type]++;
+  s->cycles[type] += cycles;
+}
+
+/* Stores the number of major, minor, and invalid faults in S into
+   *MAJOR, *MINOR, and *INVALID, and returns the total cycles spent
+   handling all of the faults in S.  Fixed-up faults are in none
+   of the three counts. */
+static uint64_t
+sum_faults (const struct fault_stats *s, unsigned long long *major,
+            unsigned long long *minor, unsigned long long *invalid)
+{
+  uint64_t cycles = 0;
+  int type;
+
+  *major = *minor = 0;
+  for (type = 0; type < FAULT_TYPE_CNT; type++)
+    {
+      if (is_major (type))
+        *major += s->cnt[type];
+      else if (type != FAULT_INVALID && type != FAULT_FIXUP)
+        *minor += s->cnt[type];
+      cycles += s->cycles[type];
+    }
+  *invalid = s->cnt[FAULT_INVALID];
+  return cycles;
+}
+
+/* Records the page fault statistics of the running process, which
+   is exiting, for exception_print_stats(). */
+void
+fault_exit (void)
+{
+  struct thread *t = thread_current ();
+  enum intr_level old_level;
+
+  old_level = intr_disable ();
+  if (record_cnt < MAX_RECORDS)
+    {
+      struct fault_record *r = &records[record_cnt];
+      strlcpy (r->name, t->name, sizeof r->name);
+      r->tid = t->tid;
+      r->stats = t->fault_stats;
+    }
+  record_cnt++;
+  intr_set_level (old_level);
+}
+
+/* Prints exception statistics: page faults by kind, with the
+   average cycles spent handling each kind, and then the faults of
+   each process that has exited. */
 void
 exception_print_stats (void) 
 {
+  unsigned long long major, minor, invalid;
+  uint64_t cycles;
+  size_t i;
+  int type;
+
   printf ("Exception: %lld page faults\n", page_fault_cnt);
+  cycles = sum_faults (&fault_stats, &major, &minor, &invalid);
+  printf ("Exception: %llu major, %llu minor, %llu invalid page faults, "
+          "%llu cycles\n", major, minor, invalid, cycles);
+  for (type = 0; type < FAULT_TYPE_CNT; type++)
+    if (fault_stats.cnt[type] > 0)
+      printf ("Exception: %llu %s faults, %llu cycles each\n",
+              fault_stats.cnt[type], fault_names[type],
+              fault_stats.cycles[type] / fault_stats.cnt[type]);
+
+  for (i = 0; i < record_cnt && i < MAX_RECORDS; i++)
+    {
+      cycles = sum_faults (&records[i].stats, &major, &minor, &invalid);
+      printf ("Exception: %s (tid %d): %llu major, %llu minor, "
+              "%llu invalid page faults, %llu cycles\n",
+              records[i].name, records[i].tid, major, minor, invalid,
+              cycles);
+    }
+  if (record_cnt > MAX_RECORDS)
+    printf ("Exception: %zu more processes not shown\n",
+            record_cnt - MAX_RECORDS);
 }
 
 /* Handler for an exception (probably) caused by a user process. */
@@ -108,6 +227,23 @@ kill (struct intr_frame *f)
     }
 }
 
+/* Debug exception handler.
+
+   SYSENTER does not clear the trap flag, so a user program that
+   single-steps into it traps on the first instruction of
+   sysenter_entry, in the kernel.  Clear the flag there and carry
+   on with the system call; anything else kills the process. */
+static void
+debug_exception (struct intr_frame *f) 
+{
+  if (f->cs == SEL_KCSEG && f->eip == sysenter_entry)
+    {
+      f->eflags &= ~FLAG_TF;
+      return;
+    }
+  kill (f);
+}
+
 /* Page fault handler.  This is a skeleton that must be filled in
    to implement virtual memory.  Some solutions to project 2 may
    also require modifying this code.
@@ -126,6 +262,9 @@ page_fault (struct intr_frame *f)
   bool write;        /* True: access was write, false: access was read. */
   bool user;         /* True: access by user, false: access by kernel. */
   void *fault_addr;  /* Fault address. */
+  enum fault_type type = FAULT_INVALID;
+  uint64_t start, cycles;
+  enum intr_level old_level;
 
   /* Obtain faulting address, the virtual address that was
      accessed to cause the fault.  It may point to code or to
@@ -138,6 +277,7 @@ page_fault (struct intr_frame *f)
 
   /* Turn interrupts back on (they were only off so that we could
      be assured of reading CR2 before it changed). */
+  start = cpu_cycles ();
   intr_enable ();
 
   /* Count page faults. */
@@ -148,9 +288,44 @@ page_fault (struct intr_frame *f)
   write = (f->error_code & PF_W) != 0;
   user = (f->error_code & PF_U) != 0;
 
-  /* To implement virtual memory, delete the rest of the function
-     body, and replace it with code that brings in the page to
-     which fault_addr refers. */
+#ifdef VM
+  /* Bring in the page to which fault_addr refers, if it is part of
+     the process's address space but has not been loaded yet, or
+     extend the stack if fault_addr is just below it.  A fault in
+     the kernel on user memory happens only within a system call,
+     so the user stack pointer is the one saved on entry to it. */
+  if (not_present)
+    {
+      void *esp = user ? f->esp : thread_current ()->user_esp;
+      type = page_resolve_fault (fault_addr, esp);
+    }
+#endif
+
+  /* The kernel faults on user memory that the process has not
+     mapped only while copying to or from it, and the copy then
+     fails instead. */
+  if (type == FAULT_INVALID && !user && is_user_vaddr (fault_addr)
+      && usercopy_fixup (f))
+    type = FAULT_FIXUP;
+
+  /* Account for the fault, including the time spent handling it,
+     to the process and to the system. */
+  cycles = cpu_cycles () - start;
+  old_level = intr_disable ();
+  count_fault (&thread_current ()->leader->fault_stats, type, cycles);
+  count_fault (&fault_stats, type, cycles);
+  intr_set_level (old_level);
+  if (type != FAULT_INVALID)
+    {
+#ifdef VM
+      /* Wait here if load control has suspended the process.  A
+         fault in user mode holds no locks. */
+      if (user)
+        ws_check_suspend ();
+#endif
+      return;
+    }
+
   printf ("Page fault at %p: %s error %s page in %s context.\n",
           fault_addr,
           not_present ? "not present" : "rights violation",
@@ -6,6 +6,8 @@
 #define PF_W 0x2    /* 0: read, 1: write. */
 #define PF_U 0x4    /* 0: kernel, 1: user process. */
 
+#include "userprog/fault.h"
+
 void exception_init (void);
 void exception_print_stats (void);
 
@@ -0,0 +1,39 @@
+#ifndef USERPROG_FAULT_H
+#define USERPROG_FAULT_H
+
+#include <stdint.h>
+
+/* Page fault accounting, shared by the page fault handler, the
+   virtual memory code, and each thread. */
+
+/* Kinds of page fault, for statistics.  The first three are
+   "major" faults, which read from a device; the rest of the
+   resolved faults are "minor".  Neither a fixed-up fault nor an
+   invalid one is resolved. */
+enum fault_type
+  {
+    FAULT_FILE,                 /* Read in a page of an executable. */
+    FAULT_MMAP,                 /* Read in a page of a mapped file. */
+    FAULT_SWAP,                 /* Read in a page from swap. */
+    FAULT_ZERO,                 /* Zero-filled a new page. */
+    FAULT_STACK,                /* Grew the stack. */
+    FAULT_SHARED,               /* Mapped a shared frame in memory. */
+    FAULT_RESIDENT,             /* Remapped a page still in memory. */
+    FAULT_COMPRESSED,           /* Decompressed a page from RAM. */
+    FAULT_FIXUP,                /* Bad access in a user copy; copy failed. */
+    FAULT_INVALID,              /* Bad access; process killed. */
+    FAULT_TYPE_CNT              /* Number of kinds. */
+  };
+
+/* Page fault counts and cycles spent handling them, by kind. */
+struct fault_stats
+  {
+    unsigned long long cnt[FAULT_TYPE_CNT];
+    uint64_t cycles[FAULT_TYPE_CNT];
+  };
+
+/* Records the page faults of the running process, which is
+   exiting.  Defined in userprog/exception.c. */
+void fault_exit (void);
+
+#endif /* userprog/fault.h */
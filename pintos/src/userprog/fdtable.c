@@ -0,0 +1,471 @@
+#include "userprog/fdtable.h"
+#include <bitmap.h>
+#include <debug.h>
+#include <string.h>
+#include "userprog/pipe.h"
+#include "filesys/file.h"
+#include "filesys/filesys.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+
+/* Per-process file descriptor table.
+
+   The table is an array of pointers indexed directly by file
+   descriptor, so that looking up or closing a descriptor takes
+   constant time no matter how many are open.  A bitmap records
+   which descriptors are in use, and a hint records the lowest
+   descriptor that might be free, so that opening a file hands out
+   the lowest available descriptor, as POSIX requires, without
+   searching from the start of the table each time.  When the
+   table fills up, both the array and the bitmap double in size,
+   up to FD_MAX descriptors.
+
+   A new table has the keyboard open as descriptor 0 and the
+   console display as descriptor 1.
+
+   Several descriptors may refer to the same open object, sharing
+   its file position, after fdtable_dup() or fdtable_dup2(), or in
+   a child process, which starts out with a copy of its parent's
+   table (see fdtable_clone()).  The open object is reference
+   counted and closed when the last descriptor that refers to it
+   is closed.
+
+   All the threads of a process share its table, so each table has
+   a lock.  A system call that uses an open object takes a
+   reference to it with fdtable_get(), so that another thread that
+   closes the descriptor in the meantime does not pull the object
+   out from under it.
+
+   The table is allocated separately from the thread that owns it,
+   to keep it out of the thread's page, which also holds its
+   kernel stack. */
+
+/* Number of descriptors in a new table. */
+#define FD_INITIAL_CNT 16
+
+/* Most descriptors in a table. */
+#define FD_MAX 4096
+
+/* A file descriptor table. */
+struct fd_table
+  {
+    struct open_file **files;   /* Indexed by descriptor. */
+    struct bitmap *used;        /* Descriptors in use. */
+    size_t size;                /* Number of elements in FILES. */
+    size_t free_hint;           /* No descriptor below this is free. */
+    struct lock lock;           /* Protects the members above. */
+  };
+
+/* Protects the reference counts of all open objects, which may
+   be shared among processes. */
+static struct lock ref_lock;
+
+/* Initializes the file descriptor table module. */
+void
+fdtable_init (void)
+{
+  lock_init (&ref_lock);
+}
+
+/* Returns a new open object of the given KIND, with no
+   references, or a null pointer if memory is not available. */
+static struct open_file *
+open_file_create (enum fd_kind kind)
+{
+  struct open_file *of = malloc (sizeof *of);
+  if (of != NULL)
+    {
+      of->kind = kind;
+      of->file = NULL;
+      of->pipe = NULL;
+      of->nonblocking = false;
+      of->ref_cnt = 0;
+    }
+  return of;
+}
+
+/* Adds a reference to OF. */
+static void
+get_open_file (struct open_file *of)
+{
+  lock_acquire (&ref_lock);
+  of->ref_cnt++;
+  lock_release (&ref_lock);
+}
+
+/* Drops a reference to OF, closing it if it was the last one. */
+static void
+put_open_file (struct open_file *of)
+{
+  unsigned ref_cnt;
+
+  lock_acquire (&ref_lock);
+  ASSERT (of->ref_cnt > 0);
+  ref_cnt = --of->ref_cnt;
+  lock_release (&ref_lock);
+  if (ref_cnt > 0)
+    return;
+
+  switch (of->kind)
+    {
+    case FD_CONSOLE_IN:
+    case FD_CONSOLE_OUT:
+      break;
+
+    case FD_FILE:
+      lock_acquire (&filesys_lock);
+      file_close (of->file);
+      lock_release (&filesys_lock);
+      break;
+
+    case FD_PIPE_READER:
+    case FD_PIPE_WRITER:
+      pipe_close (of->pipe, of->kind == FD_PIPE_WRITER);
+      break;
+    }
+  free (of);
+}
+
+/* Returns a new table with SIZE descriptors, none of them in use,
+   or a null pointer if memory is not available. */
+static struct fd_table *
+create (size_t size)
+{
+  struct fd_table *t = malloc (sizeof *t);
+  if (t == NULL)
+    return NULL;
+  t->files = calloc (size, sizeof *t->files);
+  t->used = bitmap_create (size);
+  if (t->files == NULL || t->used == NULL)
+    {
+      free (t->files);
+      if (t->used != NULL)
+        bitmap_destroy (t->used);
+      free (t);
+      return NULL;
+    }
+  t->size = size;
+  t->free_hint = 0;
+  lock_init (&t->lock);
+  return t;
+}
+
+/* Returns the open object bound to HANDLE in T, which must be
+   locked, or a null pointer if HANDLE is not open. */
+static struct open_file *
+lookup (const struct fd_table *t, int handle)
+{
+  if (handle < 0 || (size_t) handle >= t->size)
+    return NULL;
+  return t->files[handle];
+}
+
+/* Binds descriptor HANDLE, which must be free, in T to OF, adding
+   a reference to OF. */
+static void
+bind (struct fd_table *t, size_t handle, struct open_file *of)
+{
+  ASSERT (t->files[handle] == NULL);
+
+  bitmap_mark (t->used, handle);
+  t->files[handle] = of;
+  get_open_file (of);
+  if (handle == t->free_hint)
+    t->free_hint++;
+}
+
+/* Unbinds descriptor HANDLE, which must be open, in T, and
+   returns the object it was bound to, whose reference passes to
+   the caller. */
+static struct open_file *
+unbind (struct fd_table *t, size_t handle)
+{
+  struct open_file *of = t->files[handle];
+
+  ASSERT (of != NULL);
+  t->files[handle] = NULL;
+  bitmap_reset (t->used, handle);
+  if (handle < t->free_hint)
+    t->free_hint = handle;
+  return of;
+}
+
+/* Returns a new file descriptor table with the console open as
+   descriptors 0 and 1, or a null pointer if memory is not
+   available. */
+struct fd_table *
+fdtable_create (void)
+{
+  struct fd_table *t = create (FD_INITIAL_CNT);
+  struct open_file *in, *out;
+
+  if (t == NULL)
+    return NULL;
+  in = open_file_create (FD_CONSOLE_IN);
+  out = open_file_create (FD_CONSOLE_OUT);
+  if (in == NULL || out == NULL)
+    {
+      free (in);
+      free (out);
+      fdtable_destroy (t);
+      return NULL;
+    }
+  bind (t, 0, in);
+  bind (t, 1, out);
+  return t;
+}
+
+/* Returns a copy of T whose descriptors refer to the same open
+   objects as T's, or a new table as from fdtable_create() if T
+   is a null pointer.  Returns a null pointer if memory is not
+   available. */
+struct fd_table *
+fdtable_clone (struct fd_table *t)
+{
+  struct fd_table *clone;
+  size_t i;
+
+  if (t == NULL)
+    return fdtable_create ();
+
+  lock_acquire (&t->lock);
+  clone = create (t->size);
+  if (clone != NULL)
+    {
+      for (i = 0; i < t->size; i++)
+        if (t->files[i] != NULL)
+          bind (clone, i, t->files[i]);
+      clone->free_hint = t->free_hint;
+    }
+  lock_release (&t->lock);
+  return clone;
+}
+
+/* Closes every descriptor in T and frees T.  T may be a null
+   pointer.  No other thread may be using T. */
+void
+fdtable_destroy (struct fd_table *t)
+{
+  size_t i;
+
+  if (t == NULL)
+    return;
+  for (i = 0; i < t->size; i++)
+    if (t->files[i] != NULL)
+      put_open_file (t->files[i]);
+  bitmap_destroy (t->used);
+  free (t->files);
+  free (t);
+}
+
+/* Doubles the size of T, which must be locked.  Returns true if
+   successful, false if T is already as large as allowed or memory
+   is not available. */
+static bool
+grow (struct fd_table *t)
+{
+  size_t new_size = t->size * 2;
+  struct open_file **files;
+  struct bitmap *used;
+  size_t i;
+
+  if (new_size > FD_MAX)
+    return false;
+
+  files = realloc (t->files, new_size * sizeof *files);
+  if (files == NULL)
+    return false;
+  memset (files + t->size, 0, (new_size - t->size) * sizeof *files);
+  t->files = files;
+
+  used = bitmap_create (new_size);
+  if (used == NULL)
+    return false;
+  for (i = 0; i < t->size; i++)
+    bitmap_set (used, i, bitmap_test (t->used, i));
+  bitmap_destroy (t->used);
+  t->used = used;
+  t->size = new_size;
+  return true;
+}
+
+/* Binds the lowest free descriptor in T, which must be locked, to
+   OF, adding a reference to OF.  Returns the descriptor, or -1 if
+   T is full or memory is not available. */
+static int
+install (struct fd_table *t, struct open_file *of)
+{
+  size_t handle = bitmap_scan (t->used, t->free_hint, 1, false);
+  if (handle == BITMAP_ERROR)
+    {
+      handle = t->size;
+      if (!grow (t))
+        return -1;
+    }
+  t->free_hint = handle;
+  bind (t, handle, of);
+  return handle;
+}
+
+/* Binds the lowest free descriptor in T to OF, which has no
+   references yet.  Returns the descriptor, or -1 on failure, in
+   which case OF is freed. */
+static int
+install_new (struct fd_table *t, struct open_file *of)
+{
+  int handle;
+
+  lock_acquire (&t->lock);
+  handle = install (t, of);
+  lock_release (&t->lock);
+  if (handle < 0)
+    free (of);
+  return handle;
+}
+
+/* Binds the lowest free descriptor in T to FILE, which the table
+   then owns.  Returns the descriptor, or -1 on failure, in which
+   case the caller still owns FILE. */
+int
+fdtable_install (struct fd_table *t, struct file *file)
+{
+  struct open_file *of = open_file_create (FD_FILE);
+  if (of == NULL)
+    return -1;
+  of->file = file;
+  return install_new (t, of);
+}
+
+/* Binds the lowest free descriptor in T to the read end of PIPE,
+   or to its write end if WRITER is true.  If NONBLOCKING is true,
+   I/O through the descriptor fails instead of blocking.  The
+   table then owns that end of PIPE.  Returns the descriptor, or
+   -1 on failure, in which case the caller still owns it. */
+int
+fdtable_install_pipe (struct fd_table *t, struct pipe *pipe, bool writer,
+                      bool nonblocking)
+{
+  struct open_file *of
+    = open_file_create (writer ? FD_PIPE_WRITER : FD_PIPE_READER);
+  if (of == NULL)
+    return -1;
+  of->pipe = pipe;
+  of->nonblocking = nonblocking;
+  return install_new (t, of);
+}
+
+/* Returns the open object bound to HANDLE in T, with a new
+   reference that the caller must release with fdtable_put(), or a
+   null pointer if HANDLE is not open.  T may be a null pointer. */
+struct open_file *
+fdtable_get (struct fd_table *t, int handle)
+{
+  struct open_file *of;
+
+  if (t == NULL)
+    return NULL;
+  lock_acquire (&t->lock);
+  of = lookup (t, handle);
+  if (of != NULL)
+    get_open_file (of);
+  lock_release (&t->lock);
+  return of;
+}
+
+/* Releases a reference to OF obtained from fdtable_get(). */
+void
+fdtable_put (struct open_file *of)
+{
+  put_open_file (of);
+}
+
+/* Binds the lowest free descriptor in T to the same open object
+   as HANDLE.  Returns the new descriptor, or -1 if HANDLE is not
+   open or on failure. */
+int
+fdtable_dup (struct fd_table *t, int handle)
+{
+  struct open_file *of;
+  int new_handle = -1;
+
+  lock_acquire (&t->lock);
+  of = lookup (t, handle);
+  if (of != NULL)
+    new_handle = install (t, of);
+  lock_release (&t->lock);
+  return new_handle;
+}
+
+/* Binds NEW_HANDLE in T to the same open object as OLD_HANDLE,
+   first closing NEW_HANDLE if it is open.  Returns NEW_HANDLE, or
+   -1 if OLD_HANDLE is not open, if NEW_HANDLE is out of range, or
+   if memory is not available. */
+int
+fdtable_dup2 (struct fd_table *t, int old_handle, int new_handle)
+{
+  struct open_file *of, *closed = NULL;
+  int result = -1;
+
+  lock_acquire (&t->lock);
+  of = lookup (t, old_handle);
+  if (of == NULL || new_handle < 0 || new_handle >= FD_MAX)
+    goto done;
+  if (old_handle == new_handle)
+    {
+      result = new_handle;
+      goto done;
+    }
+  while ((size_t) new_handle >= t->size)
+    if (!grow (t))
+      goto done;
+
+  if (t->files[new_handle] != NULL)
+    closed = unbind (t, new_handle);
+  bind (t, new_handle, of);
+  result = new_handle;
+
+ done:
+  lock_release (&t->lock);
+  if (closed != NULL)
+    put_open_file (closed);
+  return result;
+}
+
+/* Wakes every thread blocked on a pipe that T has a descriptor
+   for, so that threads of a process that is ending notice.  T may
+   be a null pointer. */
+void
+fdtable_wake_pipes (struct fd_table *t)
+{
+  size_t i;
+
+  if (t == NULL)
+    return;
+  lock_acquire (&t->lock);
+  for (i = 0; i < t->size; i++)
+    {
+      struct open_file *of = t->files[i];
+      if (of != NULL
+          && (of->kind == FD_PIPE_READER || of->kind == FD_PIPE_WRITER))
+        pipe_wake (of->pipe);
+    }
+  lock_release (&t->lock);
+}
+
+/* Closes HANDLE in T.  Returns true if successful, false if
+   HANDLE was not open. */
+bool
+fdtable_close (struct fd_table *t, int handle)
+{
+  struct open_file *of;
+
+  lock_acquire (&t->lock);
+  of = lookup (t, handle);
+  if (of != NULL)
+    unbind (t, handle);
+  lock_release (&t->lock);
+  if (of == NULL)
+    return false;
+  put_open_file (of);
+  return true;
+}
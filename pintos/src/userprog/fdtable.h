@@ -0,0 +1,44 @@
+#ifndef USERPROG_FDTABLE_H
+#define USERPROG_FDTABLE_H
+
+#include <stdbool.h>
+
+struct file;
+struct pipe;
+
+/* Kinds of object that a file descriptor can refer to. */
+enum fd_kind
+  {
+    FD_CONSOLE_IN,              /* Keyboard. */
+    FD_CONSOLE_OUT,             /* Display and serial port. */
+    FD_FILE,                    /* File. */
+    FD_PIPE_READER,             /* Read end of a pipe. */
+    FD_PIPE_WRITER              /* Write end of a pipe. */
+  };
+
+/* An open object, shared by all the descriptors that refer to it,
+   in one process or several. */
+struct open_file
+  {
+    enum fd_kind kind;          /* Kind of object. */
+    struct file *file;          /* For FD_FILE. */
+    struct pipe *pipe;          /* For FD_PIPE_*. */
+    bool nonblocking;           /* Pipe I/O fails instead of blocking? */
+    unsigned ref_cnt;           /* Descriptors that refer to it. */
+  };
+
+void fdtable_init (void);
+struct fd_table *fdtable_create (void);
+struct fd_table *fdtable_clone (struct fd_table *);
+void fdtable_destroy (struct fd_table *);
+int fdtable_install (struct fd_table *, struct file *);
+int fdtable_install_pipe (struct fd_table *, struct pipe *, bool writer,
+                          bool nonblocking);
+int fdtable_dup (struct fd_table *, int handle);
+int fdtable_dup2 (struct fd_table *, int old_handle, int new_handle);
+struct open_file *fdtable_get (struct fd_table *, int handle);
+void fdtable_put (struct open_file *);
+bool fdtable_close (struct fd_table *, int handle);
+void fdtable_wake_pipes (struct fd_table *);
+
+#endif /* userprog/fdtable.h */
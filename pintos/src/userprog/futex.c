@@ -0,0 +1,262 @@
+#include "userprog/futex.h"
+#include <debug.h>
+#include <hash.h>
+#include <list.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "userprog/process.h"
+#include "userprog/usercopy.h"
+#include "threads/interrupt.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#ifdef VM
+#include "vm/page.h"
+#endif
+
+/* Futexes.
+
+   A futex is an int in user memory on which threads may wait.
+   futex_wait() blocks the caller only if the int still holds the
+   value that the caller expects, which it checks under the lock
+   of the bucket that holds the futex's waiters, and futex_wake()
+   takes the same lock.  Thus a thread that sees the value change
+   and then calls futex_wake() cannot slip in between another
+   thread's check and its going to sleep, and user code can keep
+   the uncontended path of its locks entirely in user space (see
+   lib/user/synch.c).
+
+   Waiters are keyed not by the futex's user virtual address but
+   by what backs it, so that processes that map the same memory
+   at different addresses wait on the same futex.  The key of a
+   futex in a shared page, such as a page of a shared memory
+   segment (see vm/shm.c), is the object that holds the page's
+   data and the futex's offset in it, as for the shared frame
+   table (see vm/frame.h).  The key of any other futex is its
+   address space, identified by the page directory that all of
+   the process's threads share, and its virtual address.  A
+   frame's physical address would not do, because a page may be
+   evicted and later brought back into a different frame.
+
+   Wakeups go to the highest-priority waiters first.  When a
+   process ends, futex_wake_process() wakes all of its waiters,
+   so that they can die. */
+
+/* Number of hash buckets. */
+#define FUTEX_BUCKETS 64
+
+/* Identifies a futex. */
+struct futex_key
+  {
+    const void *object;         /* Shared object or page directory. */
+    uintptr_t offset;           /* Offset in file, or address. */
+  };
+
+/* A thread waiting on a futex. */
+struct futex_waiter
+  {
+    struct list_elem elem;      /* Element in bucket's `waiters'. */
+    struct futex_key key;       /* Futex waited on. */
+    struct thread *thread;      /* Waiting thread. */
+    struct semaphore woken;     /* Upped by futex_wake(). */
+  };
+
+/* A hash bucket. */
+struct futex_bucket
+  {
+    struct lock lock;           /* Protects `waiters'. */
+    struct list waiters;        /* Waiters on futexes in this bucket. */
+  };
+
+static struct futex_bucket buckets[FUTEX_BUCKETS];
+
+/* Statistics.  Protected by disabling interrupts. */
+static unsigned long long wait_cnt;     /* Calls that blocked. */
+static unsigned long long wake_cnt;     /* Threads woken. */
+
+/* Initializes the futex module. */
+void
+futex_init (void)
+{
+  size_t i;
+
+  for (i = 0; i < FUTEX_BUCKETS; i++)
+    {
+      lock_init (&buckets[i].lock);
+      list_init (&buckets[i].waiters);
+    }
+}
+
+/* Stores in *KEY the key of the futex at UADDR in the running
+   process.  Returns false if UADDR is not a valid futex
+   address. */
+static bool
+get_key (const int *uaddr, struct futex_key *key)
+{
+  struct thread *cur = thread_current ();
+#ifdef VM
+  struct page *p;
+#endif
+
+  if ((uintptr_t) uaddr % sizeof *uaddr != 0 || !is_user_vaddr (uaddr))
+    return false;
+
+#ifdef VM
+  page_table_lock ();
+  p = page_lookup (uaddr);
+  if (p != NULL && p->shared)
+    {
+      key->object = page_shared_object (p);
+      key->offset = p->file_ofs + pg_ofs (uaddr);
+      page_table_unlock ();
+      return true;
+    }
+  page_table_unlock ();
+#endif
+  key->object = cur->pagedir;
+  key->offset = (uintptr_t) uaddr;
+  return true;
+}
+
+/* Returns true if A and B are the same key. */
+static bool
+same_key (const struct futex_key *a, const struct futex_key *b)
+{
+  return a->object == b->object && a->offset == b->offset;
+}
+
+/* Returns the bucket for KEY. */
+static struct futex_bucket *
+get_bucket (const struct futex_key *key)
+{
+  return &buckets[hash_bytes (key, sizeof *key) % FUTEX_BUCKETS];
+}
+
+/* Kills the running process, which passed a bad futex address. */
+static void NO_RETURN
+kill_process (void)
+{
+  thread_current ()->exit_code = -1;
+  thread_exit ();
+}
+
+/* Blocks until woken by futex_wake(), if the int at UADDR equals
+   EXPECTED.  Returns 0 if the thread blocked and was woken, or -1
+   at once if the int did not equal EXPECTED or if the process is
+   ending.  Kills the process if UADDR is not a valid futex
+   address. */
+int
+futex_wait (int *uaddr, int expected)
+{
+  struct futex_waiter w;
+  struct futex_bucket *b;
+  enum intr_level old_level;
+  int value;
+
+  if (!get_key (uaddr, &w.key))
+    kill_process ();
+  b = get_bucket (&w.key);
+
+  lock_acquire (&b->lock);
+  if (copy_from_user (&value, uaddr, sizeof value) != 0)
+    {
+      lock_release (&b->lock);
+      kill_process ();
+    }
+  if (value != expected || process_exiting ())
+    {
+      lock_release (&b->lock);
+      return -1;
+    }
+  w.thread = thread_current ();
+  sema_init (&w.woken, 0);
+  list_push_back (&b->waiters, &w.elem);
+  lock_release (&b->lock);
+
+  old_level = intr_disable ();
+  wait_cnt++;
+  intr_set_level (old_level);
+
+  sema_down (&w.woken);
+  return 0;
+}
+
+/* Wakes up to CNT threads waiting on the futex at UADDR, highest
+   priority first.  Returns the number woken.  Kills the process
+   if UADDR is not a valid futex address. */
+int
+futex_wake (int *uaddr, unsigned cnt)
+{
+  struct futex_key key;
+  struct futex_bucket *b;
+  enum intr_level old_level;
+  unsigned woken = 0;
+
+  if (!get_key (uaddr, &key))
+    kill_process ();
+  b = get_bucket (&key);
+
+  lock_acquire (&b->lock);
+  while (woken < cnt)
+    {
+      struct futex_waiter *best = NULL;
+      struct list_elem *e;
+
+      for (e = list_begin (&b->waiters); e != list_end (&b->waiters);
+           e = list_next (e))
+        {
+          struct futex_waiter *w = list_entry (e, struct futex_waiter, elem);
+          if (same_key (&w->key, &key)
+              && (best == NULL
+                  || w->thread->priority > best->thread->priority))
+            best = w;
+        }
+      if (best == NULL)
+        break;
+
+      list_remove (&best->elem);
+      sema_up (&best->woken);
+      woken++;
+    }
+  lock_release (&b->lock);
+
+  old_level = intr_disable ();
+  wake_cnt += woken;
+  intr_set_level (old_level);
+  return woken;
+}
+
+/* Wakes every thread in the process led by LEADER that is waiting
+   on a futex. */
+void
+futex_wake_process (struct thread *leader)
+{
+  size_t i;
+
+  for (i = 0; i < FUTEX_BUCKETS; i++)
+    {
+      struct futex_bucket *b = &buckets[i];
+      struct list_elem *e, *next;
+
+      lock_acquire (&b->lock);
+      for (e = list_begin (&b->waiters); e != list_end (&b->waiters);
+           e = next)
+        {
+          struct futex_waiter *w = list_entry (e, struct futex_waiter, elem);
+          next = list_next (e);
+          if (w->thread->leader == leader)
+            {
+              list_remove (e);
+              sema_up (&w->woken);
+            }
+        }
+      lock_release (&b->lock);
+    }
+}
+
+/* Prints futex statistics. */
+void
+futex_print_stats (void)
+{
+  printf ("Futexes: %llu waits, %llu wakeups\n", wait_cnt, wake_cnt);
+}
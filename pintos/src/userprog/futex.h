@@ -0,0 +1,12 @@
+#ifndef USERPROG_FUTEX_H
+#define USERPROG_FUTEX_H
+
+struct thread;
+
+void futex_init (void);
+int futex_wait (int *uaddr, int expected);
+int futex_wake (int *uaddr, unsigned cnt);
+void futex_wake_process (struct thread *leader);
+void futex_print_stats (void);
+
+#endif /* userprog/futex.h */
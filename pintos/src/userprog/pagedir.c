@@ -7,12 +7,17 @@
 #include "threads/palloc.h"
 
 static uint32_t *active_pd (void);
-static void invalidate_pagedir (uint32_t *);
+static void invalidate_page (uint32_t *, const void *);
 
 /* Creates a new page directory that has mappings for kernel
    virtual addresses, but none for user virtual addresses.
    Returns the new page directory, or a null pointer if memory
-   allocation fails. */
+   allocation fails.
+
+   The kernel PDEs are copied from init_page_dir.  Most of them
+   are 4 MB large pages (see paging_init()), so the copies share
+   no page tables at all; the rest share init_page_dir's page
+   tables, which are never freed. */
 uint32_t *
 pagedir_create (void) 
 {
@@ -33,6 +38,13 @@ pagedir_destroy (uint32_t *pd)
     return;
 
   ASSERT (pd != init_page_dir);
+
+  /* Kernel threads keep running on whatever page directory was
+     active before them (see process_activate()), so PD may still
+     be loaded even though its process is gone.  Never free the
+     active page directory. */
+  pagedir_deactivate (pd);
+
   for (pde = pd; pde < pd + pd_no (PHYS_BASE); pde++)
     if (*pde & PTE_P) 
       {
@@ -64,8 +76,12 @@ lookup_page (uint32_t *pd, const void *vaddr, bool create)
   ASSERT (!create || is_user_vaddr (vaddr));
 
   /* Check for a page table for VADDR.
-     If one is missing, create one if requested. */
+     If one is missing, create one if requested.
+     Large-page PDEs only ever map the kernel's direct map, so
+     they have no page table to look in. */
   pde = pd + pd_no (vaddr);
+  if (pde_is_large (*pde))
+    return NULL;
   if (*pde == 0) 
     {
       if (create)
@@ -152,7 +168,7 @@ pagedir_clear_page (uint32_t *pd, void *upage)
   if (pte != NULL && (*pte & PTE_P) != 0)
     {
       *pte &= ~PTE_P;
-      invalidate_pagedir (pd);
+      invalidate_page (pd, upage);
     }
 }
 
@@ -180,7 +196,7 @@ pagedir_set_dirty (uint32_t *pd, const void *vpage, bool dirty)
       else 
         {
           *pte &= ~(uint32_t) PTE_D;
-          invalidate_pagedir (pd);
+          invalidate_page (pd, vpage);
         }
     }
 }
@@ -209,13 +225,16 @@ pagedir_set_accessed (uint32_t *pd, const void *vpage, bool accessed)
       else 
         {
           *pte &= ~(uint32_t) PTE_A; 
-          invalidate_pagedir (pd);
+          invalidate_page (pd, vpage);
         }
     }
 }
 
 /* Loads page directory PD into the CPU's page directory base
-   register. */
+   register, unless it is already loaded.  Reloading CR3 flushes
+   every non-global TLB entry, so switching to the page directory
+   that is already active would only throw away useful
+   translations. */
 void
 pagedir_activate (uint32_t *pd) 
 {
@@ -227,7 +246,17 @@ pagedir_activate (uint32_t *pd)
      new page tables immediately.  See [IA32-v2a] "MOV--Move
      to/from Control Registers" and [IA32-v3a] 3.7.5 "Base
      Address of the Page Directory". */
-  asm volatile ("movl %0, %%cr3" : : "r" (vtop (pd)) : "memory");
+  if (active_pd () != pd)
+    asm volatile ("movl %0, %%cr3" : : "r" (vtop (pd)) : "memory");
+}
+
+/* If PD is the active page directory, switches to the
+   kernel-only page directory instead. */
+void
+pagedir_deactivate (uint32_t *pd) 
+{
+  if (active_pd () == pd)
+    pagedir_activate (NULL);
 }
 
 /* Returns the currently active page directory. */
@@ -243,21 +272,20 @@ active_pd (void)
   return ptov (pd);
 }
 
-/* Seom page table changes can cause the CPU's translation
+/* Some page table changes can cause the CPU's translation
    lookaside buffer (TLB) to become out-of-sync with the page
-   table.  When this happens, we have to "invalidate" the TLB by
-   re-activating it.
+   table.  When this happens, we have to "invalidate" the stale
+   TLB entry.
 
-   This function invalidates the TLB if PD is the active page
-   directory.  (If PD is not active then its entries are not in
-   the TLB, so there is no need to invalidate anything.) */
+   This function invalidates the TLB entry for user virtual page
+   VADDR if PD is the active page directory.  (If PD is not
+   active then its entries are not in the TLB, so there is no
+   need to invalidate anything.)  Only the one entry is dropped,
+   with INVLPG, instead of flushing the whole TLB.  See [IA32-v2a]
+   "INVLPG--Invalidate TLB Entry". */
 static void
-invalidate_pagedir (uint32_t *pd) 
+invalidate_page (uint32_t *pd, const void *vaddr) 
 {
   if (active_pd () == pd) 
-    {
-      /* Re-activating PD clears the TLB.  See [IA32-v3a] 3.12
-         "Translation Lookaside Buffers (TLBs)". */
-      pagedir_activate (pd);
-    } 
+    asm volatile ("invlpg (%0)" : : "r" (vaddr) : "memory");
 }
@@ -0,0 +1,233 @@
+#include "userprog/pipe.h"
+#include <debug.h>
+#include <stdio.h>
+#include "userprog/process.h"
+#include "userprog/usercopy.h"
+#include "threads/interrupt.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+
+/* Pipes.
+
+   A pipe's data lives in a ring buffer of one page.  Readers and
+   writers copy directly between their own memory and the ring,
+   in at most two contiguous pieces per pass, so data crosses the
+   pipe with a single copy and no kernel bounce buffer.  The copy
+   may fault on user memory, which only blocks the process for a
+   while, so it is done with the pipe's lock held; no other lock
+   is ever acquired while holding it other than those taken by the
+   page fault handler, which never acquires a pipe's lock.
+
+   Each end of a pipe is held by a single open object in the file
+   descriptor tables (see userprog/fdtable.c), which may be shared
+   by any number of descriptors and processes, and which calls
+   pipe_close() when the last of them is closed.
+
+   When a process ends, pipe_wake() wakes every thread blocked on
+   each pipe that the process has a descriptor for (see
+   fdtable_wake_pipes()).  Each rechecks its condition and goes
+   back to sleep unless its own process is ending. */
+
+/* A pipe. */
+struct pipe
+  {
+    struct lock lock;           /* Protects all members. */
+    struct condition readable;  /* Signaled when data or EOF arrives. */
+    struct condition writable;  /* Signaled when room frees up. */
+    uint8_t *buf;               /* Ring buffer of PGSIZE bytes. */
+    size_t head;                /* Offset of first byte in BUF. */
+    size_t used;                /* Number of bytes in BUF. */
+    bool reader;                /* Read end open? */
+    bool writer;                /* Write end open? */
+  };
+
+/* Statistics.  Protected by disabling interrupts. */
+static unsigned long long create_cnt;   /* Pipes created. */
+static unsigned long long byte_cnt;     /* Bytes written to pipes. */
+static unsigned long long block_cnt;    /* Times a reader or writer
+                                           blocked. */
+
+/* Adds N to statistic *CNT. */
+static void
+count (unsigned long long *cnt, size_t n)
+{
+  enum intr_level old_level = intr_disable ();
+  *cnt += n;
+  intr_set_level (old_level);
+}
+
+/* Returns a new pipe with both ends open, or a null pointer if
+   memory is not available. */
+struct pipe *
+pipe_create (void)
+{
+  struct pipe *p = malloc (sizeof *p);
+  if (p == NULL)
+    return NULL;
+  p->buf = palloc_get_page (0);
+  if (p->buf == NULL)
+    {
+      free (p);
+      return NULL;
+    }
+  lock_init (&p->lock);
+  cond_init (&p->readable);
+  cond_init (&p->writable);
+  p->head = p->used = 0;
+  p->reader = p->writer = true;
+
+  count (&create_cnt, 1);
+  return p;
+}
+
+/* Closes P's write end if WRITER is true, otherwise its read end,
+   and frees P if both are now closed. */
+void
+pipe_close (struct pipe *p, bool writer)
+{
+  bool destroy;
+
+  lock_acquire (&p->lock);
+  if (writer)
+    {
+      ASSERT (p->writer);
+      p->writer = false;
+      cond_broadcast (&p->readable, &p->lock);
+    }
+  else
+    {
+      ASSERT (p->reader);
+      p->reader = false;
+      cond_broadcast (&p->writable, &p->lock);
+    }
+  destroy = !p->reader && !p->writer;
+  lock_release (&p->lock);
+
+  if (destroy)
+    {
+      palloc_free_page (p->buf);
+      free (p);
+    }
+}
+
+/* Releases P's lock and kills the running process, which passed
+   a bad pointer. */
+static void NO_RETURN
+fault (struct pipe *p)
+{
+  lock_release (&p->lock);
+  thread_current ()->exit_code = -1;
+  thread_exit ();
+}
+
+/* Reads up to SIZE bytes from P into user buffer UDST.  Blocks
+   until at least one byte is available or P's write end is
+   closed, in which case an empty P reads as end of file.
+   Returns the number of bytes read, or -1 if the read would have
+   to block and NONBLOCKING is true or the process is ending.
+   Kills the process if UDST is not valid. */
+int
+pipe_read (struct pipe *p, void *udst_, size_t size, bool nonblocking)
+{
+  uint8_t *udst = udst_;
+  size_t read = 0;
+
+  if (size == 0)
+    return 0;
+
+  lock_acquire (&p->lock);
+  while (p->used == 0 && p->writer)
+    {
+      if (nonblocking || process_exiting ())
+        {
+          lock_release (&p->lock);
+          return -1;
+        }
+      count (&block_cnt, 1);
+      cond_wait (&p->readable, &p->lock);
+    }
+
+  while (read < size && p->used > 0)
+    {
+      size_t chunk = PGSIZE - p->head;
+      if (chunk > p->used)
+        chunk = p->used;
+      if (chunk > size - read)
+        chunk = size - read;
+      if (copy_to_user (udst + read, p->buf + p->head, chunk) != 0)
+        fault (p);
+      p->head = (p->head + chunk) % PGSIZE;
+      p->used -= chunk;
+      read += chunk;
+    }
+  cond_broadcast (&p->writable, &p->lock);
+  lock_release (&p->lock);
+  return read;
+}
+
+/* Writes the SIZE bytes in user buffer USRC to P, blocking while P
+   is full.  Returns the number of bytes written, which is less
+   than SIZE only if P's read end is closed or if P filled up and
+   NONBLOCKING is true or the process is ending; returns -1 if no
+   bytes could be written for any of these reasons.  Kills the
+   process if USRC is not valid. */
+int
+pipe_write (struct pipe *p, const void *usrc_, size_t size,
+            bool nonblocking)
+{
+  const uint8_t *usrc = usrc_;
+  size_t written = 0;
+
+  if (size == 0)
+    return 0;
+
+  lock_acquire (&p->lock);
+  while (written < size && p->reader)
+    {
+      size_t tail, chunk;
+
+      if (p->used == PGSIZE)
+        {
+          if (nonblocking || process_exiting ())
+            break;
+          count (&block_cnt, 1);
+          cond_wait (&p->writable, &p->lock);
+          continue;
+        }
+
+      /* The free space runs from TAIL to HEAD, wrapping around. */
+      tail = (p->head + p->used) % PGSIZE;
+      chunk = tail < p->head ? p->head - tail : PGSIZE - tail;
+      if (chunk > size - written)
+        chunk = size - written;
+      if (copy_from_user (p->buf + tail, usrc + written, chunk) != 0)
+        fault (p);
+      p->used += chunk;
+      written += chunk;
+      count (&byte_cnt, chunk);
+      cond_broadcast (&p->readable, &p->lock);
+    }
+  lock_release (&p->lock);
+  return written > 0 ? (int) written : -1;
+}
+
+/* Wakes every thread blocked on P. */
+void
+pipe_wake (struct pipe *p)
+{
+  lock_acquire (&p->lock);
+  cond_broadcast (&p->readable, &p->lock);
+  cond_broadcast (&p->writable, &p->lock);
+  lock_release (&p->lock);
+}
+
+/* Prints pipe statistics. */
+void
+pipe_print_stats (void)
+{
+  printf ("Pipes: %llu created, %llu bytes transferred, %llu waits\n",
+          create_cnt, byte_cnt, block_cnt);
+}
@@ -0,0 +1,15 @@
+#ifndef USERPROG_PIPE_H
+#define USERPROG_PIPE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+struct pipe *pipe_create (void);
+void pipe_close (struct pipe *, bool writer);
+int pipe_read (struct pipe *, void *udst, size_t size, bool nonblocking);
+int pipe_write (struct pipe *, const void *usrc, size_t size,
+                bool nonblocking);
+void pipe_wake (struct pipe *);
+void pipe_print_stats (void);
+
+#endif /* userprog/pipe.h */
@@ -6,63 +6,218 @@
 #include <stdlib.h>
 #include <string.h>
 #include "userprog/gdt.h"
+#include "userprog/fault.h"
+#include "userprog/fdtable.h"
+#include "userprog/futex.h"
 #include "userprog/pagedir.h"
+#include "userprog/syscall.h"
 #include "userprog/tss.h"
+#include "userprog/usercopy.h"
 #include "filesys/directory.h"
 #include "filesys/file.h"
 #include "filesys/filesys.h"
 #include "threads/flags.h"
 #include "threads/init.h"
 #include "threads/interrupt.h"
+#include "threads/malloc.h"
 #include "threads/palloc.h"
+#include "threads/synch.h"
 #include "threads/thread.h"
 #include "threads/vaddr.h"
+#ifdef VM
+#include "vm/page.h"
+#include "vm/swap.h"
+#include "vm/ws.h"
+#endif
 
 static thread_func start_process NO_RETURN;
+static thread_func start_thread NO_RETURN;
+static thread_func reaper NO_RETURN;
+static void exit_thread (void);
 static bool load (const char *cmdline, void (**eip) (void), void **esp);
 
-/* Starts a new thread running a user program loaded from
-   FILENAME.  The new thread may be scheduled (and may even exit)
-   before process_execute() returns.  Returns the new process's
-   thread id, or TID_ERROR if the thread cannot be created. */
+/* Tracks the completion of a process.
+   Reference held by both the parent, in its `children' list,
+   and by the child, in its `wait_status' pointer. */
+struct wait_status
+  {
+    struct list_elem elem;      /* `children' list element. */
+    struct lock lock;           /* Protects ref_cnt. */
+    int ref_cnt;                /* 2=child and parent both alive,
+                                   1=either child or parent alive,
+                                   0=child and parent both dead. */
+    tid_t tid;                  /* Child thread id. */
+    int exit_code;              /* Child exit code, if dead. */
+    struct semaphore dead;      /* 1=child alive, 0=child dead. */
+    bool waited;                /* A thread in process_wait()?
+                                   Protected by the parent's
+                                   `process_lock'. */
+  };
+
+/* Tracks the completion of a thread other than a process's
+   leader.  Held in the leader's `threads' list until another
+   thread joins it or the process exits. */
+struct join_status
+  {
+    struct list_elem elem;      /* `threads' list element. */
+    tid_t tid;                  /* Thread id. */
+    uint8_t *stack;             /* Base of the thread's user stack. */
+    bool dead;                  /* Thread has ended?  Protected by
+                                   the leader's `process_lock'. */
+  };
+
+/* Data structure shared between process_thread_create() in the
+   creating thread and start_thread() in the new thread. */
+struct thread_info
+  {
+    struct thread *leader;      /* Process's leader. */
+    struct join_status *js;     /* New thread's completion status. */
+    void (*eip) (void);         /* Where to start in user code. */
+    void *esp;                  /* Initial user stack pointer. */
+    struct semaphore started;   /* "Up"ed once INFO is no longer
+                                   needed. */
+  };
+
+/* Pages in the user stack of a thread other than a process's
+   leader.  These stacks do not grow. */
+#define THREAD_STACK_PAGES 8
+
+/* Data structure shared between process_execute() in the
+   invoking thread and start_process() in the newly invoked
+   thread. */
+struct exec_info
+  {
+    const char *cmd_line;               /* Command line to execute. */
+    struct semaphore load_done;         /* "Up"ed when loading complete. */
+    struct wait_status *wait_status;    /* Child process. */
+    struct fd_table *fds;               /* Inherited file descriptors. */
+    bool success;                       /* Program successfully loaded? */
+  };
+
+/* Reaper.
+
+   Tearing down an address space takes time proportional to its
+   size: every page must leave its frame or swap slot and every
+   page table must be freed.  An exiting process does not do this
+   itself.  It publishes its exit status, waking its parent, and
+   only then dies, leaving its struct thread, which holds the
+   supplemental page table and page directory, to the "reaper"
+   kernel thread.  The reaper runs at the lowest priority, tears
+   the address space down, and finally frees the struct thread.
+
+   Until then the dead process's pages stay where they are.  When
+   frames run short, the frame allocator takes back the frames
+   that only dead processes map, without writing their pages out
+   (see vm/frame.c), and calls process_reap_urgently(), which
+   raises the reaper to the allocating thread's priority, so that
+   teardown does not wait behind every runnable thread.  The
+   reaper drops back to the lowest priority once it has caught
+   up. */
+static struct list reap_list;   /* Dead processes to tear down. */
+static struct thread *reaper_thread;    /* The reaper. */
+static bool reaper_idle;        /* Is the reaper blocked? */
+
+/* Statistics.  Protected, like reap_list, by disabling
+   interrupts. */
+static size_t reap_backlog;     /* Processes in reap_list. */
+static size_t reap_max_backlog; /* Largest backlog seen. */
+static unsigned long long reap_cnt;     /* Processes torn down. */
+
+/* Starts the reaper. */
+void
+process_init (void)
+{
+  list_init (&reap_list);
+  if (thread_create ("reaper", PRI_MIN, reaper, NULL) == TID_ERROR)
+    PANIC ("couldn't start reaper");
+}
+
+/* Starts a new thread running a user program loaded from the
+   first word of CMD_LINE, passing it the words of CMD_LINE as its
+   arguments.  The new process starts out with a copy of the
+   running process's file descriptors.  The new thread may be
+   scheduled (and may even exit) before process_execute()
+   returns.  Returns the new process's thread id, or TID_ERROR if
+   the thread cannot be created or the program cannot be
+   loaded. */
 tid_t
-process_execute (const char *file_name) 
+process_execute (const char *cmd_line) 
 {
-  char *fn_copy;
+  struct exec_info exec;
+  char thread_name[16];
   tid_t tid;
 
-  /* Make a copy of FILE_NAME.
-     Otherwise there's a race between the caller and load(). */
-  fn_copy = palloc_get_page (0);
-  if (fn_copy == NULL)
+  /* Initialize exec_info. */
+  exec.cmd_line = cmd_line;
+  sema_init (&exec.load_done, 0);
+  exec.fds = fdtable_clone (thread_current ()->fds);
+  if (exec.fds == NULL)
     return TID_ERROR;
-  strlcpy (fn_copy, file_name, PGSIZE);
 
-  /* Create a new thread to execute FILE_NAME. */
-  tid = thread_create (file_name, PRI_DEFAULT, start_process, fn_copy);
-  if (tid == TID_ERROR)
-    palloc_free_page (fn_copy); 
+  /* Create a new thread, named after the program, to execute
+     CMD_LINE, and wait for it to load. */
+  strlcpy (thread_name, cmd_line, sizeof thread_name);
+  thread_name[strcspn (thread_name, " ")] = '\0';
+  tid = thread_create (thread_name, PRI_DEFAULT, start_process, &exec);
+  if (tid != TID_ERROR)
+    {
+      sema_down (&exec.load_done);
+      if (exec.success)
+        {
+          struct thread *leader = thread_current ()->leader;
+
+          lock_acquire (&leader->process_lock);
+          list_push_back (&leader->children, &exec.wait_status->elem);
+          lock_release (&leader->process_lock);
+        }
+      else
+        tid = TID_ERROR;
+    }
+  else
+    fdtable_destroy (exec.fds);
   return tid;
 }
 
 /* A thread function that loads a user process and starts it
    running. */
 static void
-start_process (void *file_name_)
+start_process (void *exec_)
 {
-  char *file_name = file_name_;
+  struct exec_info *exec = exec_;
+  struct thread *cur = thread_current ();
   struct intr_frame if_;
   bool success;
 
+  /* Take over the inherited file descriptors.  From here on,
+     syscall_exit() closes them if we fail. */
+  cur->fds = exec->fds;
+
   /* Initialize interrupt frame and load executable. */
   memset (&if_, 0, sizeof if_);
   if_.gs = if_.fs = if_.es = if_.ds = if_.ss = SEL_UDSEG;
   if_.cs = SEL_UCSEG;
   if_.eflags = FLAG_IF | FLAG_MBS;
-  success = load (file_name, &if_.eip, &if_.esp);
+  success = load (exec->cmd_line, &if_.eip, &if_.esp);
+
+  /* Allocate and initialize wait_status. */
+  if (success)
+    {
+      exec->wait_status = cur->wait_status
+        = malloc (sizeof *exec->wait_status);
+      success = exec->wait_status != NULL;
+    }
+  if (success)
+    {
+      lock_init (&exec->wait_status->lock);
+      exec->wait_status->ref_cnt = 2;
+      exec->wait_status->tid = cur->tid;
+      sema_init (&exec->wait_status->dead, 0);
+      exec->wait_status->waited = false;
+    }
 
-  /* If load failed, quit. */
-  palloc_free_page (file_name);
+  /* Notify parent thread and clean up. */
+  exec->success = success;
+  sema_up (&exec->load_done);
   if (!success) 
     thread_exit ();
 
@@ -76,44 +231,327 @@ start_process (void *file_name_)
   NOT_REACHED ();
 }
 
+/* Releases one reference to CS and, if it is now unreferenced,
+   frees it. */
+static void
+release_child (struct wait_status *cs) 
+{
+  int new_ref_cnt;
+  
+  lock_acquire (&cs->lock);
+  new_ref_cnt = --cs->ref_cnt;
+  lock_release (&cs->lock);
+
+  if (new_ref_cnt == 0)
+    free (cs);
+}
+
 /* Waits for thread TID to die and returns its exit status.  If
    it was terminated by the kernel (i.e. killed due to an
    exception), returns -1.  If TID is invalid or if it was not a
    child of the calling process, or if process_wait() has already
    been successfully called for the given TID, returns -1
-   immediately, without waiting.
+   immediately, without waiting.  Any thread in a process may wait
+   for any of the process's children.
 
-   This function will be implemented in problem 2-2.  For now, it
-   does nothing. */
+   The child stays in the `children' list while we wait, so that
+   end_process() can find it and wake us if our own process
+   starts to end.  In that case we return -1 without waiting any
+   longer. */
 int
-process_wait (tid_t child_tid UNUSED) 
+process_wait (tid_t child_tid) 
+{
+  struct thread *leader = thread_current ()->leader;
+  struct wait_status *cs = NULL;
+  struct list_elem *e;
+  int exit_code;
+
+  lock_acquire (&leader->process_lock);
+  if (!leader->exiting)
+    for (e = list_begin (&leader->children);
+         e != list_end (&leader->children); e = list_next (e))
+      {
+        struct wait_status *child = list_entry (e, struct wait_status, elem);
+        if (child->tid == child_tid && !child->waited)
+          {
+            cs = child;
+            cs->waited = true;
+            break;
+          }
+      }
+  lock_release (&leader->process_lock);
+  if (cs == NULL)
+    return -1;
+
+  sema_down (&cs->dead);
+
+  lock_acquire (&leader->process_lock);
+  list_remove (&cs->elem);
+  exit_code = leader->exiting ? -1 : cs->exit_code;
+  lock_release (&leader->process_lock);
+  release_child (cs);
+  return exit_code;
+}
+
+/* Starts ending the running thread's process with EXIT_CODE,
+   unless it is already ending, and wakes the process's other
+   threads that are blocked in the kernel, in process_wait(),
+   process_thread_join(), futex_wait(), on a pipe, or suspended by
+   load control, so that they notice.  Each of them
+   dies on its way back to user mode, as does any other thread of
+   the process that next enters the kernel (see
+   process_check_exit()).  A thread blocked reading the console,
+   or on a pipe that no descriptor of the process refers to any
+   longer because another thread closed it, is not woken and dies
+   only once its wait ends. */
+static void
+end_process (int exit_code)
 {
-  return -1;
+  struct thread *leader = thread_current ()->leader;
+  struct list_elem *e;
+  bool others;
+
+  lock_acquire (&leader->process_lock);
+  if (leader->exiting)
+    {
+      lock_release (&leader->process_lock);
+      return;
+    }
+  leader->exiting = true;
+  leader->process_exit_code = exit_code;
+  for (e = list_begin (&leader->children); e != list_end (&leader->children);
+       e = list_next (e))
+    {
+      struct wait_status *cs = list_entry (e, struct wait_status, elem);
+      if (cs->waited)
+        sema_up (&cs->dead);
+    }
+  others = leader->thread_cnt > 0;
+  cond_broadcast (&leader->threads_done, &leader->process_lock);
+  lock_release (&leader->process_lock);
+
+  if (others)
+    {
+      futex_wake_process (leader);
+      fdtable_wake_pipes (leader->fds);
+#ifdef VM
+      ws_wake_process (leader);
+#endif
+    }
 }
 
-/* Free the current process's resources. */
+/* Returns true if the running thread's process is ending, in
+   which case the thread should not block. */
+bool
+process_exiting (void)
+{
+  return thread_current ()->leader->exiting;
+}
+
+/* Kills the running thread, without changing its process's exit
+   code, if the process is ending.  Called on the way back to
+   user mode. */
+void
+process_check_exit (void)
+{
+  struct thread *cur = thread_current ();
+
+  if (cur->pagedir != NULL && cur->leader->exiting)
+    {
+      intr_enable ();
+      cur->quiet_exit = true;
+      thread_exit ();
+    }
+}
+
+/* Free the current process's resources.  Everything whose cost
+   depends on the size of the address space is left to the
+   reaper.
+
+   A thread that exits by calling exit(), or that the kernel
+   kills, ends its whole process: the first such thread sets the
+   process's exit code and the others die as soon as they can
+   (see end_process()).  A thread that calls thread_exit() ends
+   only itself.  Either way, the process's leader, which holds the
+   process's state, waits for the others before it frees
+   anything.  If every thread ends by calling thread_exit(), the
+   process's exit code is 0. */
 void
 process_exit (void)
 {
   struct thread *cur = thread_current ();
-  uint32_t *pd;
+  struct list_elem *e, *next;
+
+  if (cur->pagedir != NULL && !cur->quiet_exit)
+    end_process (cur->exit_code);
+
+  if (cur->leader != cur)
+    {
+      exit_thread ();
+      return;
+    }
+
+  /* Wait for our other threads, then free the completion status
+     of those that no one joined. */
+  lock_acquire (&cur->process_lock);
+  while (cur->thread_cnt > 0)
+    cond_wait (&cur->threads_done, &cur->process_lock);
+  lock_release (&cur->process_lock);
+  while (!list_empty (&cur->threads))
+    free (list_entry (list_pop_front (&cur->threads),
+                      struct join_status, elem));
+
+  if (cur->pagedir != NULL)
+    {
+      printf ("%s: exit(%d)\n", cur->name, cur->process_exit_code);
+      fault_exit ();
+    }
+
+  /* Close the process's files and remove its memory mappings,
+     writing back the pages that changed, so that the parent sees
+     their contents once it learns that we exited. */
+  syscall_exit ();
+
+  /* Allow writes to the executable again.  The file stays open
+     until the reaper is done with our pages, because they may
+     share frames keyed by its inode. */
+  if (cur->exec_file != NULL)
+    {
+      lock_acquire (&filesys_lock);
+      file_allow_write (cur->exec_file);
+      lock_release (&filesys_lock);
+    }
+
+  /* Notify parent that we're dead. */
+  if (cur->wait_status != NULL) 
+    {
+      struct wait_status *cs = cur->wait_status;
+      cs->exit_code = cur->process_exit_code;
+      sema_up (&cs->dead);
+      release_child (cs);
+    }
+
+  /* Free entries of children list. */
+  for (e = list_begin (&cur->children); e != list_end (&cur->children);
+       e = next) 
+    {
+      struct wait_status *cs = list_entry (e, struct wait_status, elem);
+      next = list_remove (e);
+      release_child (cs);
+    }
+
+  /* Leave the rest to the reaper, once we have switched away from
+     this thread for the last time (see thread_schedule_tail()). */
+  if (cur->pagedir != NULL)
+    cur->exited = true;
+}
+
+/* Raises the reaper's priority to that of the running thread,
+   which is short of frames, if dead processes are waiting for the
+   reaper.  Does nothing under the multi-level feedback queue
+   scheduler, which never lets a ready thread starve. */
+void
+process_reap_urgently (void)
+{
+  enum intr_level old_level;
+  int priority = thread_get_priority ();
 
-  /* Destroy the current process's page directory and switch back
-     to the kernel-only page directory. */
-  pd = cur->pagedir;
-  if (pd != NULL) 
+  if (thread_mlfqs || reaper_thread == NULL)
+    return;
+
+  old_level = intr_disable ();
+  if (reap_backlog > 0 && reaper_thread->initial_priority < priority)
     {
-      /* Correct ordering here is crucial.  We must set
-         cur->pagedir to NULL before switching page directories,
-         so that a timer interrupt can't switch back to the
-         process page directory.  We must activate the base page
-         directory before destroying the process's page
-         directory, or our active page directory will be one
-         that's been freed (and cleared). */
-      cur->pagedir = NULL;
-      pagedir_activate (NULL);
-      pagedir_destroy (pd);
+      reaper_thread->initial_priority = priority;
+      thread_calculate_priority (reaper_thread);
     }
+  intr_set_level (old_level);
+}
+
+/* Hands T, a process that has exited and that is no longer
+   running, to the reaper.  Called by the scheduler with
+   interrupts off. */
+void
+process_reap (struct thread *t)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (t->exited);
+
+  list_push_back (&reap_list, &t->elem);
+  if (++reap_backlog > reap_max_backlog)
+    reap_max_backlog = reap_backlog;
+  if (reaper_idle)
+    {
+      reaper_idle = false;
+      thread_unblock (reaper_thread);
+    }
+}
+
+/* Tears down the address space of T, a process that has exited. */
+static void
+destroy_address_space (struct thread *t)
+{
+#ifdef VM
+  /* Free the process's pages and the frames they occupy.  This
+     needs the page directory, so it must come first. */
+  page_table_destroy (t);
+  swap_exit (t);
+#endif
+
+  pagedir_destroy (t->pagedir);
+  t->pagedir = NULL;
+
+  if (t->exec_file != NULL)
+    {
+      lock_acquire (&filesys_lock);
+      file_close (t->exec_file);
+      lock_release (&filesys_lock);
+      t->exec_file = NULL;
+    }
+}
+
+/* The reaper thread. */
+static void
+reaper (void *aux UNUSED)
+{
+  reaper_thread = thread_current ();
+  for (;;)
+    {
+      enum intr_level old_level;
+      struct thread *t;
+
+      /* Drop back to the lowest priority once we have caught up
+         with the backlog that process_reap_urgently() raised us
+         for. */
+      if (!thread_mlfqs && reap_backlog == 0
+          && thread_current ()->initial_priority != PRI_MIN)
+        thread_set_priority (PRI_MIN);
+
+      old_level = intr_disable ();
+      while (list_empty (&reap_list))
+        {
+          reaper_idle = true;
+          thread_block ();
+        }
+      t = list_entry (list_pop_front (&reap_list), struct thread, elem);
+      intr_set_level (old_level);
+
+      destroy_address_space (t);
+
+      old_level = intr_disable ();
+      reap_backlog--;
+      reap_cnt++;
+      intr_set_level (old_level);
+      palloc_free_page (t);
+    }
+}
+
+/* Prints reaper statistics. */
+void
+process_print_stats (void)
+{
+  printf ("Reaper: %llu processes torn down, %zu waiting (at most %zu)\n",
+          reap_cnt, reap_backlog, reap_max_backlog);
 }
 
 /* Sets up the CPU for running user code in the current
@@ -124,8 +562,15 @@ process_activate (void)
 {
   struct thread *t = thread_current ();
 
-  /* Activate thread's page tables. */
-  pagedir_activate (t->pagedir);
+  /* Activate thread's page tables.  A thread without a user
+     address space never touches user memory and every page
+     directory has the same kernel mappings, so such a thread
+     just keeps running on the page directory that is already
+     active.  That way a switch from a process to a kernel
+     thread and back to the same process reloads CR3 not at
+     all. */
+  if (t->pagedir != NULL)
+    pagedir_activate (t->pagedir);
 
   /* Set thread's kernel stack for use in processing
      interrupts. */
@@ -195,19 +640,22 @@ struct Elf32_Phdr
 #define PF_W 2          /* Writable. */
 #define PF_R 4          /* Readable. */
 
-static bool setup_stack (void **esp);
+static bool setup_stack (const char *cmd_line, void **esp);
 static bool validate_segment (const struct Elf32_Phdr *, struct file *);
 static bool load_segment (struct file *file, off_t ofs, uint8_t *upage,
                           uint32_t read_bytes, uint32_t zero_bytes,
                           bool writable);
 
-/* Loads an ELF executable from FILE_NAME into the current thread.
+/* Loads an ELF executable from the first word of CMD_LINE into
+   the current thread, and sets up its stack with the words of
+   CMD_LINE as arguments.
    Stores the executable's entry point into *EIP
    and its initial stack pointer into *ESP.
    Returns true if successful, false otherwise. */
 bool
-load (const char *file_name, void (**eip) (void), void **esp) 
+load (const char *cmd_line, void (**eip) (void), void **esp) 
 {
+  char file_name[NAME_MAX + 2];
   struct thread *t = thread_current ();
   struct Elf32_Ehdr ehdr;
   struct file *file = NULL;
@@ -215,11 +663,24 @@ load (const char *file_name, void (**eip) (void), void **esp)
   bool success = false;
   int i;
 
+  /* Every path to `done' releases the file system lock, so take
+     it before the first one. */
+  lock_acquire (&filesys_lock);
+
   /* Allocate and activate page directory. */
   t->pagedir = pagedir_create ();
   if (t->pagedir == NULL) 
     goto done;
   process_activate ();
+#ifdef VM
+  page_table_init ();
+#endif
+
+  /* Extract file_name from command line. */
+  while (*cmd_line == ' ')
+    cmd_line++;
+  strlcpy (file_name, cmd_line, sizeof file_name);
+  file_name[strcspn (file_name, " ")] = '\0';
 
   /* Open executable file. */
   file = filesys_open (file_name);
@@ -302,7 +763,7 @@ load (const char *file_name, void (**eip) (void), void **esp)
     }
 
   /* Set up stack. */
-  if (!setup_stack (esp))
+  if (!setup_stack (cmd_line, esp))
     goto done;
 
   /* Start address. */
@@ -311,14 +772,26 @@ load (const char *file_name, void (**eip) (void), void **esp)
   success = true;
 
  done:
-  /* We arrive here whether the load is successful or not. */
-  file_close (file);
+  /* We arrive here whether the load is successful or not.  If it
+     is, keep the executable open and unmodifiable for as long as
+     the process runs, because its pages may be read from it
+     later on demand. */
+  if (success)
+    {
+      file_deny_write (file);
+      t->exec_file = file;
+    }
+  else
+    file_close (file);
+  lock_release (&filesys_lock);
   return success;
 }
 
 /* load() helpers. */
 
+#ifndef VM
 static bool install_page (void *upage, void *kpage, bool writable);
+#endif
 
 /* Checks whether PHDR describes a valid, loadable segment in
    FILE and returns true if so, false otherwise. */
@@ -377,6 +850,10 @@ validate_segment (const struct Elf32_Phdr *phdr, struct file *file)
    The pages initialized by this function must be writable by the
    user process if WRITABLE is true, read-only otherwise.
 
+   With virtual memory, the pages are only recorded in the
+   supplemental page table here, and each one is read in by the
+   page fault handler the first time it is accessed.
+
    Return true if successful, false if a memory allocation error
    or disk read error occurs. */
 static bool
@@ -387,7 +864,9 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
   ASSERT (pg_ofs (upage) == 0);
   ASSERT (ofs % PGSIZE == 0);
 
+#ifndef VM
   file_seek (file, ofs);
+#endif
   while (read_bytes > 0 || zero_bytes > 0) 
     {
       /* Calculate how to fill this page.
@@ -396,6 +875,12 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
       size_t page_read_bytes = read_bytes < PGSIZE ? read_bytes : PGSIZE;
       size_t page_zero_bytes = PGSIZE - page_read_bytes;
 
+#ifdef VM
+      /* Record where this page comes from. */
+      if (!page_add_file (upage, file, ofs, page_read_bytes, writable))
+        return false;
+      ofs += page_read_bytes;
+#else
       /* Get a page of memory. */
       uint8_t *kpage = palloc_get_page (PAL_USER);
       if (kpage == NULL)
@@ -415,6 +900,7 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
           palloc_free_page (kpage);
           return false; 
         }
+#endif
 
       /* Advance. */
       read_bytes -= page_read_bytes;
@@ -424,26 +910,127 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
   return true;
 }
 
+/* Reverses the order of the ARGC pointers to char in ARGV. */
+static void
+reverse (int argc, char **argv) 
+{
+  for (; argc > 1; argc -= 2, argv++) 
+    {
+      char *tmp = argv[0];
+      argv[0] = argv[argc - 1];
+      argv[argc - 1] = tmp;
+    }
+}
+
+/* Pushes the SIZE bytes in BUF onto the stack in KPAGE, whose
+   page-relative stack pointer is *OFS, and then adjusts *OFS
+   appropriately.  The bytes pushed are rounded to a 32-bit
+   boundary.
+
+   If successful, returns a pointer to the newly pushed object.
+   On failure, returns a null pointer. */
+static void *
+push (uint8_t *kpage, size_t *ofs, const void *buf, size_t size) 
+{
+  size_t padsize = ROUND_UP (size, sizeof (uint32_t));
+  if (*ofs < padsize)
+    return NULL;
+
+  *ofs -= padsize;
+  memcpy (kpage + *ofs + (padsize - size), buf, size);
+  return kpage + *ofs + (padsize - size);
+}
+
+/* Builds, in KPAGE, the contents of the user stack page UPAGE
+   that pass the words of CMD_LINE to main() as argc and argv, and
+   sets *OFS to the initial stack pointer, relative to the start
+   of the page.  Returns true if successful, false if the
+   arguments do not fit. */
+static bool
+init_cmd_line (uint8_t *kpage, uint8_t *upage, const char *cmd_line,
+               size_t *ofs) 
+{
+  char *const null = NULL;
+  char *cmd_line_copy;
+  char *karg, *saveptr;
+  int argc;
+  char **argv;
+
+  /* Push command line string. */
+  *ofs = PGSIZE;
+  cmd_line_copy = push (kpage, ofs, cmd_line, strlen (cmd_line) + 1);
+  if (cmd_line_copy == NULL)
+    return false;
+
+  if (push (kpage, ofs, &null, sizeof null) == NULL)
+    return false;
+
+  /* Parse command line into arguments
+     and push them in reverse order. */
+  argc = 0;
+  for (karg = strtok_r (cmd_line_copy, " ", &saveptr); karg != NULL;
+       karg = strtok_r (NULL, " ", &saveptr))
+    {
+      void *uarg = upage + (karg - (char *) kpage);
+      if (push (kpage, ofs, &uarg, sizeof uarg) == NULL)
+        return false;
+      argc++;
+    }
+
+  /* Reverse the order of the command line arguments. */
+  argv = (char **) (upage + *ofs);
+  reverse (argc, (char **) (kpage + *ofs));
+
+  /* Push argv, argc, "return address". */
+  if (push (kpage, ofs, &argv, sizeof argv) == NULL
+      || push (kpage, ofs, &argc, sizeof argc) == NULL
+      || push (kpage, ofs, &null, sizeof null) == NULL)
+    return false;
+  return true;
+}
+
 /* Create a minimal stack by mapping a zeroed page at the top of
-   user virtual memory. */
+   user virtual memory, and push the arguments in CMD_LINE onto
+   it. */
 static bool
-setup_stack (void **esp) 
+setup_stack (const char *cmd_line, void **esp) 
 {
+  uint8_t *upage = ((uint8_t *) PHYS_BASE) - PGSIZE;
   uint8_t *kpage;
+  size_t ofs;
   bool success = false;
 
+#ifdef VM
+  if (!page_add_zero (upage, true) || !page_load (upage))
+    return false;
+#else
   kpage = palloc_get_page (PAL_USER | PAL_ZERO);
-  if (kpage != NULL) 
+  if (kpage == NULL)
+    return false;
+  if (!install_page (upage, kpage, true))
     {
-      success = install_page (((uint8_t *) PHYS_BASE) - PGSIZE, kpage, true);
-      if (success)
-        *esp = PHYS_BASE;
-      else
-        palloc_free_page (kpage);
+      palloc_free_page (kpage);
+      return false;
+    }
+#endif
+
+  /* Build the stack contents in a scratch page, then copy them
+     into the stack page, which is mapped in the running page
+     directory. */
+  kpage = palloc_get_page (0);
+  if (kpage == NULL)
+    return false;
+  if (init_cmd_line (kpage, upage, cmd_line, &ofs)
+      && copy_to_user (upage + ofs, kpage + ofs, PGSIZE - ofs) == 0)
+    {
+      *esp = upage + ofs;
+      success = true;
     }
+  palloc_free_page (kpage);
   return success;
 }
 
+#ifndef VM
 /* Adds a mapping from user virtual address UPAGE to kernel
    virtual address KPAGE to the page table.
    If WRITABLE is true, the user process may modify the page;
@@ -463,3 +1050,285 @@ install_page (void *upage, void *kpage, bool writable)
   return (pagedir_get_page (t->pagedir, upage) == NULL
           && pagedir_set_page (t->pagedir, upage, kpage, writable));
 }
+#endif
+
+/* Returns true if user page UPAGE is free to hold part of a new
+   thread's stack in the running process. */
+static bool
+is_free_stack_page (uint8_t *upage)
+{
+#ifdef VM
+  return !page_is_stack (upage) && page_lookup (upage) == NULL;
+#else
+  return pagedir_get_page (thread_current ()->pagedir, upage) == NULL;
+#endif
+}
+
+/* Returns the base of the highest run of THREAD_STACK_PAGES + 1
+   free pages in the running process, or a null pointer if there
+   is none.  A new stack goes in the lower THREAD_STACK_PAGES
+   pages, and the page above is left free, so that a stack that
+   overflows faults instead of running into the stack or mapping
+   above it. */
+static uint8_t *
+find_stack_space (void)
+{
+  uint8_t *upage = PHYS_BASE;
+  size_t free_cnt = 0;
+
+  while ((uintptr_t) upage > PGSIZE)
+    {
+      upage -= PGSIZE;
+      if (!is_free_stack_page (upage))
+        free_cnt = 0;
+      else if (++free_cnt == THREAD_STACK_PAGES + 1)
+        return upage;
+    }
+  return NULL;
+}
+
+/* Frees the first PAGE_CNT pages of the thread stack at BASE in
+   the running process. */
+static void
+free_thread_stack (uint8_t *base, size_t page_cnt)
+{
+  size_t i;
+
+  for (i = 0; i < page_cnt; i++)
+    {
+      uint8_t *upage = base + i * PGSIZE;
+#ifdef VM
+      page_remove (upage);
+#else
+      uint32_t *pd = thread_current ()->pagedir;
+      void *kpage = pagedir_get_page (pd, upage);
+
+      pagedir_clear_page (pd, upage);
+      palloc_free_page (kpage);
+#endif
+    }
+}
+
+/* Maps user page UPAGE, which must be free, as a zeroed page of
+   a thread stack in the running process.  With VM, the page is
+   brought in when the thread first touches it.  Returns true if
+   successful, false if memory is not available. */
+static bool
+map_stack_page (uint8_t *upage)
+{
+#ifdef VM
+  return page_add_zero (upage, true);
+#else
+  uint8_t *kpage = palloc_get_page (PAL_USER | PAL_ZERO);
+  if (kpage == NULL)
+    return false;
+  if (!install_page (upage, kpage, true))
+    {
+      palloc_free_page (kpage);
+      return false;
+    }
+  return true;
+#endif
+}
+
+/* Maps a new stack for a thread in the running process and
+   returns its base, or a null pointer if there is no room for it
+   or memory is not available. */
+static uint8_t *
+alloc_thread_stack (void)
+{
+  uint8_t *base;
+  size_t i;
+
+  /* Keep the other threads from mapping anything where the stack
+     goes until it is complete. */
+#ifdef VM
+  page_table_lock ();
+#else
+  lock_acquire (&thread_current ()->leader->process_lock);
+#endif
+
+  base = find_stack_space ();
+  for (i = 0; base != NULL && i < THREAD_STACK_PAGES; i++)
+    if (!map_stack_page (base + i * PGSIZE))
+      {
+        free_thread_stack (base, i);
+        base = NULL;
+      }
+
+#ifdef VM
+  page_table_unlock ();
+#else
+  lock_release (&thread_current ()->leader->process_lock);
+#endif
+  return base;
+}
+
+/* Starts a new thread in the running process, sharing its address
+   space and file descriptors, with a stack of its own of
+   THREAD_STACK_PAGES pages.  The thread starts running user code
+   at ENTRY as if ENTRY had been called as ENTRY(FUNC, ARG) and
+   must not return from it.  Returns the new thread's id, or
+   TID_ERROR if the thread cannot be created. */
+tid_t
+process_thread_create (void (*entry) (void), void *func, void *arg)
+{
+  struct thread *leader = thread_current ()->leader;
+  struct thread_info info;
+  uint32_t frame[3];
+  tid_t tid;
+
+  info.js = malloc (sizeof *info.js);
+  if (info.js == NULL)
+    return TID_ERROR;
+  info.js->stack = alloc_thread_stack ();
+  if (info.js->stack == NULL)
+    {
+      free (info.js);
+      return TID_ERROR;
+    }
+  info.js->dead = false;
+
+  /* Push ENTRY's arguments and a null return address. */
+  frame[0] = 0;
+  frame[1] = (uint32_t) func;
+  frame[2] = (uint32_t) arg;
+  info.esp = info.js->stack + THREAD_STACK_PAGES * PGSIZE - sizeof frame;
+  if (copy_to_user (info.esp, frame, sizeof frame) != 0)
+    goto error;
+
+  info.leader = leader;
+  info.eip = entry;
+  sema_init (&info.started, 0);
+
+  /* Count the thread before it can run, so that the leader waits
+     for it even if the leader exits first. */
+  lock_acquire (&leader->process_lock);
+  leader->thread_cnt++;
+  lock_release (&leader->process_lock);
+
+  tid = thread_create (thread_name (), PRI_DEFAULT, start_thread, &info);
+  if (tid == TID_ERROR)
+    {
+      lock_acquire (&leader->process_lock);
+      leader->thread_cnt--;
+      lock_release (&leader->process_lock);
+      goto error;
+    }
+  sema_down (&info.started);
+  return tid;
+
+ error:
+  free_thread_stack (info.js->stack, THREAD_STACK_PAGES);
+  free (info.js);
+  return TID_ERROR;
+}
+
+/* A thread function that starts a new thread in an existing user
+   process. */
+static void
+start_thread (void *info_)
+{
+  struct thread_info *info = info_;
+  struct thread *cur = thread_current ();
+  struct thread *leader = info->leader;
+  struct intr_frame if_;
+
+  /* Join the process. */
+  cur->leader = leader;
+  cur->pagedir = leader->pagedir;
+  cur->fds = leader->fds;
+  cur->join_status = info->js;
+  process_activate ();
+
+  lock_acquire (&leader->process_lock);
+  cur->join_status->tid = cur->tid;
+  list_push_back (&leader->threads, &cur->join_status->elem);
+  lock_release (&leader->process_lock);
+
+  /* Initialize interrupt frame. */
+  memset (&if_, 0, sizeof if_);
+  if_.gs = if_.fs = if_.es = if_.ds = if_.ss = SEL_UDSEG;
+  if_.cs = SEL_UCSEG;
+  if_.eflags = FLAG_IF | FLAG_MBS;
+  if_.eip = info->eip;
+  if_.esp = info->esp;
+  sema_up (&info->started);
+
+  /* We enter user mode without passing through intr_handler(), so
+     check whether the process began to end while we started. */
+  process_check_exit ();
+
+  /* Start running user code, as in start_process(). */
+  asm volatile ("movl %0, %%esp; jmp intr_exit" : : "g" (&if_) : "memory");
+  NOT_REACHED ();
+}
+
+/* Waits for thread TID, another thread in the running process
+   other than its leader, to end.  Returns true if successful,
+   false if TID is not such a thread, is the running thread, or
+   has already been joined, or if the process begins to end while
+   waiting, in which case the running thread is about to die. */
+bool
+process_thread_join (tid_t tid)
+{
+  struct thread *leader = thread_current ()->leader;
+  struct join_status *js = NULL;
+  struct list_elem *e;
+
+  if (tid == thread_tid ())
+    return false;
+
+  lock_acquire (&leader->process_lock);
+  for (e = list_begin (&leader->threads); e != list_end (&leader->threads);
+       e = list_next (e))
+    if (list_entry (e, struct join_status, elem)->tid == tid)
+      {
+        js = list_entry (e, struct join_status, elem);
+        list_remove (e);
+        break;
+      }
+  if (js == NULL)
+    {
+      lock_release (&leader->process_lock);
+      return false;
+    }
+
+  /* end_process() wakes us if the process ends first, which
+     keeps threads that join each other from waiting forever.
+     Then the leader frees JS once the thread is gone. */
+  while (!js->dead && !leader->exiting)
+    cond_wait (&leader->threads_done, &leader->process_lock);
+  if (!js->dead)
+    {
+      list_push_back (&leader->threads, &js->elem);
+      lock_release (&leader->process_lock);
+      return false;
+    }
+  lock_release (&leader->process_lock);
+  free (js);
+  return true;
+}
+
+/* Ends the running thread, which is not its process's leader, and
+   lets the leader know. */
+static void
+exit_thread (void)
+{
+  struct thread *cur = thread_current ();
+  struct thread *leader = cur->leader;
+  struct join_status *js = cur->join_status;
+
+  syscall_exit ();
+  free_thread_stack (js->stack, THREAD_STACK_PAGES);
+
+  /* Once the leader learns that we are gone, the address space may
+     be torn down at any time. */
+  cur->pagedir = NULL;
+
+  lock_acquire (&leader->process_lock);
+  js->dead = true;
+  leader->thread_cnt--;
+  cond_broadcast (&leader->threads_done, &leader->process_lock);
+  lock_release (&leader->process_lock);
+}
@@ -3,9 +3,17 @@
 
 #include "threads/thread.h"
 
+void process_init (void);
 tid_t process_execute (const char *file_name);
 int process_wait (tid_t);
+tid_t process_thread_create (void (*entry) (void), void *func, void *arg);
+bool process_thread_join (tid_t);
 void process_exit (void);
+bool process_exiting (void);
+void process_check_exit (void);
 void process_activate (void);
+void process_reap (struct thread *);
+void process_reap_urgently (void);
+void process_print_stats (void);
 
 #endif /* userprog/process.h */
@@ -1,20 +1,1286 @@
 #include "userprog/syscall.h"
+#include <iovec.h>
+#include <limits.h>
+#include <pipe.h>
 #include <stdio.h>
+#include <string.h>
+#include <syscall-batch.h>
 #include <syscall-nr.h>
+#include "devices/input.h"
+#include "devices/shutdown.h"
+#include "filesys/file.h"
+#include "filesys/filesys.h"
+#include "filesys/inode.h"
+#include "threads/cpu.h"
 #include "threads/interrupt.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
 #include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "userprog/aio.h"
+#include "userprog/fdtable.h"
+#include "userprog/futex.h"
+#include "userprog/gdt.h"
+#include "userprog/pipe.h"
+#include "userprog/process.h"
+#include "userprog/usercopy.h"
+#ifdef VM
+#include "vm/page.h"
+#include "vm/shm.h"
+#endif
 
-static void syscall_handler (struct intr_frame *);
+/* Called from intr_handler() for "int $0x30", and from
+   sysenter_entry in userprog/sysenter.S. */
+void syscall_handler (struct intr_frame *);
+
+static void copy_in (void *, const void *, size_t);
+static void copy_out (void *, const void *, size_t);
+static char *copy_in_string (const char *);
+static void release_file (void);
+
+static void sys_halt (void) NO_RETURN;
+static void sys_exit (int status) NO_RETURN;
+static int sys_exec (const char *ufile);
+static int sys_wait (tid_t);
+static int sys_create (const char *ufile, unsigned initial_size);
+static int sys_remove (const char *ufile);
+static int sys_open (const char *ufile);
+static int sys_filesize (int handle);
+static int sys_read (int handle, void *udst, unsigned size);
+static int sys_write (int handle, const void *usrc, unsigned size);
+static int sys_seek (int handle, unsigned position);
+static int sys_tell (int handle);
+static int sys_close (int handle);
+static int sys_dup (int handle);
+static int sys_dup2 (int old_handle, int new_handle);
+static int sys_pipe (int *ufds, unsigned flags);
+static int sys_shm_create (unsigned page_cnt);
+static int sys_shm_attach (int id, void *addr);
+static int sys_shm_detach (void *addr);
+static int sys_futex_wait (int *uaddr, int expected);
+static int sys_futex_wake (int *uaddr, unsigned cnt);
+static int sys_thread_create (void (*entry) (void), void *func, void *arg);
+static int sys_thread_join (tid_t);
+static void sys_thread_exit (void) NO_RETURN;
+static int sys_mmap (int handle, void *addr);
+static int sys_munmap (int mapping);
+static int sys_chdir (const char *udir);
+static int sys_mkdir (const char *udir);
+static int sys_readdir (int handle, char *uname);
+static int sys_isdir (int handle);
+static int sys_inumber (int handle);
+
+static int sys_batch (struct syscall_batch_entry *uentries, unsigned cnt,
+                      unsigned flags);
+static int sys_aio_setup (struct aio_ring *uring);
+static int sys_aio_enter (unsigned to_submit, unsigned min_complete);
+static int sys_readv (int handle, const struct iovec *uiov, unsigned iovcnt);
+static int sys_writev (int handle, const struct iovec *uiov, unsigned iovcnt);
+
+/* How a system call reports failure, for BATCH_STOP_ON_ERROR. */
+enum syscall_failure
+  {
+    FAIL_NEGATIVE,              /* Returns a negative value. */
+    FAIL_FALSE,                 /* Returns false. */
+    FAIL_NEVER                  /* Cannot fail, or kills the process. */
+  };
+
+/* A system call. */
+typedef int syscall_function (int, int, int);
+struct syscall
+  {
+    const char *name;           /* Name, for statistics. */
+    size_t arg_cnt;             /* Number of arguments. */
+    enum syscall_failure failure; /* How it reports failure. */
+    syscall_function *func;     /* Implementation. */
+  };
+
+/* Table of system calls, indexed by system call number.  The
+   implementations take their arguments as their real types, which
+   the i386 calling convention passes just like ints.  Casting
+   through a pointer to a function without arguments keeps GCC
+   from warning about the conversion. */
+#define SYSCALL(NAME, ARG_CNT, FAILURE)                         \
+        {#NAME, ARG_CNT, FAIL_##FAILURE,                        \
+         (syscall_function *) (void (*) (void)) sys_##NAME}
+static const struct syscall syscall_table[] =
+  {
+    [SYS_HALT] = SYSCALL (halt, 0, NEVER),
+    [SYS_EXIT] = SYSCALL (exit, 1, NEVER),
+    [SYS_EXEC] = SYSCALL (exec, 1, NEGATIVE),
+    [SYS_WAIT] = SYSCALL (wait, 1, NEGATIVE),
+    [SYS_CREATE] = SYSCALL (create, 2, FALSE),
+    [SYS_REMOVE] = SYSCALL (remove, 1, FALSE),
+    [SYS_OPEN] = SYSCALL (open, 1, NEGATIVE),
+    [SYS_FILESIZE] = SYSCALL (filesize, 1, NEVER),
+    [SYS_READ] = SYSCALL (read, 3, NEGATIVE),
+    [SYS_WRITE] = SYSCALL (write, 3, NEGATIVE),
+    [SYS_SEEK] = SYSCALL (seek, 2, NEVER),
+    [SYS_TELL] = SYSCALL (tell, 1, NEVER),
+    [SYS_CLOSE] = SYSCALL (close, 1, NEVER),
+    [SYS_MMAP] = SYSCALL (mmap, 2, NEGATIVE),
+    [SYS_MUNMAP] = SYSCALL (munmap, 1, NEVER),
+    [SYS_CHDIR] = SYSCALL (chdir, 1, FALSE),
+    [SYS_MKDIR] = SYSCALL (mkdir, 1, FALSE),
+    [SYS_READDIR] = SYSCALL (readdir, 2, FALSE),
+    [SYS_ISDIR] = SYSCALL (isdir, 1, NEVER),
+    [SYS_INUMBER] = SYSCALL (inumber, 1, NEVER),
+    [SYS_BATCH] = SYSCALL (batch, 3, NEVER),
+    [SYS_AIO_SETUP] = SYSCALL (aio_setup, 1, NEGATIVE),
+    [SYS_AIO_ENTER] = SYSCALL (aio_enter, 2, NEGATIVE),
+    [SYS_READV] = SYSCALL (readv, 3, NEGATIVE),
+    [SYS_WRITEV] = SYSCALL (writev, 3, NEGATIVE),
+    [SYS_DUP] = SYSCALL (dup, 1, NEGATIVE),
+    [SYS_DUP2] = SYSCALL (dup2, 2, NEGATIVE),
+    [SYS_PIPE] = SYSCALL (pipe, 2, NEGATIVE),
+    [SYS_SHM_CREATE] = SYSCALL (shm_create, 1, NEGATIVE),
+    [SYS_SHM_ATTACH] = SYSCALL (shm_attach, 2, FALSE),
+    [SYS_SHM_DETACH] = SYSCALL (shm_detach, 1, FALSE),
+    [SYS_FUTEX_WAIT] = SYSCALL (futex_wait, 2, NEGATIVE),
+    [SYS_FUTEX_WAKE] = SYSCALL (futex_wake, 2, NEVER),
+    [SYS_THREAD_CREATE] = SYSCALL (thread_create, 3, NEGATIVE),
+    [SYS_THREAD_JOIN] = SYSCALL (thread_join, 1, FALSE),
+    [SYS_THREAD_EXIT] = SYSCALL (thread_exit, 0, NEVER),
+  };
+#undef SYSCALL
+
+/* Number of system calls. */
+#define SYSCALL_CNT (sizeof syscall_table / sizeof *syscall_table)
+
+/* Ways to enter the kernel for a system call. */
+enum syscall_entry
+  {
+    ENTRY_INT,                  /* "int $0x30". */
+    ENTRY_SYSENTER,             /* SYSENTER. */
+    ENTRY_BATCH,                /* Within a batch system call. */
+    ENTRY_CNT
+  };
+static const char *entry_names[ENTRY_CNT] = {"int $0x30", "sysenter", "batch"};
+
+/* Calls of each system call that returned, by way of entry, and
+   the cycles spent in them, from entry to the system call handler
+   to return from it.  These leave out the kernel's entry and exit
+   paths, which examples/syscall-bench times along with the rest
+   of each call's round trip from user mode.  Protected by
+   disabling interrupts. */
+static unsigned long long call_cnt[ENTRY_CNT][SYSCALL_CNT];
+static uint64_t call_cycles[ENTRY_CNT][SYSCALL_CNT];
+
+/* Do user programs enter the kernel with SYSENTER?  Set if the
+   CPU supports it.  User programs make the same check, and use
+   "int $0x30" otherwise. */
+bool syscall_sysenter;
 
 void
-syscall_init (void) 
+syscall_init (void)
 {
   intr_register_int (0x30, 3, INTR_ON, syscall_handler, "syscall");
+  fdtable_init ();
+
+  /* SYSENTER jumps to sysenter_entry in the kernel code segment
+     with the stack that tss_update() sets up.  SYSEXIT returns to
+     the user code and stack segments, whose selectors it derives
+     from the kernel's, which is why they follow it in the GDT. */
+  if (cpu_has_sysenter ())
+    {
+      msr_write (MSR_SYSENTER_CS, SEL_KCSEG);
+      msr_write (MSR_SYSENTER_EIP, (uint32_t) sysenter_entry);
+      syscall_sysenter = true;
+    }
 }
 
+/* Records that a call to system call CALL_NR, by way of ENTRY,
+   that began at cycle START has returned. */
 static void
-syscall_handler (struct intr_frame *f UNUSED) 
+count_call (enum syscall_entry entry, unsigned call_nr, uint64_t start)
+{
+  uint64_t cycles = cpu_cycles () - start;
+  enum intr_level old_level;
+
+  old_level = intr_disable ();
+  call_cnt[entry][call_nr]++;
+  call_cycles[entry][call_nr] += cycles;
+  intr_set_level (old_level);
+}
+
+/* System call handler.  The system call number is at the user
+   stack pointer, followed by up to three 32-bit arguments. */
+void
+syscall_handler (struct intr_frame *f)
 {
-  printf ("system call!\n");
+  enum syscall_entry entry = f->vec_no == 0x30 ? ENTRY_INT : ENTRY_SYSENTER;
+  uint64_t start = cpu_cycles ();
+  const struct syscall *sc;
+  unsigned call_nr;
+  int args[3];
+
+#ifdef VM
+  thread_current ()->user_esp = f->esp;
+#endif
+
+  /* Get the system call. */
+  copy_in (&call_nr, f->esp, sizeof call_nr);
+  if (call_nr >= SYSCALL_CNT)
+    sys_exit (-1);
+  sc = syscall_table + call_nr;
+
+  /* Get the system call arguments. */
+  ASSERT (sc->arg_cnt <= sizeof args / sizeof *args);
+  memset (args, 0, sizeof args);
+  copy_in (args, (uint32_t *) f->esp + 1, sizeof *args * sc->arg_cnt);
+
+  /* Execute the system call, and set the return value. */
+  f->eax = sc->func (args[0], args[1], args[2]);
+  release_file ();
+  count_call (entry, call_nr, start);
+
+  /* Die here if the process is ending.  "int $0x30" would also be
+     caught by intr_handler(), but SYSENTER bypasses it. */
+  process_check_exit ();
+}
+
+/* Prints the number of calls of each system call by each way of
+   entry, and the average cycles each spent in the handler. */
+void
+syscall_print_stats (void)
+{
+  int entry;
+  size_t i;
+
+  printf ("Syscall: sysenter %s\n",
+          syscall_sysenter ? "enabled" : "not supported");
+  for (entry = 0; entry < ENTRY_CNT; entry++)
+    for (i = 0; i < SYSCALL_CNT; i++)
+      if (call_cnt[entry][i] > 0)
+        printf ("Syscall: %llu %s calls by %s, %llu cycles each in "
+                "handler\n",
+                call_cnt[entry][i], syscall_table[i].name,
+                entry_names[entry],
+                call_cycles[entry][i] / call_cnt[entry][i]);
+}
+
+/* Copies SIZE bytes from user address USRC to kernel address
+   DST.  Kills the process if USRC is not valid. */
+static void
+copy_in (void *dst, const void *usrc, size_t size)
+{
+  if (copy_from_user (dst, usrc, size) != 0)
+    sys_exit (-1);
+}
+
+/* Copies SIZE bytes from kernel address SRC to user address
+   UDST.  Kills the process if UDST is not valid. */
+static void
+copy_out (void *udst, const void *src, size_t size)
+{
+  if (copy_to_user (udst, src, size) != 0)
+    sys_exit (-1);
+}
+
+/* Creates a copy of user string US in kernel memory and returns
+   it as a page that must be freed with palloc_free_page().
+   Truncates the string at PGSIZE bytes in size.  Kills the
+   process if US is not valid, or returns a null pointer if
+   memory is not available. */
+static char *
+copy_in_string (const char *us)
+{
+  char *ks;
+  int length;
+
+  ks = palloc_get_page (0);
+  if (ks == NULL)
+    return NULL;
+
+  length = strncpy_from_user (ks, us, PGSIZE);
+  if (length < 0)
+    {
+      palloc_free_page (ks);
+      sys_exit (-1);
+    }
+  ks[PGSIZE - 1] = '\0';
+  return ks;
+}
+
+/* Halt system call. */
+static void
+sys_halt (void)
+{
+  shutdown_power_off ();
+}
+
+/* Exit system call. */
+static void
+sys_exit (int status)
+{
+  thread_current ()->exit_code = status;
   thread_exit ();
 }
+
+/* Exec system call. */
+static int
+sys_exec (const char *ufile)
+{
+  char *kfile = copy_in_string (ufile);
+  tid_t tid;
+
+  if (kfile == NULL)
+    return -1;
+  tid = process_execute (kfile);
+  palloc_free_page (kfile);
+  return tid;
+}
+
+/* Wait system call. */
+static int
+sys_wait (tid_t child)
+{
+  return process_wait (child);
+}
+
+/* Create system call. */
+static int
+sys_create (const char *ufile, unsigned initial_size)
+{
+  char *kfile = copy_in_string (ufile);
+  bool ok;
+
+  if (kfile == NULL)
+    return false;
+  lock_acquire (&filesys_lock);
+  ok = filesys_create (kfile, initial_size);
+  lock_release (&filesys_lock);
+  palloc_free_page (kfile);
+  return ok;
+}
+
+/* Remove system call. */
+static int
+sys_remove (const char *ufile)
+{
+  char *kfile = copy_in_string (ufile);
+  bool ok;
+
+  if (kfile == NULL)
+    return false;
+  lock_acquire (&filesys_lock);
+  ok = filesys_remove (kfile);
+  lock_release (&filesys_lock);
+  palloc_free_page (kfile);
+  return ok;
+}
+
+/* Open system call. */
+static int
+sys_open (const char *ufile)
+{
+  char *kfile = copy_in_string (ufile);
+  struct file *file;
+  int handle = -1;
+
+  if (kfile == NULL)
+    return -1;
+  lock_acquire (&filesys_lock);
+  file = filesys_open (kfile);
+  lock_release (&filesys_lock);
+  if (file != NULL)
+    {
+      handle = fdtable_install (thread_current ()->fds, file);
+      if (handle < 0)
+        {
+          lock_acquire (&filesys_lock);
+          file_close (file);
+          lock_release (&filesys_lock);
+        }
+    }
+  palloc_free_page (kfile);
+  return handle;
+}
+
+/* Returns the object open as HANDLE in the running process, or a
+   null pointer if there is none.  The object stays open until the
+   system call returns, even if another thread in the process
+   closes HANDLE in the meantime.  A system call may look up only
+   one object. */
+static struct open_file *
+lookup (int handle)
+{
+  struct thread *cur = thread_current ();
+
+  ASSERT (cur->held_file == NULL);
+  cur->held_file = fdtable_get (cur->fds, handle);
+  return cur->held_file;
+}
+
+/* Releases the object that the running system call looked up, if
+   any. */
+static void
+release_file (void)
+{
+  struct thread *cur = thread_current ();
+
+  if (cur->held_file != NULL)
+    {
+      fdtable_put (cur->held_file);
+      cur->held_file = NULL;
+    }
+}
+
+/* Returns the file open as HANDLE in the running process, or a
+   null pointer if there is none.  Like lookup(). */
+static struct file *
+lookup_file (int handle)
+{
+  struct open_file *of = lookup (handle);
+  return of != NULL && of->kind == FD_FILE ? of->file : NULL;
+}
+
+/* Returns the object open as HANDLE in the running process.
+   Kills the process if HANDLE is not open.  Like lookup(). */
+static struct open_file *
+lookup_or_exit (int handle)
+{
+  struct open_file *of = lookup (handle);
+  if (of == NULL)
+    sys_exit (-1);
+  return of;
+}
+
+/* Returns the file open as HANDLE in the running process.  Kills
+   the process if HANDLE is not an open file.  Like lookup(). */
+static struct file *
+lookup_file_or_exit (int handle)
+{
+  struct file *file = lookup_file (handle);
+  if (file == NULL)
+    sys_exit (-1);
+  return file;
+}
+
+/* Dup system call. */
+static int
+sys_dup (int handle)
+{
+  return fdtable_dup (thread_current ()->fds, handle);
+}
+
+/* Dup2 system call. */
+static int
+sys_dup2 (int old_handle, int new_handle)
+{
+  return fdtable_dup2 (thread_current ()->fds, old_handle, new_handle);
+}
+
+/* Pipe system call.  Creates a pipe and stores descriptors for
+   its read and write ends in UFDS[0] and UFDS[1], respectively.
+   If FLAGS includes PIPE_NONBLOCK, I/O on both ends fails
+   instead of blocking.  Returns 0 if successful, -1 on
+   failure. */
+static int
+sys_pipe (int *ufds, unsigned flags)
+{
+  struct fd_table *fds = thread_current ()->fds;
+  bool nonblocking = (flags & PIPE_NONBLOCK) != 0;
+  struct pipe *pipe;
+  int kfds[2];
+
+  pipe = pipe_create ();
+  if (pipe == NULL)
+    return -1;
+  kfds[0] = fdtable_install_pipe (fds, pipe, false, nonblocking);
+  if (kfds[0] < 0)
+    {
+      pipe_close (pipe, false);
+      pipe_close (pipe, true);
+      return -1;
+    }
+  kfds[1] = fdtable_install_pipe (fds, pipe, true, nonblocking);
+  if (kfds[1] < 0)
+    {
+      pipe_close (pipe, true);
+      fdtable_close (fds, kfds[0]);
+      return -1;
+    }
+  copy_out (ufds, kfds, sizeof kfds);
+  return 0;
+}
+
+/* Filesize system call. */
+static int
+sys_filesize (int handle)
+{
+  struct file *file = lookup_file_or_exit (handle);
+  int size;
+
+  lock_acquire (&filesys_lock);
+  size = file_length (file);
+  lock_release (&filesys_lock);
+  return size;
+}
+
+/* Read system call.
+
+   Reads from files go through a kernel buffer a page at a time,
+   so that the kernel never touches user memory, and so never
+   takes a page fault, while it holds the file system lock.
+   Reads from pipes copy straight out of the pipe. */
+static int
+sys_read (int handle, void *udst_, unsigned size)
+{
+  struct open_file *of = lookup_or_exit (handle);
+  uint8_t *udst = udst_;
+  uint8_t *buffer;
+  int bytes_read = 0;
+
+  switch (of->kind)
+    {
+    case FD_CONSOLE_IN:
+      for (; size > 0; size--, bytes_read++)
+        {
+          uint8_t c = input_getc ();
+          copy_out (udst++, &c, 1);
+        }
+      return bytes_read;
+
+    case FD_PIPE_READER:
+      return pipe_read (of->pipe, udst, size, of->nonblocking);
+
+    case FD_FILE:
+      break;
+
+    default:
+      return -1;
+    }
+
+  buffer = palloc_get_page (0);
+  if (buffer == NULL)
+    return -1;
+  while (size > 0)
+    {
+      size_t chunk = size < PGSIZE ? size : PGSIZE;
+      off_t retval;
+
+      lock_acquire (&filesys_lock);
+      retval = file_read (of->file, buffer, chunk);
+      lock_release (&filesys_lock);
+      if (retval <= 0)
+        break;
+      if (copy_to_user (udst, buffer, retval) != 0)
+        {
+          palloc_free_page (buffer);
+          sys_exit (-1);
+        }
+      bytes_read += retval;
+      if (retval != (off_t) chunk)
+        break;
+
+      udst += chunk;
+      size -= chunk;
+    }
+  palloc_free_page (buffer);
+  return bytes_read;
+}
+
+/* Write system call.
+
+   Writes to files and the console go through a kernel buffer a
+   page at a time, for the same reason as reads.  Writes to pipes
+   copy straight into the pipe. */
+static int
+sys_write (int handle, const void *usrc_, unsigned size)
+{
+  struct open_file *of = lookup_or_exit (handle);
+  const uint8_t *usrc = usrc_;
+  uint8_t *buffer;
+  int bytes_written = 0;
+
+  switch (of->kind)
+    {
+    case FD_PIPE_WRITER:
+      return pipe_write (of->pipe, usrc, size, of->nonblocking);
+
+    case FD_CONSOLE_OUT:
+    case FD_FILE:
+      break;
+
+    default:
+      return -1;
+    }
+
+  buffer = palloc_get_page (0);
+  if (buffer == NULL)
+    return -1;
+  while (size > 0)
+    {
+      size_t chunk = size < PGSIZE ? size : PGSIZE;
+      off_t retval;
+
+      if (copy_from_user (buffer, usrc, chunk) != 0)
+        {
+          palloc_free_page (buffer);
+          sys_exit (-1);
+        }
+      if (of->kind == FD_CONSOLE_OUT)
+        {
+          putbuf ((char *) buffer, chunk);
+          retval = chunk;
+        }
+      else
+        {
+          lock_acquire (&filesys_lock);
+          retval = file_write (of->file, buffer, chunk);
+          lock_release (&filesys_lock);
+        }
+      if (retval <= 0)
+        break;
+      bytes_written += retval;
+      if (retval != (off_t) chunk)
+        break;
+
+      usrc += chunk;
+      size -= chunk;
+    }
+  palloc_free_page (buffer);
+  return bytes_written;
+}
+
+/* Copies the IOVCNT-element vector UIOV from user memory into
+   *IOVP, a block on the heap, since it is too big for the kernel
+   stack.  The running thread holds the block until
+   release_iovec(), so that syscall_exit() frees it if the process
+   is killed in the meantime.  Returns the total length of its
+   buffers, or -1 if IOVCNT exceeds IOV_MAX, the total does not
+   fit in an int, or memory is not available.  Kills the process
+   if UIOV is not valid. */
+static int
+copy_in_iovec (struct iovec **iovp, const struct iovec *uiov,
+               unsigned iovcnt)
+{
+  struct thread *cur = thread_current ();
+  struct iovec *iov;
+  size_t total = 0;
+  unsigned i;
+
+  ASSERT (cur->held_iov == NULL);
+  *iovp = NULL;
+  if (iovcnt > IOV_MAX)
+    return -1;
+  if (iovcnt == 0)
+    return 0;
+  iov = malloc (iovcnt * sizeof *iov);
+  if (iov == NULL)
+    return -1;
+  cur->held_iov = *iovp = iov;
+  copy_in (iov, uiov, iovcnt * sizeof *iov);
+  for (i = 0; i < iovcnt; i++)
+    {
+      if (iov[i].iov_len > INT_MAX - total)
+        return -1;
+      total += iov[i].iov_len;
+    }
+  return total;
+}
+
+/* Frees the vector that copy_in_iovec() copied in for the running
+   system call, if any. */
+static void
+release_iovec (void)
+{
+  struct thread *cur = thread_current ();
+
+  free (cur->held_iov);
+  cur->held_iov = NULL;
+}
+
+/* Reads from OF, a pipe's read end, into the IOVCNT buffers in
+   IOV.  Blocks, unless OF is nonblocking, only until some data is
+   available, as for a single read. */
+static int
+readv_pipe (struct open_file *of, const struct iovec *iov, unsigned iovcnt)
+{
+  int bytes_read = 0;
+  unsigned i;
+
+  for (i = 0; i < iovcnt; i++)
+    {
+      bool nonblocking = of->nonblocking || bytes_read > 0;
+      int retval = pipe_read (of->pipe, iov[i].iov_base, iov[i].iov_len,
+                              nonblocking);
+      if (retval < 0)
+        return bytes_read > 0 ? bytes_read : -1;
+      bytes_read += retval;
+      if ((size_t) retval != iov[i].iov_len)
+        break;
+    }
+  return bytes_read;
+}
+
+/* Writes the IOVCNT buffers in IOV to OF, a pipe's write end. */
+static int
+writev_pipe (struct open_file *of, const struct iovec *iov, unsigned iovcnt)
+{
+  int bytes_written = 0;
+  unsigned i;
+
+  for (i = 0; i < iovcnt; i++)
+    {
+      int retval = pipe_write (of->pipe, iov[i].iov_base, iov[i].iov_len,
+                               of->nonblocking);
+      if (retval < 0)
+        return bytes_written > 0 ? bytes_written : -1;
+      bytes_written += retval;
+      if ((size_t) retval != iov[i].iov_len)
+        break;
+    }
+  return bytes_written;
+}
+
+/* Reads TOTAL bytes from OF, the console or a file, into the
+   buffers in IOV.
+
+   Like sys_read(), reads a file a page at a time through a kernel
+   buffer, and then scatters each page across as many of the
+   user's buffers as it spans, so that a vector of small buffers
+   costs one file system call per page rather than one per
+   buffer. */
+static int
+readv_buffered (struct open_file *of, const struct iovec *iov, int total)
+{
+  uint8_t *buffer;
+  int bytes_read = 0;
+  unsigned i = 0;
+  size_t ofs = 0;               /* Offset into iov[i]. */
+
+  buffer = palloc_get_page (0);
+  if (buffer == NULL)
+    return -1;
+  while (bytes_read < total)
+    {
+      size_t chunk = total - bytes_read < PGSIZE ? total - bytes_read : PGSIZE;
+      size_t pos;
+      off_t retval;
+
+      if (of->kind == FD_CONSOLE_IN)
+        {
+          for (pos = 0; pos < chunk; pos++)
+            buffer[pos] = input_getc ();
+          retval = chunk;
+        }
+      else
+        {
+          lock_acquire (&filesys_lock);
+          retval = file_read (of->file, buffer, chunk);
+          lock_release (&filesys_lock);
+        }
+      if (retval <= 0)
+        break;
+
+      /* Scatter. */
+      for (pos = 0; pos < (size_t) retval; )
+        {
+          size_t n = iov[i].iov_len - ofs;
+          if (n > retval - pos)
+            n = retval - pos;
+          if (copy_to_user ((uint8_t *) iov[i].iov_base + ofs,
+                            buffer + pos, n) != 0)
+            {
+              palloc_free_page (buffer);
+              sys_exit (-1);
+            }
+          pos += n;
+          ofs += n;
+          if (ofs == iov[i].iov_len)
+            {
+              i++;
+              ofs = 0;
+            }
+        }
+      bytes_read += retval;
+      if (retval != (off_t) chunk)
+        break;
+    }
+  palloc_free_page (buffer);
+  return bytes_read;
+}
+
+/* Readv system call. */
+static int
+sys_readv (int handle, const struct iovec *uiov, unsigned iovcnt)
+{
+  struct open_file *of = lookup_or_exit (handle);
+  struct iovec *iov;
+  int total = copy_in_iovec (&iov, uiov, iovcnt);
+  int bytes_read;
+
+  if (total < 0)
+    bytes_read = -1;
+  else if (of->kind == FD_PIPE_READER)
+    bytes_read = readv_pipe (of, iov, iovcnt);
+  else if (of->kind == FD_CONSOLE_IN || of->kind == FD_FILE)
+    bytes_read = readv_buffered (of, iov, total);
+  else
+    bytes_read = -1;
+  release_iovec ();
+  return bytes_read;
+}
+
+/* Writes TOTAL bytes from the buffers in IOV to OF, the console
+   or a file.
+
+   Gathers the user's buffers into a kernel page, and writes each
+   page with a single call to file_write() or, for the console, to
+   putbuf().  Thus a vector of small buffers, such as a line of
+   formatted output, reaches the console under a single
+   acquisition of the console lock. */
+static int
+writev_buffered (struct open_file *of, const struct iovec *iov, int total)
+{
+  uint8_t *buffer;
+  int bytes_written = 0;
+  unsigned i = 0;
+  size_t ofs = 0;               /* Offset into iov[i]. */
+
+  buffer = palloc_get_page (0);
+  if (buffer == NULL)
+    return -1;
+  while (bytes_written < total)
+    {
+      size_t chunk = (total - bytes_written < PGSIZE
+                      ? total - bytes_written : PGSIZE);
+      size_t pos;
+      off_t retval;
+
+      /* Gather. */
+      for (pos = 0; pos < chunk; )
+        {
+          size_t n = iov[i].iov_len - ofs;
+          if (n > chunk - pos)
+            n = chunk - pos;
+          if (copy_from_user (buffer + pos,
+                              (const uint8_t *) iov[i].iov_base + ofs,
+                              n) != 0)
+            {
+              palloc_free_page (buffer);
+              sys_exit (-1);
+            }
+          pos += n;
+          ofs += n;
+          if (ofs == iov[i].iov_len)
+            {
+              i++;
+              ofs = 0;
+            }
+        }
+
+      if (of->kind == FD_CONSOLE_OUT)
+        {
+          putbuf ((char *) buffer, chunk);
+          retval = chunk;
+        }
+      else
+        {
+          lock_acquire (&filesys_lock);
+          retval = file_write (of->file, buffer, chunk);
+          lock_release (&filesys_lock);
+        }
+      if (retval <= 0)
+        break;
+      bytes_written += retval;
+      if (retval != (off_t) chunk)
+        break;
+    }
+  palloc_free_page (buffer);
+  return bytes_written;
+}
+
+/* Writev system call. */
+static int
+sys_writev (int handle, const struct iovec *uiov, unsigned iovcnt)
+{
+  struct open_file *of = lookup_or_exit (handle);
+  struct iovec *iov;
+  int total = copy_in_iovec (&iov, uiov, iovcnt);
+  int bytes_written;
+
+  if (total < 0)
+    bytes_written = -1;
+  else if (of->kind == FD_PIPE_WRITER)
+    bytes_written = writev_pipe (of, iov, iovcnt);
+  else if (of->kind == FD_CONSOLE_OUT || of->kind == FD_FILE)
+    bytes_written = writev_buffered (of, iov, total);
+  else
+    bytes_written = -1;
+  release_iovec ();
+  return bytes_written;
+}
+
+/* Seek system call. */
+static int
+sys_seek (int handle, unsigned position)
+{
+  struct file *file = lookup_file_or_exit (handle);
+
+  lock_acquire (&filesys_lock);
+  if ((off_t) position >= 0)
+    file_seek (file, position);
+  lock_release (&filesys_lock);
+  return 0;
+}
+
+/* Tell system call. */
+static int
+sys_tell (int handle)
+{
+  struct file *file = lookup_file_or_exit (handle);
+  unsigned position;
+
+  lock_acquire (&filesys_lock);
+  position = file_tell (file);
+  lock_release (&filesys_lock);
+  return position;
+}
+
+/* Close system call. */
+static int
+sys_close (int handle)
+{
+  if (!fdtable_close (thread_current ()->fds, handle))
+    sys_exit (-1);
+  return 0;
+}
+
+#ifdef VM
+/* Binds a mapping id to a region of memory and a file. */
+struct mapping
+  {
+    struct list_elem elem;      /* List element. */
+    int handle;                 /* Mapping id. */
+    struct file *file;          /* File. */
+    uint8_t *base;              /* Start of memory mapping. */
+    size_t page_cnt;            /* Number of pages mapped. */
+  };
+
+/* Returns the file mapping associated with the given handle, or
+   a null pointer if there is none.  The page table must be
+   locked. */
+static struct mapping *
+lookup_mapping (int handle)
+{
+  struct thread *leader = thread_current ()->leader;
+  struct list_elem *e;
+
+  for (e = list_begin (&leader->mappings); e != list_end (&leader->mappings);
+       e = list_next (e))
+    {
+      struct mapping *m = list_entry (e, struct mapping, elem);
+      if (m->handle == handle)
+        return m;
+    }
+  return NULL;
+}
+
+/* Removes mapping M from the virtual address space, writing back
+   any pages that have changed.  The page table must be locked. */
+static void
+unmap (struct mapping *m)
+{
+  size_t i;
+
+  for (i = 0; i < m->page_cnt; i++)
+    page_remove (m->base + i * PGSIZE);
+
+  lock_acquire (&filesys_lock);
+  file_close (m->file);
+  lock_release (&filesys_lock);
+  list_remove (&m->elem);
+  free (m);
+}
+#endif /* VM */
+
+/* Mmap system call.
+
+   The pages of the mapping are brought in from the file on
+   demand and share frames with every other mapping of the same
+   part of the file, in this process or any other. */
+static int
+sys_mmap (int handle UNUSED, void *addr UNUSED)
+{
+#ifdef VM
+  struct thread *leader = thread_current ()->leader;
+  struct file *file = lookup_file (handle);
+  struct mapping *m;
+  off_t length;
+  off_t ofs;
+
+  if (file == NULL || addr == NULL || pg_ofs (addr) != 0)
+    return -1;
+
+  m = malloc (sizeof *m);
+  if (m == NULL)
+    return -1;
+
+  /* Map our own file, so that closing HANDLE does not affect the
+     mapping. */
+  lock_acquire (&filesys_lock);
+  m->file = file_reopen (file);
+  length = m->file != NULL ? file_length (m->file) : 0;
+  lock_release (&filesys_lock);
+  if (length == 0)
+    {
+      lock_acquire (&filesys_lock);
+      file_close (m->file);
+      lock_release (&filesys_lock);
+      free (m);
+      return -1;
+    }
+
+  page_table_lock ();
+  m->handle = leader->next_mapping++;
+  m->base = addr;
+  m->page_cnt = 0;
+  list_push_front (&leader->mappings, &m->elem);
+
+  for (ofs = 0; ofs < length; ofs += PGSIZE)
+    {
+      uint8_t *upage = m->base + ofs;
+      size_t bytes = length - ofs < PGSIZE ? length - ofs : PGSIZE;
+
+      if (upage < m->base || !is_user_vaddr (upage) || page_is_stack (upage)
+          || !page_add_mmap (upage, m->file, ofs, bytes))
+        {
+          unmap (m);
+          page_table_unlock ();
+          return -1;
+        }
+      m->page_cnt++;
+    }
+  page_table_unlock ();
+  return m->handle;
+#else
+  return -1;
+#endif
+}
+
+/* Munmap system call. */
+static int
+sys_munmap (int mapping UNUSED)
+{
+#ifdef VM
+  struct mapping *m;
+
+  page_table_lock ();
+  m = lookup_mapping (mapping);
+  if (m != NULL)
+    unmap (m);
+  page_table_unlock ();
+  if (m == NULL)
+    sys_exit (-1);
+#endif
+  return 0;
+}
+
+/* Shm_create system call. */
+static int
+sys_shm_create (unsigned page_cnt UNUSED)
+{
+#ifdef VM
+  return shm_create (page_cnt);
+#else
+  return -1;
+#endif
+}
+
+/* Shm_attach system call.  Returns the address of the mapping,
+   or 0 on failure. */
+static int
+sys_shm_attach (int id UNUSED, void *addr UNUSED)
+{
+#ifdef VM
+  return (int) shm_attach (id, addr);
+#else
+  return 0;
+#endif
+}
+
+/* Shm_detach system call. */
+static int
+sys_shm_detach (void *addr UNUSED)
+{
+#ifdef VM
+  return shm_detach (addr);
+#else
+  return false;
+#endif
+}
+
+/* Futex_wait system call. */
+static int
+sys_futex_wait (int *uaddr, int expected)
+{
+  return futex_wait (uaddr, expected);
+}
+
+/* Futex_wake system call. */
+static int
+sys_futex_wake (int *uaddr, unsigned cnt)
+{
+  return futex_wake (uaddr, cnt);
+}
+
+/* Batch system call.  Makes the CNT system calls described in
+   the array UENTRIES, in order, in a single entry to the kernel,
+   and stores the return value of each in its entry.  Returns the
+   number of calls made, which is less than CNT only if FLAGS
+   includes BATCH_STOP_ON_ERROR and a call failed.  An entry with
+   an invalid system call number, including a nested batch, fails
+   with result -1. */
+static int
+sys_batch (struct syscall_batch_entry *uentries, unsigned cnt,
+           unsigned flags)
+{
+  unsigned i;
+
+  for (i = 0; i < cnt; i++)
+    {
+      uint64_t start = cpu_cycles ();
+      struct syscall_batch_entry e;
+      bool failed;
+
+      copy_in (&e, &uentries[i], sizeof e);
+      if (e.number >= 0 && (unsigned) e.number < SYSCALL_CNT
+          && e.number != SYS_BATCH)
+        {
+          const struct syscall *sc = &syscall_table[e.number];
+          e.result = sc->func (e.args[0], e.args[1], e.args[2]);
+          release_file ();
+          failed = ((sc->failure == FAIL_NEGATIVE && e.result < 0)
+                    || (sc->failure == FAIL_FALSE && e.result == 0));
+          count_call (ENTRY_BATCH, e.number, start);
+        }
+      else
+        {
+          e.result = -1;
+          failed = true;
+        }
+      copy_out (&uentries[i].result, &e.result, sizeof e.result);
+
+      if (failed && (flags & BATCH_STOP_ON_ERROR))
+        return i + 1;
+    }
+  return cnt;
+}
+
+/* Thread_create system call. */
+static int
+sys_thread_create (void (*entry) (void), void *func, void *arg)
+{
+  return process_thread_create (entry, func, arg);
+}
+
+/* Thread_join system call. */
+static int
+sys_thread_join (tid_t tid)
+{
+  return process_thread_join (tid);
+}
+
+/* Thread_exit system call.  Ends the running thread, but not its
+   process, even in the process's first thread. */
+static void
+sys_thread_exit (void)
+{
+  thread_current ()->quiet_exit = true;
+  thread_exit ();
+}
+
+/* Aio_setup system call. */
+static int
+sys_aio_setup (struct aio_ring *uring)
+{
+  return aio_setup (uring);
+}
+
+/* Aio_enter system call. */
+static int
+sys_aio_enter (unsigned to_submit, unsigned min_complete)
+{
+  return aio_enter (to_submit, min_complete);
+}
+
+/* The file system has only a root directory, so the directory
+   system calls below validate their arguments and then fail. */
+
+/* Chdir system call. */
+static int
+sys_chdir (const char *udir)
+{
+  char *kdir = copy_in_string (udir);
+
+  if (kdir != NULL)
+    palloc_free_page (kdir);
+  return false;
+}
+
+/* Mkdir system call. */
+static int
+sys_mkdir (const char *udir)
+{
+  char *kdir = copy_in_string (udir);
+
+  if (kdir != NULL)
+    palloc_free_page (kdir);
+  return false;
+}
+
+/* Readdir system call. */
+static int
+sys_readdir (int handle, char *uname UNUSED)
+{
+  lookup_file_or_exit (handle);
+  return false;
+}
+
+/* Isdir system call. */
+static int
+sys_isdir (int handle)
+{
+  lookup_file_or_exit (handle);
+  return false;
+}
+
+/* Inumber system call. */
+static int
+sys_inumber (int handle)
+{
+  struct file *file = lookup_file_or_exit (handle);
+  return inode_get_inumber (file_get_inode (file));
+}
+
+/* On thread exit, releases the object and vector in use by the
+   system call that the running thread was killed in, if any, and
+   its asynchronous I/O state.  On exit of a process's leader, which
+   is the last of its threads to exit, also closes all of the
+   process's open files and removes all of its memory mappings. */
+void
+syscall_exit (void)
+{
+  struct thread *cur = thread_current ();
+
+  release_file ();
+  release_iovec ();
+  aio_exit ();
+  if (cur->leader != cur)
+    {
+      cur->fds = NULL;
+      return;
+    }
+
+#ifdef VM
+  while (!list_empty (&cur->mappings))
+    unmap (list_entry (list_front (&cur->mappings), struct mapping, elem));
+  shm_exit ();
+#endif
+
+  fdtable_destroy (cur->fds);
+  cur->fds = NULL;
+}
@@ -1,6 +1,16 @@
 #ifndef USERPROG_SYSCALL_H
 #define USERPROG_SYSCALL_H
 
+#include <stdbool.h>
+
+/* Do user programs enter the kernel with SYSENTER? */
+extern bool syscall_sysenter;
+
+/* Entry point for SYSENTER, in userprog/sysenter.S. */
+void sysenter_entry (void);
+
 void syscall_init (void);
+void syscall_exit (void);
+void syscall_print_stats (void);
 
 #endif /* userprog/syscall.h */
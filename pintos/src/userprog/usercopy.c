@@ -0,0 +1,139 @@
+#include "userprog/usercopy.h"
+#include <stdint.h>
+#include <string.h>
+#include "threads/interrupt.h"
+#include "threads/vaddr.h"
+
+/* Copying to and from user memory.
+
+   The kernel does not check, page by page, that the user memory
+   it is about to touch is mapped.  It only checks that the memory
+   lies below PHYS_BASE, and then copies.  A page that is part of
+   the process's address space but not yet in memory faults, and
+   the page fault handler brings it in as it would for the process
+   itself.  If the copy touches a page that the process has not
+   mapped at all, or writes a read-only page, the page fault
+   handler calls usercopy_fixup(), which finds the faulting
+   instruction in the exception table and resumes execution at the
+   "fixup" address that goes with it.  The copy then returns
+   early, reporting the failure to its caller.
+
+   The exception table is the "__ex_table" section, which the
+   linker gathers between __start_ex_table and __stop_ex_table
+   (see threads/kernel.lds.S).  Each entry is the address of an
+   instruction that may fault on user memory, followed by its
+   fixup address. */
+
+/* An exception table entry. */
+struct ex_entry
+  {
+    uintptr_t insn;             /* Instruction that may fault. */
+    uintptr_t fixup;            /* Where to resume if it does. */
+  };
+
+extern const struct ex_entry __start_ex_table[], __stop_ex_table[];
+
+/* Emits an exception table entry for the instruction at assembly
+   label INSN, to resume at label FIXUP. */
+#define EX_TABLE(INSN, FIXUP)                   \
+        ".pushsection __ex_table, \"a\"\n"      \
+        ".long " INSN ", " FIXUP "\n"           \
+        ".popsection\n"
+
+/* Returns true if the SIZE bytes starting at UADDR all lie in
+   user virtual memory. */
+static bool
+is_user_range (const void *uaddr, size_t size)
+{
+  uintptr_t start = (uintptr_t) uaddr;
+  return start + size >= start && start + size <= (uintptr_t) PHYS_BASE;
+}
+
+/* Copies SIZE bytes from SRC to DST, either of which may be user
+   memory that has been checked with is_user_range().  Returns the
+   number of bytes not copied, which is nonzero only if the copy
+   faulted. */
+static size_t
+user_memcpy (void *dst, const void *src, size_t size)
+{
+  int d0, d1;
+
+  /* On a fault, ECX still holds the number of bytes left. */
+  asm volatile ("1: rep movsb\n"
+                "2:\n"
+                EX_TABLE ("1b", "2b")
+                : "+c" (size), "=&D" (d0), "=&S" (d1)
+                : "1" (dst), "2" (src)
+                : "memory");
+  return size;
+}
+
+/* Copies SIZE bytes from user address USRC to kernel address
+   DST.  Returns the number of bytes that could not be copied,
+   which is 0 if successful. */
+size_t
+copy_from_user (void *dst, const void *usrc, size_t size)
+{
+  if (!is_user_range (usrc, size))
+    return size;
+  return user_memcpy (dst, usrc, size);
+}
+
+/* Copies SIZE bytes from kernel address SRC to user address
+   UDST.  Returns the number of bytes that could not be copied,
+   which is 0 if successful. */
+size_t
+copy_to_user (void *udst, const void *src, size_t size)
+{
+  if (!is_user_range (udst, size))
+    return size;
+  return user_memcpy (udst, src, size);
+}
+
+/* Copies the null-terminated string at user address USRC,
+   including the null terminator, into DST, which has room for
+   SIZE bytes.  Returns the length of the string, not counting the
+   null terminator.  If the string is SIZE bytes or longer,
+   copies only SIZE bytes, which are not null-terminated, and
+   returns SIZE.  Returns -1 if USRC is not a valid string. */
+int
+strncpy_from_user (char *dst, const char *usrc, size_t size)
+{
+  size_t copied = 0;
+
+  /* Copy a page at a time, so that we never touch the page after
+     the one that holds the null terminator. */
+  while (copied < size)
+    {
+      const char *us = usrc + copied;
+      size_t chunk = PGSIZE - pg_ofs (us);
+      char *nul;
+
+      if (chunk > size - copied)
+        chunk = size - copied;
+      if (copy_from_user (dst + copied, us, chunk) != 0)
+        return -1;
+      nul = memchr (dst + copied, '\0', chunk);
+      if (nul != NULL)
+        return nul - dst;
+      copied += chunk;
+    }
+  return size;
+}
+
+/* If the instruction at which F faulted is in the exception
+   table, arranges for F to resume at its fixup address and
+   returns true.  Otherwise, returns false. */
+bool
+usercopy_fixup (struct intr_frame *f)
+{
+  const struct ex_entry *e;
+
+  for (e = __start_ex_table; e < __stop_ex_table; e++)
+    if (e->insn == (uintptr_t) f->eip)
+      {
+        f->eip = (void (*) (void)) e->fixup;
+        return true;
+      }
+  return false;
+}
@@ -0,0 +1,516 @@
+#include "vm/frame.h"
+#include <debug.h>
+#include <stdio.h>
+#include "vm/page.h"
+#include "vm/swap.h"
+#include "vm/ws.h"
+#include "threads/loader.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/thread.h"
+#include "userprog/process.h"
+
+/* Frame table.
+
+   At boot, frame_init() takes every page in palloc's user pool
+   and makes it a frame, so that from then on all user memory is
+   handed out here instead of by palloc_get_page(PAL_USER).  When
+   no frame is free, frame_alloc_and_lock() picks a victim with
+   the "second chance" clock algorithm: the clock hand sweeps the
+   frames in order, clearing each page's accessed bit as it
+   passes, and evicts the first page whose accessed bit was
+   already clear.  Eviction works in batches: the sweep goes on
+   collecting unreferenced pages, up to SWAP_CLUSTER of them, so
+   that the ones that must go to swap can be written out by a
+   single transfer, and the frames that are not needed right away
+   are left free for the next allocations.
+
+   A process that has exited keeps its frames until the reaper
+   tears down its address space (see userprog/process.c).  The
+   sweep does not evict such frames but simply takes them back,
+   since no one will read their data again, and running short of
+   frames hurries the reaper along.
+
+   Each frame has a lock.  Holding it pins the frame: the pages in
+   it cannot be evicted and the frame cannot be reassigned.  A
+   page is only loaded, evicted, or freed while its frame is
+   locked.
+
+   Shared frames are also entered in SHARED_FRAMES.  A thread may
+   acquire share_lock while it holds a frame's lock, but never the
+   other way around, so a thread that finds a frame in the table
+   must drop share_lock before locking the frame and then check
+   that the frame still holds the data it was looking for.  That
+   is safe because frames are never freed, only reused. */
+
+static struct frame *frames;    /* All the frames. */
+static size_t frame_cnt;        /* Number of frames. */
+
+static struct lock scan_lock;   /* Serializes frame allocation. */
+static size_t hand;             /* Clock hand, an index into FRAMES. */
+static unsigned long long discard_cnt;  /* Frames taken back from exited
+                                           processes, protected by
+                                           scan_lock. */
+
+static struct hash shared_frames;       /* Shared frames. */
+static struct lock share_lock;          /* Protects shared_frames. */
+
+/* Statistics, protected by share_lock. */
+static unsigned long long share_hit_cnt;  /* Pages mapped to a shared
+                                             frame already in memory. */
+static unsigned long long share_miss_cnt; /* Shared frames read in. */
+
+static hash_hash_func frame_hash;
+static hash_less_func frame_less;
+static bool only_exited (struct frame *);
+static void unshare (struct frame *);
+
+/* Number of times frame_alloc_and_lock() sweeps the frame table
+   looking for a victim before giving up. */
+#define ALLOC_TRIES 3
+
+/* Initializes the frame table. */
+void
+frame_init (void)
+{
+  void *base;
+
+  lock_init (&scan_lock);
+  lock_init (&share_lock);
+  if (!hash_init (&shared_frames, frame_hash, frame_less, NULL))
+    PANIC ("out of memory allocating shared frame table");
+
+  frames = malloc (sizeof *frames * init_ram_pages);
+  if (frames == NULL)
+    PANIC ("out of memory allocating page frames");
+
+  while ((base = palloc_get_page (PAL_USER)) != NULL)
+    {
+      struct frame *f = &frames[frame_cnt++];
+      lock_init (&f->lock);
+      f->base = base;
+      list_init (&f->pages);
+      f->object = NULL;
+      f->dirty = false;
+    }
+}
+
+/* Finds a free frame, assigns it to PAGE, and returns it locked.
+   Returns a null pointer if no frame is free.  scan_lock must be
+   held. */
+static struct frame *
+find_free_frame (struct page *page)
+{
+  size_t i;
+
+  ASSERT (lock_held_by_current_thread (&scan_lock));
+
+  for (i = 0; i < frame_cnt; i++)
+    {
+      struct frame *f = &frames[i];
+      if (!lock_try_acquire (&f->lock))
+        continue;
+      if (list_empty (&f->pages))
+        {
+          list_push_back (&f->pages, &page->frame_elem);
+          f->dirty = false;
+          return f;
+        }
+      lock_release (&f->lock);
+    }
+  return NULL;
+}
+
+/* Tries to allocate and lock a frame for PAGE, evicting other
+   pages if necessary.  Returns the frame if successful, or a null
+   pointer if every frame is pinned or no victim could be written
+   out. */
+static struct frame *
+try_frame_alloc_and_lock (struct page *page)
+{
+  struct frame *victims[SWAP_CLUSTER];
+  size_t victim_cnt = 0;
+  size_t evicted;
+  size_t i;
+
+  lock_acquire (&scan_lock);
+
+  victims[0] = find_free_frame (page);
+  if (victims[0] != NULL)
+    {
+      lock_release (&scan_lock);
+      return victims[0];
+    }
+
+  /* No free frame.  Have the reaper free the frames of processes
+     that have exited as soon as it can. */
+  process_reap_urgently ();
+
+  /* Collect frames to evict.  The first sweep
+     also passes over frames that vm/ws.c protects, those in the
+     working set of a process within its allotment of frames.  If
+     it finds nothing, a second sweep takes any unreferenced page.
+     Two sweeps suffice unless every frame is pinned, because the
+     first sweep clears every accessed bit. */
+  for (i = 0; i < frame_cnt * 2 && victim_cnt < SWAP_CLUSTER; i++)
+    {
+      struct frame *f = &frames[hand];
+
+      if (i == frame_cnt && victim_cnt > 0)
+        break;
+      if (++hand >= frame_cnt)
+        hand = 0;
+
+      if (!lock_try_acquire (&f->lock))
+        continue;
+
+      /* Take back a frame that only processes that have exited
+         still map, without writing anything out. */
+      if (!list_empty (&f->pages) && only_exited (f) && page_discard (f))
+        {
+          if (f->object != NULL)
+            unshare (f);
+          discard_cnt++;
+        }
+
+      if (list_empty (&f->pages))
+        {
+          /* Freed since we looked, or just taken back.  If we have
+             no victims yet, there is nothing to evict after all. */
+          if (victim_cnt == 0)
+            {
+              list_push_back (&f->pages, &page->frame_elem);
+              f->dirty = false;
+              lock_release (&scan_lock);
+              return f;
+            }
+          lock_release (&f->lock);
+          continue;
+        }
+
+      if (page_accessed_recently (f) || (i < frame_cnt && ws_protects (f)))
+        {
+          lock_release (&f->lock);
+          continue;
+        }
+
+      victims[victim_cnt++] = f;
+    }
+  lock_release (&scan_lock);
+
+  /* Evict the victims' pages.  Writing them out may take a while,
+     so we do it without scan_lock, letting other threads find the
+     frames that are already free. */
+  evicted = victim_cnt > 0 ? page_out (victims, victim_cnt) : 0;
+  for (i = evicted; i < victim_cnt; i++)
+    lock_release (&victims[i]->lock);
+  if (evicted == 0)
+    return NULL;
+
+  /* Keep the first frame and free the rest. */
+  for (i = 0; i < evicted; i++)
+    {
+      struct frame *f = victims[i];
+      ASSERT (list_empty (&f->pages));
+      if (f->object != NULL)
+        unshare (f);
+      if (i > 0)
+        lock_release (&f->lock);
+    }
+  list_push_back (&victims[0]->pages, &page->frame_elem);
+  return victims[0];
+}
+
+/* Allocates a frame for PAGE and returns it locked, or returns a
+   null pointer if no frame can be allocated. */
+struct frame *
+frame_alloc_and_lock (struct page *page)
+{
+  int try;
+
+  for (try = 0; try < ALLOC_TRIES; try++)
+    {
+      struct frame *f = try_frame_alloc_and_lock (page);
+      if (f != NULL)
+        {
+          ASSERT (lock_held_by_current_thread (&f->lock));
+          return f;
+        }
+
+      /* Every frame was pinned.  Give their owners a chance to
+         finish with them. */
+      thread_yield ();
+    }
+  return NULL;
+}
+
+/* Allocates a free frame for PAGE and returns it locked, without
+   evicting any page.  Returns a null pointer if no frame is
+   free. */
+struct frame *
+frame_try_alloc_and_lock (struct page *page)
+{
+  struct frame *f;
+
+  lock_acquire (&scan_lock);
+  f = find_free_frame (page);
+  lock_release (&scan_lock);
+  return f;
+}
+
+/* Locks P's frame into memory, if it has one.
+   Upon return, p->frame will not change until P is unlocked. */
+void
+frame_lock (struct page *p)
+{
+  /* A frame can be asynchronously removed, but only the page's
+     owner inserts one. */
+  struct frame *f = p->frame;
+  if (f != NULL)
+    {
+      lock_acquire (&f->lock);
+      if (f != p->frame)
+        {
+          lock_release (&f->lock);
+          ASSERT (p->frame == NULL);
+        }
+    }
+}
+
+/* Removes page P from its frame, which must be locked by the
+   current thread, and unlocks the frame.  If no other page is
+   mapped to the frame, the frame becomes free. */
+void
+frame_detach (struct page *p)
+{
+  struct frame *f = p->frame;
+
+  ASSERT (lock_held_by_current_thread (&f->lock));
+
+  list_remove (&p->frame_elem);
+  p->frame = NULL;
+  if (list_empty (&f->pages) && f->object != NULL)
+    unshare (f);
+  lock_release (&f->lock);
+}
+
+/* Unlocks frame F, allowing it to be evicted.
+   F must be locked for use by the current thread. */
+void
+frame_unlock (struct frame *f)
+{
+  ASSERT (lock_held_by_current_thread (&f->lock));
+  lock_release (&f->lock);
+}
+
+/* Initializes the shared frame table key in F from page P. */
+static void
+set_key (struct frame *f, const struct page *p)
+{
+  f->object = page_shared_object (p);
+  f->ofs = p->file_ofs;
+  f->bytes = p->file_bytes;
+  f->writeback = p->writeback;
+}
+
+/* Returns true if frames A and B have the same shared frame
+   table key. */
+static bool
+same_key (const struct frame *a, const struct frame *b)
+{
+  return (a->object == b->object && a->ofs == b->ofs && a->bytes == b->bytes
+          && a->writeback == b->writeback);
+}
+
+/* Returns true if every page mapped to frame F, which must be
+   locked by the current thread, belongs to a process that has
+   exited. */
+static bool
+only_exited (struct frame *f)
+{
+  struct list_elem *e;
+
+  for (e = list_begin (&f->pages); e != list_end (&f->pages);
+       e = list_next (e))
+    {
+      struct page *p = list_entry (e, struct page, frame_elem);
+      if (!p->thread->exited)
+        return false;
+    }
+  return true;
+}
+
+/* Looks for the shared frame that holds the data of page P.  If
+   there is one, maps P to it and returns it locked.  Otherwise,
+   returns a null pointer. */
+struct frame *
+frame_find_shared (struct page *p)
+{
+  struct frame key;
+
+  ASSERT (p->shared);
+
+  set_key (&key, p);
+  for (;;)
+    {
+      struct hash_elem *e;
+      struct frame *f;
+
+      lock_acquire (&share_lock);
+      e = hash_find (&shared_frames, &key.hash_elem);
+      lock_release (&share_lock);
+      if (e == NULL)
+        return NULL;
+
+      f = hash_entry (e, struct frame, hash_elem);
+      lock_acquire (&f->lock);
+      if (same_key (f, &key) && only_exited (f))
+        {
+          /* Only processes that have exited, whose pages the
+             reaper has yet to free, still map F.  Their
+             executable may have been written since, so F's data
+             cannot be trusted: load the page afresh. */
+          unshare (f);
+          lock_release (&f->lock);
+          continue;
+        }
+      if (same_key (f, &key))
+        {
+          list_push_back (&f->pages, &p->frame_elem);
+          lock_acquire (&share_lock);
+          share_hit_cnt++;
+          lock_release (&share_lock);
+          return f;
+        }
+
+      /* The frame was evicted or freed while we waited. */
+      lock_release (&f->lock);
+    }
+}
+
+/* Enters frame F, which must be locked by the current thread and
+   have only a single page mapped to it, into the shared frame
+   table under that page's key.  The caller should then fill in
+   F's data before unlocking it; until then, threads that look for
+   the same data wait for F's lock.  Returns false, without
+   changing anything, if another frame already holds the same
+   data. */
+bool
+frame_share (struct frame *f)
+{
+  struct page *p;
+  bool success;
+
+  ASSERT (lock_held_by_current_thread (&f->lock));
+  ASSERT (list_size (&f->pages) == 1);
+  ASSERT (f->object == NULL);
+
+  p = list_entry (list_front (&f->pages), struct page, frame_elem);
+  ASSERT (p->shared);
+
+  set_key (f, p);
+  f->dirty = false;
+  lock_acquire (&share_lock);
+  success = hash_insert (&shared_frames, &f->hash_elem) == NULL;
+  if (success)
+    share_miss_cnt++;
+  lock_release (&share_lock);
+  if (!success)
+    f->object = NULL;
+  return success;
+}
+
+/* Removes F, which must be locked by the current thread, from the
+   shared frame table. */
+static void
+unshare (struct frame *f)
+{
+  ASSERT (lock_held_by_current_thread (&f->lock));
+  ASSERT (f->object != NULL);
+
+  lock_acquire (&share_lock);
+  hash_delete (&shared_frames, &f->hash_elem);
+  lock_release (&share_lock);
+  f->object = NULL;
+  f->dirty = false;
+}
+
+/* Returns a hash value for the shared frame that E refers to. */
+static unsigned
+frame_hash (const struct hash_elem *e, void *aux UNUSED)
+{
+  const struct frame *f = hash_entry (e, struct frame, hash_elem);
+  return (hash_bytes (&f->object, sizeof f->object)
+          ^ hash_int (f->ofs) ^ hash_int (f->bytes) ^ f->writeback);
+}
+
+/* Returns true if shared frame A precedes shared frame B. */
+static bool
+frame_less (const struct hash_elem *a_, const struct hash_elem *b_,
+            void *aux UNUSED)
+{
+  const struct frame *a = hash_entry (a_, struct frame, hash_elem);
+  const struct frame *b = hash_entry (b_, struct frame, hash_elem);
+
+  if (a->object != b->object)
+    return a->object < b->object;
+  else if (a->ofs != b->ofs)
+    return a->ofs < b->ofs;
+  else if (a->bytes != b->bytes)
+    return a->bytes < b->bytes;
+  else
+    return a->writeback < b->writeback;
+}
+
+/* Returns the number of frames. */
+size_t
+frame_table_size (void)
+{
+  return frame_cnt;
+}
+
+/* Calls FUNC for each frame that holds at least one page, with
+   the frame locked, passing AUX along.  Skips frames that other
+   threads have locked. */
+void
+frame_for_each (frame_action_func *func, void *aux)
+{
+  size_t i;
+
+  for (i = 0; i < frame_cnt; i++)
+    {
+      struct frame *f = &frames[i];
+      if (!lock_try_acquire (&f->lock))
+        continue;
+      if (!list_empty (&f->pages))
+        func (f, aux);
+      lock_release (&f->lock);
+    }
+}
+
+/* Prints frame statistics. */
+void
+frame_print_stats (void)
+{
+  size_t used_cnt = 0;
+  size_t shared_cnt = 0;
+  size_t mapped_cnt = 0;
+  size_t i;
+
+  for (i = 0; i < frame_cnt; i++)
+    {
+      struct frame *f = &frames[i];
+      if (!list_empty (&f->pages))
+        {
+          used_cnt++;
+          mapped_cnt += list_size (&f->pages);
+          if (f->object != NULL)
+            shared_cnt++;
+        }
+    }
+  printf ("Frames: %zu of %zu in use (%zu shared) by %zu pages, "
+          "%llu shared frames read, %llu shared mappings reused, "
+          "%llu taken back from exited processes\n",
+          used_cnt, frame_cnt, shared_cnt, mapped_cnt,
+          share_miss_cnt, share_hit_cnt, discard_cnt);
+}
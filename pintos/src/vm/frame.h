@@ -0,0 +1,54 @@
+#ifndef VM_FRAME_H
+#define VM_FRAME_H
+
+#include <hash.h>
+#include <list.h>
+#include <stdbool.h>
+#include "filesys/off_t.h"
+#include "threads/synch.h"
+
+struct page;
+
+/* A physical frame of user memory.
+
+   A frame holds the contents of one or more pages.  A private
+   page has a frame of its own.  A frame that holds data that may
+   be mapped by several processes at once (a "shared" frame) is
+   entered in a table keyed by the object that holds the data,
+   which is a file's inode or a shared memory segment, the offset
+   of the data in it, and the number of bytes of data, and every
+   page with the same key maps that frame. */
+struct frame
+  {
+    struct lock lock;           /* Prevents simultaneous access. */
+    void *base;                 /* Kernel virtual base address. */
+    struct list pages;          /* Pages mapped to frame; empty if free. */
+    bool dirty;                 /* Modified via a mapping now gone? */
+
+    /* Shared frames only. */
+    struct hash_elem hash_elem; /* Element in shared frame table. */
+    const void *object;         /* Inode or shared memory segment,
+                                   or null if private. */
+    off_t ofs;                  /* Offset of data in OBJECT. */
+    size_t bytes;               /* Bytes of file data; the rest is zero. */
+    bool writeback;             /* Data of write-back (mmap) pages? */
+  };
+
+void frame_init (void);
+
+struct frame *frame_alloc_and_lock (struct page *);
+struct frame *frame_try_alloc_and_lock (struct page *);
+void frame_lock (struct page *);
+void frame_detach (struct page *);
+void frame_unlock (struct frame *);
+
+struct frame *frame_find_shared (struct page *);
+bool frame_share (struct frame *);
+
+size_t frame_table_size (void);
+typedef void frame_action_func (struct frame *, void *aux);
+void frame_for_each (frame_action_func *, void *aux);
+
+void frame_print_stats (void);
+
+#endif /* vm/frame.h */
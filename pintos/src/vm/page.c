@@ -0,0 +1,800 @@
+#include "vm/page.h"
+#include <debug.h>
+#include <string.h>
+#include "filesys/file.h"
+#include "filesys/filesys.h"
+#include "threads/malloc.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "userprog/pagedir.h"
+#include "vm/frame.h"
+#include "vm/shm.h"
+#include "vm/swap.h"
+#include "vm/ws.h"
+#include "vm/zstore.h"
+
+/* Supplemental page table.
+
+   Each user process has a hash table of `struct page's, keyed by
+   user virtual address, in its `struct thread'.  When a process
+   is loaded, load() records each page of each program segment
+   here instead of reading it in.  The first access to such a
+   page faults, and page_fault() calls page_resolve_fault() to
+   bring the page into a frame and map it.
+
+   A page can later be evicted from its frame by any thread that
+   needs a frame (see vm/frame.c).  Clean pages read from a file
+   are simply dropped and read again on the next fault, dirty
+   pages of memory-mapped files are written back to the file,
+   dirty pages of shared memory segments are saved in the
+   segment, and all other pages are compressed into the store in
+   vm/zstore.c or, failing that, written to swap.
+
+   The stack starts out as a single page.  A fault on a missing
+   page in the region reserved for the stack, the top
+   page_stack_max bytes of user space, extends the stack if the
+   faulting access is plausibly a push (see page_grow_stack()).
+
+   The hash table is kept in the process's leader thread and is
+   shared by all of the process's threads, any of which may fault
+   or add or remove pages at any time.  The leader's page_lock
+   protects it.  A thread holds that lock for the whole of
+   resolving a fault, so the lock comes before the frame locks and
+   the file system lock.  The frame and swap state of each page is
+   protected by the lock on the page's frame. */
+
+static hash_hash_func page_hash;
+static hash_less_func page_less;
+static hash_action_func page_free;
+static void page_destroy (struct page *);
+static struct page *page_add (void *upage, bool writable);
+
+/* Maximum size of a user stack, in bytes.  Set by the -stk kernel
+   command line option. */
+size_t page_stack_max = 1024 * 1024;
+
+/* Most stack pages added by a single fault. */
+#define STACK_AHEAD_MAX 16
+
+/* Initializes the running process's supplemental page table.
+   Panics if memory is not available. */
+void
+page_table_init (void)
+{
+  struct thread *t = thread_current ();
+
+  if (!hash_init (&t->pages, page_hash, page_less, NULL))
+    PANIC ("out of memory for supplemental page table");
+  lock_init (&t->page_lock);
+  t->stack_ahead = 1;
+}
+
+/* Frees the supplemental page table of T, a process that has
+   exited, along with the frames and swap slots its pages occupy.
+   Must be called before T's page directory is destroyed. */
+void
+page_table_destroy (struct thread *t)
+{
+  hash_destroy (&t->pages, page_free);
+}
+
+/* Locks the running process's page table, so that the caller may
+   look up pages and add or remove them, or update the lists of
+   memory mappings and shared memory references, without another
+   thread in the process changing them in between.  The caller
+   must not already hold the lock. */
+void
+page_table_lock (void)
+{
+  lock_acquire (&thread_current ()->leader->page_lock);
+}
+
+/* Unlocks the running process's page table. */
+void
+page_table_unlock (void)
+{
+  lock_release (&thread_current ()->leader->page_lock);
+}
+
+/* Locks the running process's page table, unless the running
+   thread already holds the lock.  Returns true if it acquired the
+   lock, for passing to unlock_pages(). */
+static bool
+lock_pages (void)
+{
+  struct lock *lock = &thread_current ()->leader->page_lock;
+
+  if (lock_held_by_current_thread (lock))
+    return false;
+  lock_acquire (lock);
+  return true;
+}
+
+/* Unlocks the running process's page table if ACQUIRED, as
+   returned by lock_pages(), is true. */
+static void
+unlock_pages (bool acquired)
+{
+  if (acquired)
+    lock_release (&thread_current ()->leader->page_lock);
+}
+
+/* Records user page UPAGE as backed by FILE_BYTES bytes of FILE
+   starting at offset OFS, followed by zeros to the end of the
+   page.  FILE must remain open as long as the page exists.  A
+   read-only page that holds file data shares its frame with every
+   other page, in any process, that holds the same read-only data,
+   so FILE must also not be written while the page exists.
+   Returns true if successful, false if UPAGE is already present
+   or memory is not available. */
+bool
+page_add_file (void *upage, struct file *file, off_t ofs,
+               size_t file_bytes, bool writable)
+{
+  struct page *p;
+  bool locked;
+
+  ASSERT (file_bytes <= PGSIZE);
+
+  /* Keep other threads from faulting the page in until it is
+     complete. */
+  locked = lock_pages ();
+  p = page_add (upage, writable);
+  if (p != NULL)
+    {
+      p->file = file_bytes > 0 ? file : NULL;
+      p->file_ofs = ofs;
+      p->file_bytes = file_bytes;
+      p->shared = !writable && p->file != NULL;
+    }
+  unlock_pages (locked);
+  return p != NULL;
+}
+
+/* Records user page UPAGE as initially all zeros.
+   Returns true if successful, false if UPAGE is already present
+   or memory is not available. */
+bool
+page_add_zero (void *upage, bool writable)
+{
+  return page_add (upage, writable) != NULL;
+}
+
+/* Records user page UPAGE as a writable mapping of FILE_BYTES
+   bytes of FILE starting at offset OFS, followed by zeros to the
+   end of the page.  The page shares its frame with every other
+   mapping of the same data, and its data is written back to FILE
+   when it is dirty and is evicted or removed.  FILE must remain
+   open as long as the page exists.  Returns true if successful,
+   false if UPAGE is already present or memory is not available. */
+bool
+page_add_mmap (void *upage, struct file *file, off_t ofs,
+               size_t file_bytes)
+{
+  struct page *p;
+  bool locked;
+
+  ASSERT (file_bytes > 0 && file_bytes <= PGSIZE);
+
+  /* Keep other threads from faulting the page in until it is
+     complete. */
+  locked = lock_pages ();
+  p = page_add (upage, true);
+  if (p != NULL)
+    {
+      p->file = file;
+      p->file_ofs = ofs;
+      p->file_bytes = file_bytes;
+      p->shared = true;
+      p->writeback = true;
+    }
+  unlock_pages (locked);
+  return p != NULL;
+}
+
+/* Records user page UPAGE as a mapping of page PAGE_NO of shared
+   memory segment SEG.  The page shares its frame with every other
+   mapping of the same page of SEG, in any process.  SEG must
+   remain in existence as long as the page exists.  Returns true
+   if successful, false if UPAGE is already present or memory is
+   not available. */
+bool
+page_add_shm (void *upage, struct shm_segment *seg, size_t page_no)
+{
+  struct page *p;
+  bool locked;
+
+  /* Keep other threads from faulting the page in until it is
+     complete. */
+  locked = lock_pages ();
+  p = page_add (upage, true);
+  if (p != NULL)
+    {
+      p->segment = seg;
+      p->file_ofs = page_no * PGSIZE;
+      p->file_bytes = PGSIZE;
+      p->shared = true;
+    }
+  unlock_pages (locked);
+  return p != NULL;
+}
+
+/* Removes the running process's page at user virtual address
+   UPAGE, which must exist, writing it back to its file if
+   necessary. */
+void
+page_remove (void *upage)
+{
+  bool locked = lock_pages ();
+  struct page *p = page_lookup (upage);
+
+  ASSERT (p != NULL);
+  hash_delete (&thread_current ()->leader->pages, &p->hash_elem);
+  page_destroy (p);
+  unlock_pages (locked);
+}
+
+/* Returns the running process's page that contains user virtual
+   address UADDR, or a null pointer if there is none.  Unless the
+   caller holds the page table lock, another thread may remove the
+   page at any time. */
+struct page *
+page_lookup (const void *uaddr)
+{
+  bool locked = lock_pages ();
+  struct page p;
+  struct hash_elem *e;
+
+  p.upage = pg_round_down (uaddr);
+  e = hash_find (&thread_current ()->leader->pages, &p.hash_elem);
+  unlock_pages (locked);
+  return e != NULL ? hash_entry (e, struct page, hash_elem) : NULL;
+}
+
+/* Returns the object that holds the data of shared page P: its
+   shared memory segment, or else its file's inode.  Together with
+   P's offset in it, this identifies P's data in every process. */
+const void *
+page_shared_object (const struct page *p)
+{
+  ASSERT (p->shared);
+  if (p->segment != NULL)
+    return p->segment;
+  return file_get_inode (p->file);
+}
+
+/* Reads or, if WRITE is true, writes SIZE bytes of FILE at offset
+   OFS from or to BUFFER, and returns the number of bytes
+   transferred.  Acquires the file system lock unless the current
+   thread already holds it, which it may if it faulted or had to
+   evict a page while in the middle of a file system operation. */
+static off_t
+page_file_io (struct file *file, void *buffer, off_t size, off_t ofs,
+              bool write)
+{
+  bool held = lock_held_by_current_thread (&filesys_lock);
+  off_t result;
+
+  if (!held)
+    lock_acquire (&filesys_lock);
+  if (write)
+    result = file_write_at (file, buffer, size, ofs);
+  else
+    result = file_read_at (file, buffer, size, ofs);
+  if (!held)
+    lock_release (&filesys_lock);
+  return result;
+}
+
+/* Writes the data in frame F, which must be locked by the current
+   thread, back to the file of page P, which is mapped to F.
+   Returns true if successful. */
+static bool
+write_back (struct page *p, struct frame *f)
+{
+  ASSERT (p->writeback);
+  return (page_file_io (p->file, f->base, p->file_bytes, p->file_ofs, true)
+          == (off_t) p->file_bytes);
+}
+
+/* Gives page P a frame holding its data, and leaves the frame
+   locked.  Stores in *TYPE where the data came from.  Returns
+   true if successful, false if no frame could be allocated or the
+   file could not be read. */
+static bool
+page_in (struct page *p, enum fault_type *type)
+{
+  if (p->shared)
+    {
+      /* Use the frame that already holds the data, if any.
+         Otherwise, publish a new frame before reading the data
+         into it, so that other threads that want the same data
+         wait for us instead of reading it again. */
+      for (;;)
+        {
+          p->frame = frame_find_shared (p);
+          if (p->frame != NULL)
+            {
+              *type = FAULT_SHARED;
+              return true;
+            }
+          p->frame = frame_alloc_and_lock (p);
+          if (p->frame == NULL)
+            return false;
+          if (frame_share (p->frame))
+            break;
+
+          /* Another thread published the same data first. */
+          frame_detach (p);
+        }
+    }
+  else
+    {
+      p->frame = frame_alloc_and_lock (p);
+      if (p->frame == NULL)
+        return false;
+    }
+
+  if (p->segment != NULL)
+    *type = shm_page_in (p, p->frame->base) ? FAULT_SWAP : FAULT_ZERO;
+  else if (zstore_load (p, p->frame->base))
+    *type = FAULT_COMPRESSED;
+  else if (p->sector != SWAP_NONE)
+    {
+      /* Map the pages that swap_in() reads around P right away,
+         so that touching them does not fault.  If mapping one
+         fails, it stays in its frame and is mapped on its next
+         fault. */
+      struct page *around[SWAP_CLUSTER - 1];
+      size_t n = swap_in (p, around);
+      size_t i;
+
+      *type = FAULT_SWAP;
+      for (i = 0; i < n; i++)
+        {
+          struct page *q = around[i];
+          pagedir_set_page (q->thread->pagedir, q->upage, q->frame->base,
+                            q->writable);
+          frame_unlock (q->frame);
+        }
+    }
+  else if (p->file != NULL)
+    {
+      *type = p->writeback ? FAULT_MMAP : FAULT_FILE;
+      if (page_file_io (p->file, p->frame->base, p->file_bytes,
+                        p->file_ofs, false) != (off_t) p->file_bytes)
+        {
+          frame_detach (p);
+          return false;
+        }
+      memset ((uint8_t *) p->frame->base + p->file_bytes, 0,
+              PGSIZE - p->file_bytes);
+    }
+  else
+    {
+      *type = FAULT_ZERO;
+      memset (p->frame->base, 0, PGSIZE);
+    }
+  return true;
+}
+
+/* Brings page P of the running process into memory and maps it in
+   the process's page directory.  Stores in *TYPE how the page was
+   brought in.  Returns true if successful, false if memory is not
+   available. */
+static bool
+load (struct page *p, enum fault_type *type)
+{
+  bool success;
+
+  /* The page may still be in its frame, if it was chosen for
+     eviction but could not be written out. */
+  *type = FAULT_RESIDENT;
+  frame_lock (p);
+  if (p->frame == NULL && !page_in (p, type))
+    return false;
+  ASSERT (lock_held_by_current_thread (&p->frame->lock));
+
+  success = pagedir_set_page (p->thread->pagedir, p->upage,
+                              p->frame->base, p->writable);
+  frame_unlock (p->frame);
+  return success;
+}
+
+/* Brings the page containing FAULT_ADDR into memory and maps it
+   in the running process's page directory.  Returns true if
+   successful, false if FAULT_ADDR is not in a page of the
+   supplemental page table or memory is not available. */
+bool
+page_load (const void *fault_addr)
+{
+  struct page *p;
+  enum fault_type type;
+  bool locked;
+  bool success;
+
+  if (!is_user_vaddr (fault_addr) || thread_current ()->pagedir == NULL)
+    return false;
+  locked = lock_pages ();
+  p = page_lookup (fault_addr);
+  success = p != NULL && load (p, &type);
+  unlock_pages (locked);
+  return success;
+}
+
+/* Resolves a not-present page fault at FAULT_ADDR in the running
+   thread, whose user stack pointer was ESP, by loading the page or
+   growing the stack.  Returns the kind of fault, which is
+   FAULT_INVALID if it could not be resolved. */
+enum fault_type
+page_resolve_fault (const void *fault_addr, const void *esp)
+{
+  struct page *p;
+  enum fault_type type;
+  bool locked;
+
+  if (!is_user_vaddr (fault_addr) || thread_current ()->pagedir == NULL)
+    return FAULT_INVALID;
+  locked = lock_pages ();
+  p = page_lookup (fault_addr);
+  if (p != NULL)
+    {
+      if (!load (p, &type))
+        type = FAULT_INVALID;
+    }
+  else
+    type = page_grow_stack (fault_addr, esp) ? FAULT_STACK : FAULT_INVALID;
+  unlock_pages (locked);
+  return type;
+}
+
+/* Returns true if user address UADDR is in the region reserved
+   for the stack. */
+bool
+page_is_stack (const void *uaddr)
+{
+  return (is_user_vaddr (uaddr)
+          && (size_t) ((uint8_t *) PHYS_BASE - (uint8_t *) uaddr)
+             <= page_stack_max);
+}
+
+/* Extends the running process's stack down to the page containing
+   FAULT_ADDR, which must not be in the supplemental page table,
+   and maps the new pages.  Returns true if successful, false if
+   FAULT_ADDR is not a plausible stack access for stack pointer ESP
+   or memory is not available.
+
+   An access is plausible if it is in the stack region and no more
+   than 32 bytes below ESP, because PUSHA checks for access to all
+   32 bytes it pushes before it moves the stack pointer.
+
+   If the page just above the faulting page is already present,
+   the process is walking down its stack, as deep recursion does.
+   Each such fault in a row adds twice as many pages as the last,
+   up to STACK_AHEAD_MAX, so that a long walk takes few faults. */
+bool
+page_grow_stack (const void *fault_addr, const void *esp)
+{
+  struct thread *t = thread_current ()->leader;
+  uint8_t *upage = pg_round_down (fault_addr);
+  size_t cnt;
+  size_t i;
+  bool locked;
+  bool success;
+
+  if (t->pagedir == NULL || !page_is_stack (fault_addr)
+      || (const uint8_t *) fault_addr < (const uint8_t *) esp - 32)
+    return false;
+  locked = lock_pages ();
+
+  if (page_lookup (upage + PGSIZE) == NULL)
+    t->stack_ahead = 1;
+  else if (t->stack_ahead < STACK_AHEAD_MAX)
+    t->stack_ahead *= 2;
+
+  /* Add the faulting page and up to stack_ahead - 1 pages below
+     it, stopping at the end of the stack region or at any page
+     that is already present. */
+  if (!page_add_zero (upage, true))
+    {
+      unlock_pages (locked);
+      return false;
+    }
+  for (cnt = 1; cnt < t->stack_ahead; cnt++)
+    {
+      uint8_t *below = upage - cnt * PGSIZE;
+      if (!page_is_stack (below) || !page_add_zero (below, true))
+        break;
+    }
+
+  /* Map the pages below the faulting page, too, so that the
+     process does not fault on them.  If one of them cannot be
+     loaded now, it will be on its first access. */
+  for (i = 1; i < cnt; i++)
+    page_load (upage - i * PGSIZE);
+  success = page_load (upage);
+  unlock_pages (locked);
+  return success;
+}
+
+/* Returns true if any page mapped to frame F, which must be
+   locked by the current thread, has been accessed since the last
+   call, and clears their accessed bits. */
+bool
+page_accessed_recently (struct frame *f)
+{
+  struct list_elem *e;
+  bool accessed = false;
+
+  ASSERT (lock_held_by_current_thread (&f->lock));
+
+  for (e = list_begin (&f->pages); e != list_end (&f->pages);
+       e = list_next (e))
+    {
+      struct page *p = list_entry (e, struct page, frame_elem);
+      uint32_t *pd = p->thread->pagedir;
+
+      if (pagedir_is_accessed (pd, p->upage))
+        {
+          pagedir_set_accessed (pd, p->upage, false);
+          ws_referenced (p);
+          accessed = true;
+        }
+    }
+  return accessed;
+}
+
+/* Unmaps every page mapped to frame F, which must be locked by the
+   current thread, and returns true if any of them, or F itself,
+   is dirty.  The pages keep the frame. */
+static bool
+unmap_frame (struct frame *f)
+{
+  struct list_elem *e;
+  bool dirty = f->dirty;
+
+  for (e = list_begin (&f->pages); e != list_end (&f->pages);
+       e = list_next (e))
+    {
+      struct page *p = list_entry (e, struct page, frame_elem);
+      uint32_t *pd = p->thread->pagedir;
+
+      /* Mark the page not present first, so that the process
+         faults and waits on the frame lock if it touches the page
+         while we write it out, and cannot dirty it after we
+         check. */
+      pagedir_clear_page (pd, p->upage);
+      dirty = dirty || pagedir_is_dirty (pd, p->upage);
+    }
+  return dirty;
+}
+
+/* Lets go of the pages mapped to frame F, which must be locked by
+   the current thread and whose pages must all belong to processes
+   that have exited, without saving their data, which no one will
+   read again.  Returns true if successful, false if a page's data
+   outlives its process because it is a dirty page of a file or a
+   shared memory segment, in which case F keeps its pages. */
+bool
+page_discard (struct frame *f)
+{
+  struct list_elem *e;
+  bool dirty;
+
+  ASSERT (lock_held_by_current_thread (&f->lock));
+
+  dirty = unmap_frame (f);
+  for (e = list_begin (&f->pages); e != list_end (&f->pages);
+       e = list_next (e))
+    {
+      struct page *p = list_entry (e, struct page, frame_elem);
+      ASSERT (p->thread->exited);
+      if (dirty && (p->writeback || p->segment != NULL))
+        return false;
+    }
+
+  /* As in page_out(), once a page's frame is null, the reaper may
+     free the page. */
+  e = list_begin (&f->pages);
+  while (e != list_end (&f->pages))
+    {
+      struct page *p = list_entry (e, struct page, frame_elem);
+      e = list_next (e);
+      p->frame = NULL;
+    }
+  list_init (&f->pages);
+  f->dirty = false;
+  return true;
+}
+
+/* Evicts the pages in the CNT frames in FRAMES, each of which
+   must be locked by the current thread, writing those that need
+   it to swap together.  Reorders FRAMES so that the frames whose
+   pages were evicted come first, and returns their number.  The
+   others keep their pages, which happens only if swap is full or
+   a file cannot be written. */
+size_t
+page_out (struct frame *frames[], size_t cnt)
+{
+  struct page *swap[SWAP_CLUSTER];
+  void *swap_data[SWAP_CLUSTER];
+  size_t swap_cnt = 0;
+  size_t swapped;
+  bool evicted[SWAP_CLUSTER];
+  bool to_swap[SWAP_CLUSTER];
+  size_t evicted_cnt;
+  size_t i;
+
+  ASSERT (cnt <= SWAP_CLUSTER);
+
+  for (i = 0; i < cnt; i++)
+    {
+      struct frame *f = frames[i];
+      struct page *p = list_entry (list_front (&f->pages),
+                                   struct page, frame_elem);
+      bool dirty;
+
+      ASSERT (lock_held_by_current_thread (&f->lock));
+
+      /* If we keep the frame after all, its pages will be mapped
+         again with clean page table entries. */
+      f->dirty = dirty = unmap_frame (f);
+      to_swap[i] = false;
+
+      /* Clean pages read from a file can just be read again, and
+         dirty pages that belong to a file go back to the file.  A
+         page of a shared memory segment goes back to the segment,
+         if it is dirty.  Anything else is compressed or goes to
+         swap, and only a private page can be anything else. */
+      if (p->segment != NULL)
+        evicted[i] = !dirty || shm_page_out (p, f->base);
+      else if (p->file != NULL && !dirty)
+        evicted[i] = true;
+      else if (p->writeback)
+        evicted[i] = write_back (p, f);
+      else
+        {
+          ASSERT (list_size (&f->pages) == 1);
+          evicted[i] = zstore_put (p, f->base);
+          if (!evicted[i])
+            {
+              to_swap[i] = true;
+              swap_data[swap_cnt] = f->base;
+              swap[swap_cnt++] = p;
+            }
+        }
+    }
+
+  /* swap_out() writes a prefix of SWAP, which is in the same order
+     as FRAMES. */
+  swapped = swap_out (swap, swap_data, swap_cnt);
+  for (i = 0; i < cnt && swapped > 0; i++)
+    if (to_swap[i])
+      {
+        evicted[i] = true;
+        swapped--;
+      }
+
+  /* Move the evicted frames to the front, then let go of their
+     pages.  Once a page's frame is null, its owner may free the
+     page, so we must not touch it after that. */
+  evicted_cnt = 0;
+  for (i = 0; i < cnt; i++)
+    if (evicted[i])
+      {
+        struct frame *f = frames[i];
+        frames[i] = frames[evicted_cnt];
+        frames[evicted_cnt++] = f;
+      }
+  for (i = 0; i < evicted_cnt; i++)
+    {
+      struct frame *f = frames[i];
+      struct list_elem *e = list_begin (&f->pages);
+
+      while (e != list_end (&f->pages))
+        {
+          struct page *p = list_entry (e, struct page, frame_elem);
+          e = list_next (e);
+          p->frame = NULL;
+        }
+      list_init (&f->pages);
+      f->dirty = false;
+    }
+  return evicted_cnt;
+}
+
+/* Adds a new page for UPAGE to the running process's
+   supplemental page table and returns it, or returns a null
+   pointer if UPAGE is already present or memory is not
+   available. */
+static struct page *
+page_add (void *upage, bool writable)
+{
+  struct thread *leader = thread_current ()->leader;
+  struct page *p;
+  bool locked;
+
+  ASSERT (pg_ofs (upage) == 0);
+  ASSERT (is_user_vaddr (upage));
+
+  p = malloc (sizeof *p);
+  if (p == NULL)
+    return NULL;
+  p->upage = upage;
+  p->writable = writable;
+  p->thread = leader;
+  p->frame = NULL;
+  p->sector = SWAP_NONE;
+  p->zentry = NULL;
+  p->file = NULL;
+  p->file_ofs = 0;
+  p->file_bytes = 0;
+  p->segment = NULL;
+  p->shared = false;
+  p->writeback = false;
+  ws_referenced (p);
+  locked = lock_pages ();
+  if (hash_insert (&leader->pages, &p->hash_elem) != NULL)
+    {
+      free (p);
+      p = NULL;
+    }
+  unlock_pages (locked);
+  return p;
+}
+
+/* Returns a hash value for the page that E refers to. */
+static unsigned
+page_hash (const struct hash_elem *e, void *aux UNUSED)
+{
+  const struct page *p = hash_entry (e, struct page, hash_elem);
+  return hash_bytes (&p->upage, sizeof p->upage);
+}
+
+/* Returns true if page A precedes page B. */
+static bool
+page_less (const struct hash_elem *a_, const struct hash_elem *b_,
+           void *aux UNUSED)
+{
+  const struct page *a = hash_entry (a_, struct page, hash_elem);
+  const struct page *b = hash_entry (b_, struct page, hash_elem);
+  return a->upage < b->upage;
+}
+
+/* Frees page P, along with its frame or swap slot.  If P is a
+   write-back page and its data is dirty, writes it back to its
+   file first.  If P is the last mapping of a dirty page of a
+   shared memory segment, saves the data in the segment first,
+   because the frame is about to be freed. */
+static void
+page_destroy (struct page *p)
+{
+  frame_lock (p);
+  if (p->frame != NULL)
+    {
+      struct frame *f = p->frame;
+      uint32_t *pd = p->thread->pagedir;
+
+      /* Unmap the frame, so that pagedir_destroy() does not free
+         it as well. */
+      pagedir_clear_page (pd, p->upage);
+      if (pagedir_is_dirty (pd, p->upage))
+        f->dirty = true;
+      if (p->writeback && f->dirty && write_back (p, f))
+        f->dirty = false;
+      else if (p->segment != NULL && f->dirty
+               && list_size (&f->pages) == 1 && shm_page_out (p, f->base))
+        f->dirty = false;
+      frame_detach (p);
+    }
+  zstore_free (p);
+  swap_free (p);
+  free (p);
+}
+
+/* Frees the page that E refers to. */
+static void
+page_free (struct hash_elem *e, void *aux UNUSED)
+{
+  page_destroy (hash_entry (e, struct page, hash_elem));
+}
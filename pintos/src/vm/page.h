@@ -0,0 +1,88 @@
+#ifndef VM_PAGE_H
+#define VM_PAGE_H
+
+#include <hash.h>
+#include <list.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "devices/block.h"
+#include "filesys/off_t.h"
+#include "userprog/fault.h"
+
+struct file;
+struct frame;
+struct shm_segment;
+struct zentry;
+struct thread;
+
+/* A virtual page in a user process's supplemental page table.
+
+   The supplemental page table records, for every page of a
+   process's address space, where the page's contents come from,
+   so that the page need not be brought into memory until the
+   process first touches it, and so that it can be evicted from
+   memory and brought back later. */
+struct page
+  {
+    void *upage;                /* User virtual address. */
+    bool writable;              /* False to map read-only. */
+    struct thread *thread;      /* Owning process's leader. */
+    struct hash_elem hash_elem; /* Element in leader's `pages'. */
+
+    /* Set only by the owning process, cleared by eviction; both
+       only while the frame is locked. */
+    struct frame *frame;        /* Frame holding the page, or null. */
+    struct list_elem frame_elem; /* Element in frame's `pages'. */
+
+    block_sector_t sector;      /* First swap sector, or SWAP_NONE. */
+    struct zentry *zentry;      /* Compressed copy, or null. */
+
+    /* Initial contents: the first FILE_BYTES bytes are read from
+       FILE starting at offset FILE_OFS, and the rest of the page
+       is zeroed.  FILE is a null pointer for an all-zero page. */
+    struct file *file;          /* File to read, or null. */
+    off_t file_ofs;             /* Offset in FILE or SEGMENT. */
+    size_t file_bytes;          /* Bytes to read, at most PGSIZE. */
+
+    /* A page of a shared memory segment has no file.  Its data is
+       the page at offset FILE_OFS in SEGMENT, which keeps it in
+       swap while no frame holds it (see vm/shm.c). */
+    struct shm_segment *segment; /* Segment, or null. */
+
+    /* A shared page maps the same frame as every other shared page
+       with the same file or segment data, in any process.  A
+       write-back page is written back to FILE, instead of to swap,
+       when it is dirty and is evicted or removed. */
+    bool shared;                /* Share frame with same file data? */
+    bool writeback;             /* Write back to FILE? */
+
+    unsigned ref_period;        /* Last period referenced (vm/ws.c). */
+  };
+
+/* Maximum size of a user stack, in bytes. */
+extern size_t page_stack_max;
+
+void page_table_init (void);
+void page_table_destroy (struct thread *);
+void page_table_lock (void);
+void page_table_unlock (void);
+
+bool page_add_file (void *upage, struct file *, off_t ofs,
+                    size_t file_bytes, bool writable);
+bool page_add_zero (void *upage, bool writable);
+bool page_add_mmap (void *upage, struct file *, off_t ofs,
+                    size_t file_bytes);
+bool page_add_shm (void *upage, struct shm_segment *, size_t page_no);
+void page_remove (void *upage);
+struct page *page_lookup (const void *uaddr);
+const void *page_shared_object (const struct page *);
+bool page_load (const void *fault_addr);
+enum fault_type page_resolve_fault (const void *fault_addr, const void *esp);
+bool page_is_stack (const void *uaddr);
+bool page_grow_stack (const void *fault_addr, const void *esp);
+
+bool page_accessed_recently (struct frame *);
+bool page_discard (struct frame *);
+size_t page_out (struct frame *[], size_t cnt);
+
+#endif /* vm/page.h */
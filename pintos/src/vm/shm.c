@@ -0,0 +1,383 @@
+#include "vm/shm.h"
+#include <debug.h>
+#include <list.h>
+#include <stdio.h>
+#include <string.h>
+#include "vm/page.h"
+#include "vm/swap.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+
+/* Shared memory segments.
+
+   A segment is a run of anonymous pages that any number of
+   processes may map at once, each at an address of its own
+   choosing.  A process creates a segment with shm_create(), which
+   returns an id that it passes to its cooperating processes, for
+   example on their command lines, and each of them maps the
+   segment with shm_attach().
+
+   Every mapping of a given page of a segment, in any process,
+   shares a single frame from the user pool, entered in the shared
+   frame table under the segment and the page's offset in it (see
+   vm/frame.h), so data written by one process is seen at once by
+   every other.  A page is all zeros until it is first evicted
+   while dirty.  From then on, while no frame holds it, its data
+   lives in a swap slot that belongs to the segment, and that slot
+   is rewritten each time the page is evicted dirty again.  A
+   segment thus costs nothing until its pages are touched, and
+   nothing about it involves the file system.
+
+   A process holds a reference to each segment that it created or
+   mapped.  The segment, with its swap slots, goes away when the
+   last reference is released, by shm_detach() or on exit.  A
+   process's list of references is shared by its threads and
+   protected by its page table lock. */
+
+/* A segment. */
+struct shm_segment
+  {
+    struct list_elem elem;      /* Element in `segments'. */
+    int id;                     /* Segment id. */
+    size_t page_cnt;            /* Number of pages. */
+    unsigned ref_cnt;           /* Creator and attachments. */
+
+    /* First swap sector of each page's saved data, or SWAP_NONE
+       if the page has never been saved.  An element is used only
+       by a thread that holds the lock on the frame of that page,
+       of which there is at most one at a time. */
+    block_sector_t *sectors;
+  };
+
+/* A process's reference to a segment, in its `shm' list. */
+struct shm_ref
+  {
+    struct list_elem elem;      /* Element in leader's `shm'. */
+    struct shm_segment *seg;    /* Segment. */
+    uint8_t *base;              /* Start of mapping, or null for the
+                                   reference held by the creator. */
+  };
+
+/* Most pages in a segment. */
+#define SHM_MAX_PAGES 1024
+
+static struct list segments;    /* All segments. */
+static struct lock shm_lock;    /* Protects `segments' and the
+                                   statistics below. */
+static int next_id;             /* Next segment id. */
+
+/* Statistics. */
+static unsigned long long create_cnt;   /* Segments created. */
+static unsigned long long attach_cnt;   /* Successful attachments. */
+static size_t live_page_cnt;            /* Pages in live segments. */
+static size_t max_live_page_cnt;        /* Most pages in live segments. */
+
+/* Initializes the shared memory module. */
+void
+shm_init (void)
+{
+  list_init (&segments);
+  lock_init (&shm_lock);
+}
+
+/* Adds REF to the running process's references.  The page table
+   must be locked. */
+static void
+add_ref (struct shm_ref *ref)
+{
+  list_push_back (&thread_current ()->leader->shm, &ref->elem);
+}
+
+/* Creates a segment of PAGE_CNT zeroed pages, of which the running
+   process becomes a holder.  Returns its id, or -1 on failure. */
+int
+shm_create (size_t page_cnt)
+{
+  struct shm_segment *seg;
+  struct shm_ref *ref;
+  block_sector_t *sectors;
+  size_t i;
+
+  if (page_cnt == 0 || page_cnt > SHM_MAX_PAGES)
+    return -1;
+
+  seg = malloc (sizeof *seg);
+  ref = malloc (sizeof *ref);
+  sectors = malloc (page_cnt * sizeof *sectors);
+  if (seg == NULL || ref == NULL || sectors == NULL)
+    goto error;
+  for (i = 0; i < page_cnt; i++)
+    sectors[i] = SWAP_NONE;
+  seg->sectors = sectors;
+  seg->page_cnt = page_cnt;
+  seg->ref_cnt = 1;
+
+  lock_acquire (&shm_lock);
+  seg->id = next_id++;
+  list_push_back (&segments, &seg->elem);
+  create_cnt++;
+  live_page_cnt += seg->page_cnt;
+  if (live_page_cnt > max_live_page_cnt)
+    max_live_page_cnt = live_page_cnt;
+  lock_release (&shm_lock);
+
+  ref->seg = seg;
+  ref->base = NULL;
+  page_table_lock ();
+  add_ref (ref);
+  page_table_unlock ();
+  return seg->id;
+
+ error:
+  free (sectors);
+  free (seg);
+  free (ref);
+  return -1;
+}
+
+/* Returns the segment with the given ID, with a new reference
+   added, or a null pointer if there is none. */
+static struct shm_segment *
+get_segment (int id)
+{
+  struct list_elem *e;
+
+  lock_acquire (&shm_lock);
+  for (e = list_begin (&segments); e != list_end (&segments);
+       e = list_next (e))
+    {
+      struct shm_segment *seg = list_entry (e, struct shm_segment, elem);
+      if (seg->id == id)
+        {
+          seg->ref_cnt++;
+          lock_release (&shm_lock);
+          return seg;
+        }
+    }
+  lock_release (&shm_lock);
+  return NULL;
+}
+
+/* Releases a reference to SEG, freeing it if it was the last. */
+static void
+put_segment (struct shm_segment *seg)
+{
+  bool last;
+
+  lock_acquire (&shm_lock);
+  ASSERT (seg->ref_cnt > 0);
+  last = --seg->ref_cnt == 0;
+  if (last)
+    {
+      list_remove (&seg->elem);
+      live_page_cnt -= seg->page_cnt;
+    }
+  lock_release (&shm_lock);
+
+  if (last)
+    {
+      size_t i;
+
+      for (i = 0; i < seg->page_cnt; i++)
+        swap_release (seg->sectors[i]);
+      free (seg->sectors);
+      free (seg);
+    }
+}
+
+/* Returns true if user page UPAGE may be part of a new mapping
+   in the running process: it is in user space outside the stack
+   region and is not yet mapped. */
+static bool
+is_free_page (uint8_t *upage)
+{
+  return (upage != NULL && is_user_vaddr (upage) && !page_is_stack (upage)
+          && page_lookup (upage) == NULL);
+}
+
+/* Returns true if the PAGE_CNT pages starting at BASE are all free
+   for a new mapping in the running process. */
+static bool
+is_free_range (uint8_t *base, size_t page_cnt)
+{
+  size_t i;
+
+  for (i = 0; i < page_cnt; i++)
+    if (base + i * PGSIZE < base || !is_free_page (base + i * PGSIZE))
+      return false;
+  return true;
+}
+
+/* Returns the highest address, below the stack region, at which
+   PAGE_CNT pages are free in the running process, or a null
+   pointer if there is none.  Walks down from the stack region,
+   counting the run of free pages just below each page in use. */
+static uint8_t *
+find_free_range (size_t page_cnt)
+{
+  uint8_t *top = pg_round_down ((uint8_t *) PHYS_BASE - page_stack_max);
+  size_t free_cnt = 0;
+
+  while ((size_t) top > PGSIZE)
+    {
+      top -= PGSIZE;
+      if (!is_free_page (top))
+        free_cnt = 0;
+      else if (++free_cnt == page_cnt)
+        return top;
+    }
+  return NULL;
+}
+
+/* Removes the first CNT pages of the mapping at BASE. */
+static void
+unmap (uint8_t *base, size_t cnt)
+{
+  size_t i;
+
+  for (i = 0; i < cnt; i++)
+    page_remove (base + i * PGSIZE);
+}
+
+/* Maps segment ID into the running process at ADDR, which must be
+   page-aligned, or at an address of the kernel's choosing if ADDR
+   is null.  Returns the address of the mapping, or a null pointer
+   on failure.  Keeps the page table locked from choosing the
+   address until the mapping is complete, so that no other thread
+   in the process can map anything else there meanwhile. */
+void *
+shm_attach (int id, void *addr)
+{
+  struct shm_segment *seg;
+  struct shm_ref *ref;
+  uint8_t *base = addr;
+  size_t i;
+
+  if (pg_ofs (addr) != 0)
+    return NULL;
+  seg = get_segment (id);
+  if (seg == NULL)
+    return NULL;
+  ref = malloc (sizeof *ref);
+  if (ref == NULL)
+    goto error;
+
+  page_table_lock ();
+  if (base == NULL)
+    base = find_free_range (seg->page_cnt);
+  else if (!is_free_range (base, seg->page_cnt))
+    base = NULL;
+  if (base == NULL)
+    goto error_unlock;
+
+  for (i = 0; i < seg->page_cnt; i++)
+    if (!page_add_shm (base + i * PGSIZE, seg, i))
+      {
+        unmap (base, i);
+        goto error_unlock;
+      }
+
+  ref->seg = seg;
+  ref->base = base;
+  add_ref (ref);
+  page_table_unlock ();
+
+  lock_acquire (&shm_lock);
+  attach_cnt++;
+  lock_release (&shm_lock);
+  return base;
+
+ error_unlock:
+  page_table_unlock ();
+ error:
+  free (ref);
+  put_segment (seg);
+  return NULL;
+}
+
+/* Unmaps REF's pages, if any, and releases and frees REF. */
+static void
+release (struct shm_ref *ref)
+{
+  if (ref->base != NULL)
+    unmap (ref->base, ref->seg->page_cnt);
+  list_remove (&ref->elem);
+  put_segment (ref->seg);
+  free (ref);
+}
+
+/* Unmaps the segment that the running process mapped at ADDR.
+   Returns true if successful, false if no segment is mapped
+   there. */
+bool
+shm_detach (void *addr)
+{
+  struct list *refs = &thread_current ()->leader->shm;
+  struct list_elem *e;
+  bool found = false;
+
+  if (addr == NULL)
+    return false;
+  page_table_lock ();
+  for (e = list_begin (refs); e != list_end (refs); e = list_next (e))
+    {
+      struct shm_ref *ref = list_entry (e, struct shm_ref, elem);
+      if (ref->base == addr)
+        {
+          release (ref);
+          found = true;
+          break;
+        }
+    }
+  page_table_unlock ();
+  return found;
+}
+
+/* Releases all of the running process's references to segments.
+   Called when it exits, after its other threads have. */
+void
+shm_exit (void)
+{
+  struct list *refs = &thread_current ()->leader->shm;
+
+  while (!list_empty (refs))
+    release (list_entry (list_front (refs), struct shm_ref, elem));
+}
+
+/* Reads the data of P, a page of a shared memory segment, into
+   KPAGE.  Returns true if the data came from swap, or false if
+   the page has never been saved, in which case KPAGE is zeroed.
+   P's frame must be locked by the current thread. */
+bool
+shm_page_in (const struct page *p, void *kpage)
+{
+  block_sector_t sector = p->segment->sectors[p->file_ofs / PGSIZE];
+
+  if (sector == SWAP_NONE)
+    {
+      memset (kpage, 0, PGSIZE);
+      return false;
+    }
+  swap_read (sector, kpage);
+  return true;
+}
+
+/* Saves KPAGE as the data of P, a page of a shared memory
+   segment, in the segment's swap slot for P, allocating the slot
+   if P has none yet.  P's frame must be locked by the current
+   thread.  Returns true if successful, false if swap is full. */
+bool
+shm_page_out (const struct page *p, const void *kpage)
+{
+  return swap_write (&p->segment->sectors[p->file_ofs / PGSIZE], kpage);
+}
+
+/* Prints shared memory statistics. */
+void
+shm_print_stats (void)
+{
+  printf ("Shared memory: %llu segments created, %llu attachments, "
+          "%zu pages at most\n", create_cnt, attach_cnt, max_live_page_cnt);
+}
@@ -0,0 +1,18 @@
+#ifndef VM_SHM_H
+#define VM_SHM_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+struct page;
+
+void shm_init (void);
+int shm_create (size_t page_cnt);
+void *shm_attach (int id, void *addr);
+bool shm_detach (void *addr);
+void shm_exit (void);
+bool shm_page_in (const struct page *, void *kpage);
+bool shm_page_out (const struct page *, const void *kpage);
+void shm_print_stats (void);
+
+#endif /* vm/shm.h */
@@ -0,0 +1,394 @@
+#include "vm/swap.h"
+#include <bitmap.h>
+#include <debug.h>
+#include <stdio.h>
+#include <string.h>
+#include "vm/frame.h"
+#include "vm/page.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+
+/* Swap space.
+
+   The swap block device is divided into page-sized slots, and a
+   bitmap records which slots are in use.  A page that is swapped
+   out occupies one slot until it is swapped back in or freed.
+
+   Swap is designed for throughput rather than for the fewest
+   possible slots.  The pages that one eviction pass writes out
+   are given a run of consecutive slots and written with a single
+   multi-sector transfer.  Slots are handed out from a rotating
+   position, so that successive runs also tend to be adjacent.
+   When a page is swapped back in, the other pages of the same
+   process in the slots around it were most likely evicted along
+   with it and will most likely be needed along with it too, so
+   they are read in by the same transfer ("read-around") as long
+   as free frames are available for them.
+
+   Shared memory segments (see vm/shm.c) also keep their evicted
+   pages in swap, through swap_write() and swap_read().  Such a
+   slot belongs to the segment rather than to any page, so it is
+   never read around, and it keeps the page's data until
+   swap_release() frees it, even after the data is read back. */
+
+/* The swap device, or a null pointer if there is none. */
+static struct block *swap_device;
+
+/* Number of swap slots. */
+static size_t slot_cnt;
+
+/* Used swap slots, and the page in each used slot. */
+static struct bitmap *swap_bitmap;
+static struct page **slot_pages;
+
+/* Slot at which to start looking for free slots. */
+static size_t next_slot;
+
+/* Protects the variables above and the statistics below. */
+static struct lock swap_lock;
+
+/* Bounce buffer for transfers of more than one page, with room
+   for SWAP_CLUSTER pages, and the lock that protects it. */
+static uint8_t *cluster_buf;
+static struct lock cluster_lock;
+
+/* Number of sectors per page. */
+#define PAGE_SECTORS (PGSIZE / BLOCK_SECTOR_SIZE)
+
+/* Statistics. */
+static unsigned long long page_out_cnt; /* Pages written. */
+static unsigned long long write_cnt;    /* Transfers that wrote them. */
+static unsigned long long page_in_cnt;  /* Pages read. */
+static unsigned long long read_cnt;     /* Transfers that read them. */
+static unsigned long long around_cnt;   /* Pages read by read-around. */
+
+/* Swap statistics for exited processes.  Only the first
+   MAX_RECORDS processes that used swap are recorded. */
+struct swap_record
+  {
+    char name[16];              /* Process name. */
+    tid_t tid;                  /* Process's thread identifier. */
+    unsigned in_cnt;            /* Pages swapped in. */
+    unsigned out_cnt;           /* Pages swapped out. */
+  };
+#define MAX_RECORDS 32
+static struct swap_record records[MAX_RECORDS];
+static size_t record_cnt;       /* Number of processes that used swap. */
+
+/* Sets up swap. */
+void
+swap_init (void)
+{
+  lock_init (&swap_lock);
+  lock_init (&cluster_lock);
+
+  swap_device = block_get_role (BLOCK_SWAP);
+  if (swap_device == NULL)
+    printf ("no swap device--swap disabled\n");
+  else
+    slot_cnt = block_size (swap_device) / PAGE_SECTORS;
+
+  swap_bitmap = bitmap_create (slot_cnt);
+  if (swap_bitmap == NULL)
+    PANIC ("couldn't create swap bitmap");
+  if (slot_cnt > 0)
+    {
+      slot_pages = calloc (slot_cnt, sizeof *slot_pages);
+      cluster_buf = palloc_get_multiple (0, SWAP_CLUSTER);
+      if (slot_pages == NULL || cluster_buf == NULL)
+        PANIC ("couldn't allocate swap tables");
+    }
+}
+
+/* Allocates up to *CNT consecutive free swap slots, preferring
+   as many as possible, and returns the first one.  Stores the
+   number actually allocated in *CNT, which is 0 if swap is full.
+   swap_lock must be held. */
+static size_t
+alloc_slots (size_t *cnt)
+{
+  size_t n;
+
+  ASSERT (lock_held_by_current_thread (&swap_lock));
+
+  for (n = *cnt; n > 0; n /= 2)
+    {
+      size_t slot = bitmap_scan_and_flip (swap_bitmap, next_slot, n, false);
+      if (slot == BITMAP_ERROR)
+        slot = bitmap_scan_and_flip (swap_bitmap, 0, n, false);
+      if (slot != BITMAP_ERROR)
+        {
+          next_slot = slot + n < slot_cnt ? slot + n : 0;
+          *cnt = n;
+          return slot;
+        }
+    }
+  *cnt = 0;
+  return BITMAP_ERROR;
+}
+
+/* Writes the CNT pages in PAGES to swap, using as few transfers
+   as free space allows.  DATA[I] holds the contents of PAGES[I],
+   which must be in a frame locked by the current thread or else
+   in the compressed store.  Returns the number of pages written,
+   which are always the first ones in PAGES.  Fewer than CNT
+   pages are written only if swap is full. */
+size_t
+swap_out (struct page *pages[], void *data[], size_t cnt)
+{
+  size_t done = 0;
+
+  ASSERT (cnt <= SWAP_CLUSTER);
+
+  while (done < cnt)
+    {
+      struct page **run = pages + done;
+      void **run_data = data + done;
+      size_t n = cnt - done;
+      size_t slot;
+      size_t i;
+
+      lock_acquire (&swap_lock);
+      slot = alloc_slots (&n);
+      for (i = 0; i < n; i++)
+        {
+          slot_pages[slot + i] = run[i];
+          run[i]->thread->swap_out_cnt++;
+        }
+      page_out_cnt += n;
+      if (n > 0)
+        write_cnt++;
+      lock_release (&swap_lock);
+      if (n == 0)
+        break;
+
+      if (n == 1)
+        block_write_multiple (swap_device, slot * PAGE_SECTORS,
+                              PAGE_SECTORS, run_data[0]);
+      else
+        {
+          lock_acquire (&cluster_lock);
+          for (i = 0; i < n; i++)
+            memcpy (cluster_buf + i * PGSIZE, run_data[i], PGSIZE);
+          block_write_multiple (swap_device, slot * PAGE_SECTORS,
+                                n * PAGE_SECTORS, cluster_buf);
+          lock_release (&cluster_lock);
+        }
+
+      for (i = 0; i < n; i++)
+        {
+          struct page *p = run[i];
+
+          /* From now on the page's contents live in swap, not in
+             the file it was originally read from. */
+          p->sector = (slot + i) * PAGE_SECTORS;
+          p->file = NULL;
+          p->file_ofs = 0;
+          p->file_bytes = 0;
+        }
+      done += n;
+    }
+  return done;
+}
+
+/* Returns true if SLOT holds a page of the running process that
+   has been completely written out.  swap_lock must be held. */
+static bool
+slot_is_own (size_t slot)
+{
+  struct page *p = slot_pages[slot];
+
+  /* An evicting thread clears p->frame, and the compressed store
+     clears p->zentry, only after setting p->sector. */
+  return (p != NULL && p->thread == thread_current ()->leader
+          && p->frame == NULL && p->zentry == NULL);
+}
+
+/* Reads page P, which must be in swap, into its frame, which
+   must be locked by the current thread, and frees its swap
+   slot.
+
+   Also reads back the running process's pages in the slots on
+   either side of P's, up to SWAP_CLUSTER pages in all, into
+   free frames, and stores them in AROUND, which must have room
+   for SWAP_CLUSTER - 1 pages.  Returns the number of such pages.
+   Each is left in a frame locked by the current thread, but not
+   mapped. */
+size_t
+swap_in (struct page *p, struct page *around[])
+{
+  size_t slot = p->sector / PAGE_SECTORS;
+  size_t lo, hi, s;
+  size_t n = 0;
+
+  ASSERT (p->frame != NULL);
+  ASSERT (lock_held_by_current_thread (&p->frame->lock));
+  ASSERT (p->sector != SWAP_NONE);
+  ASSERT (p->thread == thread_current ()->leader);
+  ASSERT (lock_held_by_current_thread (&p->thread->page_lock));
+
+  /* Find the run of our pages around SLOT, favoring the pages
+     after it because programs tend to touch memory in ascending
+     order. */
+  lock_acquire (&swap_lock);
+  lo = slot;
+  hi = slot + 1;
+  while (hi - lo < SWAP_CLUSTER && hi < slot_cnt && slot_is_own (hi))
+    hi++;
+  while (hi - lo < SWAP_CLUSTER && lo > 0 && slot_is_own (lo - 1))
+    lo--;
+  lock_release (&swap_lock);
+
+  /* Read the run with a single transfer. */
+  if (hi - lo == 1)
+    block_read_multiple (swap_device, slot * PAGE_SECTORS, PAGE_SECTORS,
+                         p->frame->base);
+  else
+    {
+      lock_acquire (&cluster_lock);
+      block_read_multiple (swap_device, lo * PAGE_SECTORS,
+                           (hi - lo) * PAGE_SECTORS, cluster_buf);
+      memcpy (p->frame->base, cluster_buf + (slot - lo) * PGSIZE, PGSIZE);
+
+      /* A process's pages are swapped in or freed only by its
+         own threads, and only while holding its page_lock, as we
+         do, so the pages in the run cannot change under us even
+         if a sibling thread faults on one of them.  Don't evict
+         anything to make room for them. */
+      for (s = lo; s < hi; s++)
+        {
+          struct page *q = slot_pages[s];
+          if (s == slot)
+            continue;
+          q->frame = frame_try_alloc_and_lock (q);
+          if (q->frame == NULL)
+            break;
+          memcpy (q->frame->base, cluster_buf + (s - lo) * PGSIZE, PGSIZE);
+          around[n++] = q;
+        }
+      lock_release (&cluster_lock);
+    }
+
+  lock_acquire (&swap_lock);
+  page_in_cnt += n + 1;
+  around_cnt += n;
+  read_cnt++;
+  p->thread->swap_in_cnt += n + 1;
+  lock_release (&swap_lock);
+
+  swap_free (p);
+  for (s = 0; s < n; s++)
+    swap_free (around[s]);
+  return n;
+}
+
+/* Releases the swap slot that page P occupies, if any. */
+void
+swap_free (struct page *p)
+{
+  swap_release (p->sector);
+  p->sector = SWAP_NONE;
+}
+
+/* Writes the page of data at DATA to the swap slot that starts at
+   *SECTOR, or, if *SECTOR is SWAP_NONE, to a newly allocated
+   slot whose first sector is then stored in *SECTOR.  Returns
+   true if successful, false if swap is full. */
+bool
+swap_write (block_sector_t *sector, const void *data)
+{
+  lock_acquire (&swap_lock);
+  if (*sector == SWAP_NONE)
+    {
+      size_t n = 1;
+      size_t slot = alloc_slots (&n);
+      if (n == 0)
+        {
+          lock_release (&swap_lock);
+          return false;
+        }
+      *sector = slot * PAGE_SECTORS;
+    }
+  page_out_cnt++;
+  write_cnt++;
+  lock_release (&swap_lock);
+
+  block_write_multiple (swap_device, *sector, PAGE_SECTORS, data);
+  return true;
+}
+
+/* Reads the page of data in the swap slot that starts at SECTOR
+   into DATA.  The slot stays allocated. */
+void
+swap_read (block_sector_t sector, void *data)
+{
+  ASSERT (sector != SWAP_NONE);
+
+  lock_acquire (&swap_lock);
+  page_in_cnt++;
+  read_cnt++;
+  lock_release (&swap_lock);
+
+  block_read_multiple (swap_device, sector, PAGE_SECTORS, data);
+}
+
+/* Releases the swap slot that starts at SECTOR, unless SECTOR is
+   SWAP_NONE. */
+void
+swap_release (block_sector_t sector)
+{
+  size_t slot;
+
+  if (sector == SWAP_NONE)
+    return;
+
+  slot = sector / PAGE_SECTORS;
+  lock_acquire (&swap_lock);
+  bitmap_reset (swap_bitmap, slot);
+  slot_pages[slot] = NULL;
+  lock_release (&swap_lock);
+}
+
+/* Records the swap statistics of T, a process that has exited,
+   for swap_print_stats().  Must be called after T's pages have
+   been freed. */
+void
+swap_exit (struct thread *t)
+{
+  if (t->swap_in_cnt == 0 && t->swap_out_cnt == 0)
+    return;
+
+  lock_acquire (&swap_lock);
+  if (record_cnt < MAX_RECORDS)
+    {
+      struct swap_record *r = &records[record_cnt];
+      strlcpy (r->name, t->name, sizeof r->name);
+      r->tid = t->tid;
+      r->in_cnt = t->swap_in_cnt;
+      r->out_cnt = t->swap_out_cnt;
+    }
+  record_cnt++;
+  lock_release (&swap_lock);
+}
+
+/* Prints swap statistics, including those of each process that
+   used swap. */
+void
+swap_print_stats (void)
+{
+  size_t i;
+
+  printf ("Swap: %llu pages out in %llu writes, "
+          "%llu pages in in %llu reads (%llu read around)\n",
+          page_out_cnt, write_cnt, page_in_cnt, read_cnt, around_cnt);
+  for (i = 0; i < record_cnt && i < MAX_RECORDS; i++)
+    printf ("Swap: %s (tid %d): %u pages in, %u pages out\n",
+            records[i].name, records[i].tid,
+            records[i].in_cnt, records[i].out_cnt);
+  if (record_cnt > MAX_RECORDS)
+    printf ("Swap: %zu more processes not shown\n",
+            record_cnt - MAX_RECORDS);
+}
@@ -0,0 +1,27 @@
+#ifndef VM_SWAP_H
+#define VM_SWAP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "devices/block.h"
+
+struct page;
+struct thread;
+
+/* Swap sector of a page that is not in swap. */
+#define SWAP_NONE ((block_sector_t) -1)
+
+/* Most pages written to or read from swap in one transfer. */
+#define SWAP_CLUSTER 8
+
+void swap_init (void);
+size_t swap_out (struct page *[], void *data[], size_t cnt);
+size_t swap_in (struct page *, struct page *around[]);
+void swap_free (struct page *);
+bool swap_write (block_sector_t *, const void *);
+void swap_read (block_sector_t, void *);
+void swap_release (block_sector_t);
+void swap_exit (struct thread *);
+void swap_print_stats (void);
+
+#endif /* vm/swap.h */
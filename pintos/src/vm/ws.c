@@ -0,0 +1,287 @@
+#include "vm/ws.h"
+#include <debug.h>
+#include <stdio.h>
+#include "vm/frame.h"
+#include "vm/page.h"
+#include "devices/timer.h"
+#include "threads/interrupt.h"
+#include "threads/thread.h"
+#include "userprog/pagedir.h"
+
+/* Working sets.
+
+   A process's working set is the set of pages it has referenced
+   in the last WS_TAU sampling periods.  Every WS_PERIOD timer
+   ticks, the "ws" kernel thread samples the accessed bit of each
+   page in memory, clearing it and stamping the page with the
+   current period if it was set, and counts each process's
+   working set and resident pages.
+
+   Each process also has an allotment of frames, set by a page
+   fault frequency controller: a process that took more than
+   PFF_HIGH page faults in the last period is allotted more
+   frames, and one that took fewer than PFF_LOW gives some back,
+   down to the size of its working set.  When it needs a victim,
+   the clock in vm/frame.c first passes over the pages in the
+   working set of any process that holds no more frames than its
+   allotment, so frames move from processes that do not need them
+   to processes that do.
+
+   When the working sets of the running processes add up to more
+   than physical memory, no allotment can satisfy them all, and
+   every process would spend its time faulting.  Then the process
+   with the largest working set is suspended, each of its threads
+   at its next page fault, until the others' working sets shrink
+   enough to make room for it again. */
+
+/* Sampling period, in timer ticks. */
+#define WS_PERIOD (TIMER_FREQ / 10)
+
+/* Working set window, in sampling periods. */
+#define WS_TAU 4
+
+/* Page fault frequency thresholds, in faults per period. */
+#define PFF_HIGH 16
+#define PFF_LOW 2
+
+/* Current sampling period.  Written only by the "ws" thread. */
+static unsigned ws_period;
+
+/* Statistics. */
+static unsigned long long suspend_cnt;  /* Processes suspended. */
+static unsigned long long resume_cnt;   /* Processes resumed. */
+
+/* The working set load, gathered by update_thread(). */
+struct ws_load
+  {
+    size_t active_cnt;          /* Processes not suspended. */
+    size_t active_ws;           /* Sum of their working sets. */
+    struct thread *largest;     /* Active process, largest working set. */
+    struct thread *resume;      /* Suspended longest. */
+  };
+
+static thread_func ws_daemon NO_RETURN;
+
+/* Starts sampling working sets. */
+void
+ws_init (void)
+{
+  if (thread_create ("ws", PRI_DEFAULT, ws_daemon, NULL) == TID_ERROR)
+    PANIC ("couldn't start working set thread");
+}
+
+/* Returns true if page P was referenced in the last WS_TAU
+   periods. */
+static bool
+in_working_set (const struct page *p)
+{
+  return ws_period - p->ref_period < WS_TAU;
+}
+
+/* Records that page P has been referenced in the current
+   period. */
+void
+ws_referenced (struct page *p)
+{
+  p->ref_period = ws_period;
+}
+
+/* Returns true if frame F, which must be locked by the current
+   thread, holds a page in the working set of a process that holds
+   no more frames than its allotment. */
+bool
+ws_protects (struct frame *f)
+{
+  struct list_elem *e;
+
+  ASSERT (lock_held_by_current_thread (&f->lock));
+
+  for (e = list_begin (&f->pages); e != list_end (&f->pages);
+       e = list_next (e))
+    {
+      struct page *p = list_entry (e, struct page, frame_elem);
+      struct thread *t = p->thread;
+      if (!t->exited && in_working_set (p) && t->ws_resident <= t->ws_allot)
+        return true;
+    }
+  return false;
+}
+
+/* Suspends the running thread while load control wants its
+   process suspended, unless the process is ending.  Must be
+   called only where the thread holds no locks, that is, on a page
+   fault in user mode. */
+void
+ws_check_suspend (void)
+{
+  struct thread *t = thread_current ();
+  enum intr_level old_level;
+
+  old_level = intr_disable ();
+  while (t->leader->ws_suspend && !t->leader->exiting)
+    {
+      t->ws_blocked = true;
+      thread_block ();
+    }
+  intr_set_level (old_level);
+}
+
+/* Unblocks thread T if it belongs to the process led by LEADER_
+   and is blocked in ws_check_suspend(). */
+static void
+wake_thread (struct thread *t, void *leader_)
+{
+  struct thread *leader = leader_;
+
+  if (t->leader == leader && t->ws_blocked)
+    {
+      t->ws_blocked = false;
+      thread_unblock (t);
+    }
+}
+
+/* Wakes each thread of the process led by LEADER that is blocked
+   in ws_check_suspend(), so that it checks again whether to stay
+   suspended. */
+void
+ws_wake_process (struct thread *leader)
+{
+  enum intr_level old_level;
+
+  old_level = intr_disable ();
+  thread_foreach (wake_thread, leader);
+  intr_set_level (old_level);
+}
+
+/* Prints working set statistics. */
+void
+ws_print_stats (void)
+{
+  printf ("Working set: %llu suspensions, %llu resumptions\n",
+          suspend_cnt, resume_cnt);
+}
+
+/* Samples the accessed bits of the pages in frame F, which is
+   locked, and counts them toward their processes' working sets
+   and resident pages. */
+static void
+sample_frame (struct frame *f, void *aux UNUSED)
+{
+  struct list_elem *e;
+
+  for (e = list_begin (&f->pages); e != list_end (&f->pages);
+       e = list_next (e))
+    {
+      struct page *p = list_entry (e, struct page, frame_elem);
+      struct thread *t = p->thread;
+
+      if (pagedir_is_accessed (t->pagedir, p->upage))
+        {
+          pagedir_set_accessed (t->pagedir, p->upage, false);
+          ws_referenced (p);
+        }
+      t->ws_resident_next++;
+      if (in_working_set (p))
+        t->ws_size_next++;
+    }
+}
+
+/* Returns the number of page faults that process T has resolved. */
+static unsigned long long
+resolved_faults (const struct thread *t)
+{
+  unsigned long long cnt = 0;
+  int type;
+
+  for (type = 0; type < FAULT_TYPE_CNT; type++)
+    if (type != FAULT_INVALID && type != FAULT_FIXUP)
+      cnt += t->fault_stats.cnt[type];
+  return cnt;
+}
+
+/* Publishes the counts that sample_frame() gathered for process
+   T, updates its allotment according to its page fault frequency,
+   and adds it to the load in LOAD_. */
+static void
+update_thread (struct thread *t, void *load_)
+{
+  struct ws_load *load = load_;
+  unsigned long long faults;
+
+  /* A process's other threads share its leader's page directory,
+     but all of its counts are kept in the leader. */
+  if (t->pagedir == NULL || t->leader != t)
+    return;
+
+  t->ws_size = t->ws_size_next;
+  t->ws_resident = t->ws_resident_next;
+  t->ws_size_next = t->ws_resident_next = 0;
+
+  faults = resolved_faults (t) - t->ws_faults;
+  t->ws_faults += faults;
+  if (faults > PFF_HIGH)
+    t->ws_allot = (t->ws_allot > t->ws_resident ? t->ws_allot
+                   : t->ws_resident) + faults;
+  else if (faults < PFF_LOW && t->ws_allot > t->ws_size)
+    t->ws_allot -= (t->ws_allot - t->ws_size + 1) / 2;
+
+  if (t->ws_suspend)
+    {
+      if (load->resume == NULL
+          || (int) (t->ws_suspended_at - load->resume->ws_suspended_at) < 0)
+        load->resume = t;
+    }
+  else
+    {
+      load->active_cnt++;
+      load->active_ws += t->ws_size;
+      if (load->largest == NULL || t->ws_size > load->largest->ws_size)
+        load->largest = t;
+    }
+}
+
+/* Samples working sets, and suspends or resumes a process if
+   the load calls for it. */
+static void
+sample (void)
+{
+  struct ws_load load = {0, 0, NULL, NULL};
+  size_t frame_cnt = frame_table_size ();
+  enum intr_level old_level;
+
+  frame_for_each (sample_frame, NULL);
+
+  old_level = intr_disable ();
+  thread_foreach (update_thread, &load);
+  if (load.active_cnt > 1 && load.active_ws > frame_cnt)
+    {
+      struct thread *t = load.largest;
+      t->ws_suspend = true;
+      t->ws_saved = t->ws_size;
+      t->ws_suspended_at = ws_period;
+      suspend_cnt++;
+    }
+  else if (load.resume != NULL
+           && (load.active_cnt == 0
+               || load.active_ws + load.resume->ws_saved
+                  <= frame_cnt / 8 * 7))
+    {
+      struct thread *t = load.resume;
+      t->ws_suspend = false;
+      thread_foreach (wake_thread, t);
+      resume_cnt++;
+    }
+  ws_period++;
+  intr_set_level (old_level);
+}
+
+/* Working set thread. */
+static void
+ws_daemon (void *aux UNUSED)
+{
+  for (;;)
+    {
+      timer_sleep (WS_PERIOD);
+      sample ();
+    }
+}
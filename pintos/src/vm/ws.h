@@ -0,0 +1,17 @@
+#ifndef VM_WS_H
+#define VM_WS_H
+
+#include <stdbool.h>
+
+struct frame;
+struct page;
+struct thread;
+
+void ws_init (void);
+void ws_referenced (struct page *);
+bool ws_protects (struct frame *);
+void ws_check_suspend (void);
+void ws_wake_process (struct thread *leader);
+void ws_print_stats (void);
+
+#endif /* vm/ws.h */
@@ -0,0 +1,535 @@
+#include "vm/zstore.h"
+#include <bitmap.h>
+#include <debug.h>
+#include <list.h>
+#include <round.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "vm/frame.h"
+#include "vm/page.h"
+#include "vm/swap.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+/* Compressed page store.
+
+   Anonymous pages, the ones that would otherwise go to swap, are
+   compressed when they are evicted and kept in a fixed-size
+   region of the kernel pool.  Bringing such a page back costs a
+   decompression instead of a disk read.  Only when the region
+   fills up are the pages that have been in it longest, which are
+   the coldest, since any access brings a page back out, written
+   to the swap device to make room, SWAP_CLUSTER at a time.  Pages
+   that do not compress well go straight to swap.
+
+   The region is divided into chunks of ZCHUNK bytes.  A
+   compressed page occupies a run of consecutive chunks within one
+   kernel page, tracked by a bitmap.
+
+   Everything here, including the `zentry' member of each page in
+   the store, is protected by zstore_lock.  The lock is not held
+   while pages are written back to swap: the batch being written
+   is moved to the `writeback' list and marked in flight, and a
+   thread that wants to load or free one of those pages waits
+   until the write finishes.  Only one batch is written back at a
+   time, through writeback_buf. */
+
+/* Size of an allocation unit in the store. */
+#define ZCHUNK 64
+#define CHUNKS_PER_PAGE (PGSIZE / ZCHUNK)
+
+/* Pages that compress to more than this are not worth storing. */
+#define MAX_STORED_SIZE (PGSIZE / 4 * 3)
+
+/* A compressed page. */
+struct zentry
+  {
+    struct list_elem elem;      /* Element in `entries'. */
+    struct page *page;          /* Page stored. */
+    size_t chunk;               /* First chunk. */
+    size_t size;                /* Size in bytes. */
+    bool in_flight;             /* Being written back to swap? */
+  };
+
+/* Number of kernel pages to devote to the store, set by the -zs
+   kernel command line option.  SIZE_MAX means a quarter as many
+   as there are frames. */
+size_t zstore_page_cnt = SIZE_MAX;
+
+static uint8_t **store_pages;   /* Kernel pages in the store. */
+static struct bitmap *chunks;   /* Used chunks. */
+static struct list entries;     /* Stored pages, oldest first. */
+static struct list writeback;   /* Pages being written back. */
+static bool writeback_busy;     /* Write-back in progress? */
+static struct condition writeback_done; /* Signaled when it ends. */
+static struct lock zstore_lock; /* Protects everything here. */
+
+/* Buffers for compression and for writing back to swap. */
+static uint8_t *compress_buf;
+static uint8_t *writeback_buf;
+
+/* Statistics. */
+static unsigned long long stored_cnt;   /* Pages stored. */
+static unsigned long long stored_bytes; /* Their compressed size. */
+static unsigned long long hit_cnt;      /* Pages loaded from store. */
+static unsigned long long miss_cnt;     /* Pages loaded from swap. */
+static unsigned long long reject_cnt;   /* Pages that would not fit. */
+static unsigned long long writeback_cnt;        /* Pages written back. */
+static unsigned long long writeback_xfer_cnt;   /* Transfers. */
+
+static size_t lz_compress (const uint8_t *, size_t, uint8_t *, size_t);
+static bool lz_decompress (const uint8_t *, size_t, uint8_t *, size_t);
+
+/* Sets up the compressed store. */
+void
+zstore_init (void)
+{
+  size_t i;
+
+  lock_init (&zstore_lock);
+  list_init (&entries);
+  list_init (&writeback);
+  cond_init (&writeback_done);
+
+  if (zstore_page_cnt == SIZE_MAX)
+    zstore_page_cnt = frame_table_size () / 4;
+  store_pages = malloc (sizeof *store_pages * (zstore_page_cnt + 1));
+  compress_buf = palloc_get_page (0);
+  writeback_buf = palloc_get_multiple (0, SWAP_CLUSTER);
+  if (store_pages == NULL || compress_buf == NULL || writeback_buf == NULL)
+    PANIC ("couldn't allocate compressed store");
+
+  for (i = 0; i < zstore_page_cnt; i++)
+    {
+      store_pages[i] = palloc_get_page (0);
+      if (store_pages[i] == NULL)
+        break;
+    }
+  zstore_page_cnt = i;
+
+  chunks = bitmap_create (zstore_page_cnt * CHUNKS_PER_PAGE);
+  if (chunks == NULL)
+    PANIC ("couldn't allocate compressed store");
+}
+
+/* Returns the address of chunk CHUNK. */
+static uint8_t *
+chunk_addr (size_t chunk)
+{
+  return (store_pages[chunk / CHUNKS_PER_PAGE]
+          + chunk % CHUNKS_PER_PAGE * ZCHUNK);
+}
+
+/* Allocates CNT consecutive chunks within one kernel page and
+   returns the first, or BITMAP_ERROR if there is no room. */
+static size_t
+alloc_chunks (size_t cnt)
+{
+  size_t start = 0;
+  size_t chunk;
+
+  while ((chunk = bitmap_scan (chunks, start, cnt, false)) != BITMAP_ERROR)
+    {
+      if (chunk / CHUNKS_PER_PAGE == (chunk + cnt - 1) / CHUNKS_PER_PAGE)
+        {
+          bitmap_set_multiple (chunks, chunk, cnt, true);
+          return chunk;
+        }
+      start = (chunk / CHUNKS_PER_PAGE + 1) * CHUNKS_PER_PAGE;
+    }
+  return BITMAP_ERROR;
+}
+
+/* Removes entry Z from the store and frees it. */
+static void
+remove_entry (struct zentry *z)
+{
+  ASSERT (lock_held_by_current_thread (&zstore_lock));
+  ASSERT (!z->in_flight);
+
+  bitmap_set_multiple (chunks, z->chunk, DIV_ROUND_UP (z->size, ZCHUNK),
+                       false);
+  list_remove (&z->elem);
+  z->page->zentry = NULL;
+  free (z);
+}
+
+/* Decompresses entry Z into DATA. */
+static void
+decompress_entry (const struct zentry *z, void *data)
+{
+  if (!lz_decompress (chunk_addr (z->chunk), z->size, data, PGSIZE))
+    PANIC ("compressed store corrupted");
+}
+
+/* Waits, with zstore_lock held, until page P is not being
+   written back to swap. */
+static void
+wait_for_writeback (struct page *p)
+{
+  ASSERT (lock_held_by_current_thread (&zstore_lock));
+
+  while (p->zentry != NULL && p->zentry->in_flight)
+    cond_wait (&writeback_done, &zstore_lock);
+}
+
+/* Writes up to SWAP_CLUSTER of the oldest pages in the store to
+   swap, with a single transfer, and removes them from the store.
+   zstore_lock must be held, but it is released during the
+   transfer.  If another thread is already writing back, waits for
+   it to finish instead.  Returns false if the store is empty or
+   swap is full, true if room may have been made. */
+static bool
+write_back_oldest (void)
+{
+  struct page *pages[SWAP_CLUSTER];
+  void *data[SWAP_CLUSTER];
+  size_t cnt = 0;
+  size_t written;
+  size_t i;
+
+  ASSERT (lock_held_by_current_thread (&zstore_lock));
+
+  if (writeback_busy)
+    {
+      while (writeback_busy)
+        cond_wait (&writeback_done, &zstore_lock);
+      return true;
+    }
+
+  /* Take the batch out of `entries' and mark it in flight. */
+  while (!list_empty (&entries) && cnt < SWAP_CLUSTER)
+    {
+      struct zentry *z = list_entry (list_pop_front (&entries),
+                                     struct zentry, elem);
+      z->in_flight = true;
+      list_push_back (&writeback, &z->elem);
+      pages[cnt++] = z->page;
+    }
+  if (cnt == 0)
+    return false;
+  writeback_busy = true;
+  lock_release (&zstore_lock);
+
+  /* In-flight chunks are not freed, so they may be read without
+     the lock. */
+  for (i = 0; i < cnt; i++)
+    {
+      data[i] = writeback_buf + i * PGSIZE;
+      decompress_entry (pages[i]->zentry, data[i]);
+    }
+  written = swap_out (pages, data, cnt);
+
+  /* Free the pages written, and put any that did not fit in swap
+     back at the front of `entries', oldest first. */
+  lock_acquire (&zstore_lock);
+  for (i = cnt; i-- > 0; )
+    {
+      struct zentry *z = pages[i]->zentry;
+      z->in_flight = false;
+      if (i < written)
+        remove_entry (z);
+      else
+        {
+          list_remove (&z->elem);
+          list_push_front (&entries, &z->elem);
+        }
+    }
+  writeback_cnt += written;
+  if (written > 0)
+    writeback_xfer_cnt++;
+  writeback_busy = false;
+  cond_broadcast (&writeback_done, &zstore_lock);
+  return written > 0;
+}
+
+/* Compresses the PGSIZE bytes of DATA, the contents of page P,
+   which must be in a frame locked by the current thread, into
+   the store.  Returns true if successful, false if P does not
+   compress well enough or there is no room for it. */
+bool
+zstore_put (struct page *p, const void *data)
+{
+  struct zentry *z;
+  size_t size;
+  size_t chunk;
+
+  ASSERT (p->zentry == NULL);
+
+  if (zstore_page_cnt == 0)
+    return false;
+  z = malloc (sizeof *z);
+  if (z == NULL)
+    return false;
+
+  /* Writing back releases the lock, letting another thread reuse
+     compress_buf, so compress again after each write-back. */
+  lock_acquire (&zstore_lock);
+  for (;;)
+    {
+      size = lz_compress (data, PGSIZE, compress_buf, MAX_STORED_SIZE);
+      if (size == 0)
+        goto reject;
+      chunk = alloc_chunks (DIV_ROUND_UP (size, ZCHUNK));
+      if (chunk != BITMAP_ERROR)
+        break;
+      if (!write_back_oldest ())
+        goto reject;
+    }
+
+  memcpy (chunk_addr (chunk), compress_buf, size);
+  z->page = p;
+  z->chunk = chunk;
+  z->size = size;
+  z->in_flight = false;
+  list_push_back (&entries, &z->elem);
+  p->zentry = z;
+  stored_cnt++;
+  stored_bytes += size;
+  lock_release (&zstore_lock);
+
+  /* From now on the page's contents live here, not in the file it
+     was originally read from. */
+  p->file = NULL;
+  p->file_ofs = 0;
+  p->file_bytes = 0;
+  return true;
+
+ reject:
+  reject_cnt++;
+  lock_release (&zstore_lock);
+  free (z);
+  return false;
+}
+
+/* If page P, which must be in a frame locked by the current
+   thread, is in the store, decompresses it into DATA, removes it
+   from the store, and returns true.  Otherwise, returns false. */
+bool
+zstore_load (struct page *p, void *data)
+{
+  bool hit;
+
+  if (p->zentry == NULL && p->sector == SWAP_NONE)
+    return false;
+
+  lock_acquire (&zstore_lock);
+  wait_for_writeback (p);
+  hit = p->zentry != NULL;
+  if (hit)
+    {
+      decompress_entry (p->zentry, data);
+      remove_entry (p->zentry);
+      hit_cnt++;
+    }
+  else
+    miss_cnt++;
+  lock_release (&zstore_lock);
+  return hit;
+}
+
+/* Removes page P from the store, if it is there. */
+void
+zstore_free (struct page *p)
+{
+  if (p->zentry == NULL)
+    return;
+
+  lock_acquire (&zstore_lock);
+  wait_for_writeback (p);
+  if (p->zentry != NULL)
+    remove_entry (p->zentry);
+  lock_release (&zstore_lock);
+}
+
+/* Prints compressed store statistics. */
+void
+zstore_print_stats (void)
+{
+  unsigned long long ratio = stored_bytes > 0
+                             ? stored_cnt * PGSIZE * 100 / stored_bytes : 0;
+
+  printf ("Compressed store: %zu pages, %llu pages stored, "
+          "compression ratio %llu.%02llu\n",
+          zstore_page_cnt, stored_cnt, ratio / 100, ratio % 100);
+  printf ("Compressed store: %llu hits, %llu misses, %llu rejected, "
+          "%llu written back in %llu writes\n",
+          hit_cnt, miss_cnt, reject_cnt, writeback_cnt, writeback_xfer_cnt);
+}
+
+/* LZ77 compression, in the style of LZF.
+
+   The compressed data is a sequence of items, each starting with
+   a control byte C:
+
+     - C < 32: a run of C + 1 literal bytes follows.
+
+     - C >= 32: a back reference.  The length code L is C >> 5,
+       and if it is 7, the next byte is added to it.  The offset
+       is ((C & 31) << 8 | next byte) + 1.  L + 2 bytes are copied
+       from that far back in the output.
+
+   Matches are found through a hash table of the positions of the
+   last 3-byte sequences seen. */
+
+#define LZ_HASH_BITS 12
+#define LZ_MAX_LITERAL 32
+#define LZ_MAX_OFFSET 8192
+#define LZ_MAX_MATCH (7 + 255 + 2)
+
+/* Hash table for lz_compress(), protected by zstore_lock. */
+static uint16_t lz_hash[1 << LZ_HASH_BITS];
+
+/* Returns the hash of the 3 bytes at P. */
+static unsigned
+lz_hash_bytes (const uint8_t *p)
+{
+  uint32_t v = p[0] << 16 | p[1] << 8 | p[2];
+  return (v * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+/* Compresses the IN_LEN bytes at IN into OUT, which has room for
+   OUT_LEN bytes, and returns the compressed size, or 0 if it
+   would not fit. */
+static size_t
+lz_compress (const uint8_t *in, size_t in_len, uint8_t *out, size_t out_len)
+{
+  const uint8_t *ip = in;
+  const uint8_t *in_end = in + in_len;
+  uint8_t *op = out;
+  uint8_t *out_end = out + out_len;
+  uint8_t *lit_ctrl;
+  size_t lit = 0;
+
+  ASSERT (in_len <= UINT16_MAX);
+
+  memset (lz_hash, 0, sizeof lz_hash);
+  if (op >= out_end)
+    return 0;
+  lit_ctrl = op++;
+
+  while (ip < in_end)
+    {
+      size_t len = 0;
+      size_t ofs = 0;
+
+      if (in_end - ip >= 3)
+        {
+          uint16_t *slot = &lz_hash[lz_hash_bytes (ip)];
+          const uint8_t *ref = in + *slot;
+          *slot = ip - in;
+          if (ref < ip && ip - ref <= LZ_MAX_OFFSET
+              && ref[0] == ip[0] && ref[1] == ip[1] && ref[2] == ip[2])
+            {
+              size_t max = in_end - ip < LZ_MAX_MATCH ? in_end - ip
+                                                       : LZ_MAX_MATCH;
+              for (len = 3; len < max && ref[len] == ip[len]; len++)
+                continue;
+              ofs = ip - ref;
+            }
+        }
+
+      if (len == 0)
+        {
+          /* Literal. */
+          if (op >= out_end)
+            return 0;
+          *op++ = *ip++;
+          if (++lit == LZ_MAX_LITERAL)
+            {
+              *lit_ctrl = lit - 1;
+              lit = 0;
+              if (op >= out_end)
+                return 0;
+              lit_ctrl = op++;
+            }
+        }
+      else
+        {
+          /* Back reference.  End the literal run first, dropping
+             its control byte if it is empty. */
+          size_t code = len - 2;
+
+          if (lit > 0)
+            *lit_ctrl = lit - 1;
+          else
+            op--;
+          lit = 0;
+          if (out_end - op < 4)
+            return 0;
+
+          ofs--;
+          if (code < 7)
+            *op++ = code << 5 | ofs >> 8;
+          else
+            {
+              *op++ = 7 << 5 | ofs >> 8;
+              *op++ = code - 7;
+            }
+          *op++ = ofs & 0xff;
+          ip += len;
+          lit_ctrl = op++;
+        }
+    }
+
+  if (lit > 0)
+    *lit_ctrl = lit - 1;
+  else
+    op--;
+  return op - out;
+}
+
+/* Decompresses the IN_LEN bytes at IN, which must decompress to
+   exactly OUT_LEN bytes, into OUT.  Returns true if successful,
+   false if the data is corrupt. */
+static bool
+lz_decompress (const uint8_t *in, size_t in_len, uint8_t *out, size_t out_len)
+{
+  const uint8_t *ip = in;
+  const uint8_t *in_end = in + in_len;
+  uint8_t *op = out;
+  uint8_t *out_end = out + out_len;
+
+  while (ip < in_end)
+    {
+      unsigned c = *ip++;
+
+      if (c < LZ_MAX_LITERAL)
+        {
+          size_t cnt = c + 1;
+          if ((size_t) (in_end - ip) < cnt || (size_t) (out_end - op) < cnt)
+            return false;
+          memcpy (op, ip, cnt);
+          op += cnt;
+          ip += cnt;
+        }
+      else
+        {
+          size_t len = c >> 5;
+          size_t ofs;
+          const uint8_t *ref;
+
+          if (len == 7)
+            {
+              if (ip >= in_end)
+                return false;
+              len += *ip++;
+            }
+          if (ip >= in_end)
+            return false;
+          ofs = ((c & 31) << 8 | *ip++) + 1;
+          len += 2;
+          if ((size_t) (op - out) < ofs || (size_t) (out_end - op) < len)
+            return false;
+
+          /* The source and destination may overlap, so copy a byte
+             at a time. */
+          for (ref = op - ofs; len > 0; len--)
+            *op++ = *ref++;
+        }
+    }
+  return op == out_end;
+}
@@ -0,0 +1,18 @@
+#ifndef VM_ZSTORE_H
+#define VM_ZSTORE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+struct page;
+
+/* Number of kernel pages to devote to the compressed store. */
+extern size_t zstore_page_cnt;
+
+void zstore_init (void);
+bool zstore_put (struct page *, const void *data);
+bool zstore_load (struct page *, void *data);
+void zstore_free (struct page *);
+void zstore_print_stats (void);
+
+#endif /* vm/zstore.h */